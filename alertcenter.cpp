@@ -0,0 +1,120 @@
+#include "alertcenter.h"
+#include "latencyhistogram.h"
+#include <QTimer>
+#include <algorithm>
+
+static const int infoDisplayMs = 5000;
+
+AlertCenter::AlertCenter(QStatusBar *statusBar, QObject *parent)
+    : QObject(parent), showing(false), nextSequence(0), largestBacklog(0), merged(0)
+{
+    banner = new ClickableLabel(statusBar);
+    banner->setWordWrap(true);
+    banner->hide();
+    statusBar->addWidget(banner, 1);
+    connect(banner, &ClickableLabel::clicked, this, &AlertCenter::dismissCurrent);
+}
+
+void AlertCenter::raise(const QString &key, Priority priority, const QString &title, const QString &message) {
+    // Same alert already on screen: refresh the text, escalating if needed.
+    if (showing && current.key == key) {
+        ++merged;
+        current.priority = std::max(current.priority, priority);
+        current.title = title;
+        current.message = message;
+        display(current);
+        return;
+    }
+
+    for (Alert &queued : queue) {
+        if (queued.key == key) {
+            ++merged;
+            queued.priority = std::max(queued.priority, priority);
+            queued.title = title;
+            queued.message = message;
+            return;
+        }
+    }
+
+    Alert alert;
+    alert.key = key;
+    alert.priority = priority;
+    alert.title = title;
+    alert.message = message;
+    alert.raisedAt = LatencyHistogram::now();
+    alert.sequence = nextSequence++;
+    queue.append(alert);
+
+    // A more urgent alert pre-empts the one on screen, which goes back in the queue.
+    if (showing && priority > current.priority) {
+        queue.append(current);
+        showing = false;
+    }
+    largestBacklog = std::max(largestBacklog, backlog());
+
+    if (!showing)
+        showNext();
+}
+
+void AlertCenter::dismissCurrent() {
+    showing = false;
+    banner->hide();
+    showNext();
+}
+
+void AlertCenter::showNext() {
+    if (queue.isEmpty())
+        return;
+
+    // Highest priority first, oldest first within a priority.
+    auto next = std::min_element(queue.begin(), queue.end(), [](const Alert &a, const Alert &b) {
+        return a.priority != b.priority ? a.priority > b.priority : a.sequence < b.sequence;
+    });
+    current = *next;
+    queue.erase(next);
+    showing = true;
+
+    Latency::alertDisplay.record(LatencyHistogram::now() - current.raisedAt);
+    display(current);
+
+    if (current.priority == Info) {
+        quint64 sequence = current.sequence;
+        QTimer::singleShot(infoDisplayMs, this, [this, sequence]() {
+            if (showing && current.sequence == sequence)
+                dismissCurrent();
+        });
+    }
+}
+
+void AlertCenter::display(const Alert &alert) {
+    QString color;
+    if (alert.priority == Critical)
+        color = "#ff4444";
+    else if (alert.priority == Warning)
+        color = "#ffaa00";
+    else
+        color = "#55cc55";
+
+    QString more = queue.isEmpty() ? QString() : " (+" + QString::number(queue.size()) + " more)";
+    banner->setText(alert.title + ": " + alert.message + more);
+    banner->setStyleSheet("color: " + color + "; font-weight: bold;");
+    banner->show();
+}
+
+int AlertCenter::backlog() const {
+    return queue.size();
+}
+
+int AlertCenter::maxBacklog() const {
+    return largestBacklog;
+}
+
+quint64 AlertCenter::duplicatesMerged() const {
+    return merged;
+}
+
+QString AlertCenter::metrics() const {
+    return "Alerts: backlog=" + QString::number(backlog())
+           + " maxBacklog=" + QString::number(maxBacklog())
+           + " merged=" + QString::number(duplicatesMerged());
+}
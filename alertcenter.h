@@ -0,0 +1,56 @@
+#ifndef ALERTCENTER_H
+#define ALERTCENTER_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QStatusBar>
+#include "clickablelabel.h"
+
+// Non-modal alerts for the simulation. raise() only queues and returns, so timer slots never
+// block in a nested dialog loop. One alert at a time is shown in a banner in the status bar,
+// highest priority first; clicking the banner dismisses it. Alerts with a key that is already
+// queued or showing are merged into the existing one instead of piling up.
+class AlertCenter : public QObject {
+    Q_OBJECT
+
+public:
+    enum Priority {
+        Info,       // dismissed automatically after a few seconds
+        Warning,
+        Critical
+    };
+
+    explicit AlertCenter(QStatusBar *statusBar, QObject *parent = nullptr);
+
+    void raise(const QString &key, Priority priority, const QString &title, const QString &message);
+    void dismissCurrent();
+
+    int backlog() const;            // alerts waiting behind the one on screen
+    int maxBacklog() const;
+    quint64 duplicatesMerged() const;
+    QString metrics() const;
+
+private:
+    struct Alert {
+        QString key;
+        Priority priority;
+        QString title;
+        QString message;
+        qint64 raisedAt;
+        quint64 sequence;
+    };
+
+    ClickableLabel *banner;
+    QVector<Alert> queue;
+    Alert current;
+    bool showing;
+    quint64 nextSequence;
+    int largestBacklog;
+    quint64 merged;
+
+    void showNext();
+    void display(const Alert &alert);
+};
+
+#endif // ALERTCENTER_H
@@ -0,0 +1,85 @@
+#include "allocationcounter.h"
+#include <QStringList>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<quint64> subsystemAllocations[int(AllocationSubsystem::Count)];
+static thread_local AllocationSubsystem currentSubsystem = AllocationSubsystem::Other;
+static thread_local quint64 threadAllocations = 0;
+
+#ifdef INSULINPUMP_COUNT_ALLOCATIONS
+
+static void *countedAllocate(std::size_t size) {
+    ++threadAllocations;
+    subsystemAllocations[int(currentSubsystem)].fetch_add(1, std::memory_order_relaxed);
+    void *memory = std::malloc(size ? size : 1);
+    if (!memory)
+        throw std::bad_alloc();
+    return memory;
+}
+
+void *operator new(std::size_t size) { return countedAllocate(size); }
+void *operator new[](std::size_t size) { return countedAllocate(size); }
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    try { return countedAllocate(size); } catch (...) { return nullptr; }
+}
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+    try { return countedAllocate(size); } catch (...) { return nullptr; }
+}
+void operator delete(void *memory) noexcept { std::free(memory); }
+void operator delete[](void *memory) noexcept { std::free(memory); }
+void operator delete(void *memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void *memory, std::size_t) noexcept { std::free(memory); }
+void operator delete(void *memory, const std::nothrow_t &) noexcept { std::free(memory); }
+void operator delete[](void *memory, const std::nothrow_t &) noexcept { std::free(memory); }
+
+#endif // INSULINPUMP_COUNT_ALLOCATIONS
+
+bool AllocationCounter::enabled() {
+#ifdef INSULINPUMP_COUNT_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+quint64 AllocationCounter::allocations(AllocationSubsystem subsystem) {
+    return subsystemAllocations[int(subsystem)].load(std::memory_order_relaxed);
+}
+
+const char *AllocationCounter::subsystemName(AllocationSubsystem subsystem) {
+    switch (subsystem) {
+        case AllocationSubsystem::Pump: return "Pump";
+        case AllocationSubsystem::CGM: return "CGM";
+        case AllocationSubsystem::Controller: return "Controller";
+        default: return "Other";
+    }
+}
+
+QString AllocationCounter::report() {
+    if (!enabled())
+        return "Allocation counting is disabled (build with CONFIG+=count_allocations).";
+
+    QStringList lines;
+    for (int i = 0; i < int(AllocationSubsystem::Count); ++i) {
+        AllocationSubsystem subsystem = AllocationSubsystem(i);
+        lines.append(QString(subsystemName(subsystem)) + ": " + QString::number(allocations(subsystem)) + " allocations");
+    }
+    return lines.join("\n");
+}
+
+HotPathScope::HotPathScope(AllocationSubsystem subsystem)
+    : previousSubsystem(currentSubsystem), subsystem(subsystem), allocationsAtStart(threadAllocations)
+{
+    currentSubsystem = subsystem;
+}
+
+HotPathScope::~HotPathScope() {
+    currentSubsystem = previousSubsystem;
+    if (threadAllocations != allocationsAtStart) {
+        qFatal("Hot path allocated: %llu heap allocation(s) in %s",
+               static_cast<unsigned long long>(threadAllocations - allocationsAtStart),
+               AllocationCounter::subsystemName(subsystem));
+    }
+}
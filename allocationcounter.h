@@ -0,0 +1,47 @@
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <QString>
+#include <QtGlobal>
+
+// Heap allocation accounting for the dosing hot path.
+//
+// Built with CONFIG+=count_allocations (defines INSULINPUMP_COUNT_ALLOCATIONS), the global
+// operator new is replaced by a counting one and every HOT_PATH() scope aborts the program
+// with qFatal if anything was allocated inside it. In normal builds HOT_PATH() compiles to nothing.
+// tests/hotpathallocations runs the tick path in such a build and fails on any allocation.
+
+enum class AllocationSubsystem {
+    Other,
+    Pump,
+    CGM,
+    Controller,
+    Count
+};
+
+namespace AllocationCounter {
+    bool enabled();
+    quint64 allocations(AllocationSubsystem subsystem);
+    const char *subsystemName(AllocationSubsystem subsystem);
+    QString report();
+}
+
+// Attributes allocations on this thread to a subsystem and checks that none happen in its lifetime.
+class HotPathScope {
+    private:
+        AllocationSubsystem previousSubsystem;
+        AllocationSubsystem subsystem;
+        quint64 allocationsAtStart;
+
+    public:
+        explicit HotPathScope(AllocationSubsystem subsystem);
+        ~HotPathScope();
+};
+
+#ifdef INSULINPUMP_COUNT_ALLOCATIONS
+#define HOT_PATH(subsystem) HotPathScope hotPathScope(subsystem)
+#else
+#define HOT_PATH(subsystem) do {} while (0)
+#endif
+
+#endif // ALLOCATIONCOUNTER_H
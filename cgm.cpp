@@ -1,6 +1,10 @@
 #include "cgm.h"
+#include "allocationcounter.h"
+#include "latencyhistogram.h"
+#include "tracing.h"
+#include "telemetrybus.h"
 
-CGM::CGM(double correctionFactor) : insulinCorrectionFactor(correctionFactor), fluctuationDistribution(0.0, 0.50) {
+CGM::CGM(double correctionFactor) : lastReadingTime(0), telemetry(nullptr), insulinCorrectionFactor(correctionFactor), fluctuationDistribution(0.0, 0.50) {
     generator.seed(std::random_device{}());
     // Generate a random initial glucose level between 4.0 and 9.0 mmol/L.
     std::uniform_real_distribution<double> initialGlucoseDistribution(4.0, 9.0);
@@ -9,21 +13,38 @@ CGM::CGM(double correctionFactor) : insulinCorrectionFactor(correctionFactor), f
 };
 
 void CGM::readGlucose() {
+    TraceSpan span("CGM read", "sense");
+    HOT_PATH(AllocationSubsystem::CGM);
     double fluctuation = fluctuationDistribution(generator);
     if (fluctuation < -0.5) {
         fluctuation = fluctuation * -1;
     }
     currentGlucose += fluctuation;
+    lastReadingTime = LatencyHistogram::now();
+    if (telemetry)
+        telemetry->publish(TelemetryKind::GlucoseReading, currentGlucose);
 };
 
 void CGM::injectInsulin(double units) {
     currentGlucose -= units * insulinCorrectionFactor;
 };
 
+void CGM::shiftGlucose(double delta) {
+    currentGlucose += delta;
+};
+
 double CGM::getGlucoseLevel() {
     return currentGlucose;
 };
 
+qint64 CGM::getLastReadingTime() const {
+    return lastReadingTime;
+};
+
 void CGM::setCorrectionFactor(double correctionFactor) {
     insulinCorrectionFactor = correctionFactor;
 };
+
+void CGM::setTelemetry(TelemetryBus *bus) {
+    telemetry = bus;
+};
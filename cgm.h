@@ -2,11 +2,16 @@
 #define CGM_H
 
 #include <random>
+#include <QtGlobal>
+
+class TelemetryBus;
 
 // Continuous Glucose Monitor (Simulated)
 class CGM { 
     private:
         double currentGlucose;
+        qint64 lastReadingTime; // LatencyHistogram::now() of the latest reading, 0 before the first
+        TelemetryBus *telemetry;
         double insulinCorrectionFactor;
 
         // Random number generation for simulation of glucose fluctuations.
@@ -17,9 +22,12 @@ class CGM {
         CGM(double correctionFactor);
 
         double getGlucoseLevel();
+        qint64 getLastReadingTime() const;
         void setCorrectionFactor(double correctionFactor);
         void readGlucose();
         void injectInsulin(double units);
+        void shiftGlucose(double delta); // external effects such as meal absorption, in mmol/L
+        void setTelemetry(TelemetryBus *bus); // publishes every reading, nullptr to stop
 };
 
 #endif
@@ -0,0 +1,438 @@
+#include "cgmreplay.h"
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// ---- Scanning ----
+
+// First ',' or '\n' in [p, end), or end. This is the inner loop of CSV parsing, so with SSE2 it
+// compares 16 bytes against both separators at once and picks the first hit from the bit mask.
+static const char *findSeparator(const char *p, const char *end) {
+#if defined(__SSE2__)
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; end - p >= 16; p += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(bytes, comma), _mm_cmpeq_epi8(bytes, newline)));
+        if (mask)
+            return p + __builtin_ctz(unsigned(mask));
+    }
+#endif
+    for (; p < end; ++p) {
+        if (*p == ',' || *p == '\n')
+            return p;
+    }
+    return end;
+}
+
+// First c in [p, end), or end. memchr is vectorised by the C library.
+static const char *findByte(const char *p, const char *end, char c) {
+    const void *hit = std::memchr(p, c, size_t(end - p));
+    return hit ? static_cast<const char*>(hit) : end;
+}
+
+static bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static const char *skipBlank(const char *p, const char *end) {
+    while (p < end && isBlank(*p))
+        ++p;
+    return p;
+}
+
+// Blanks and the quotes around CSV fields.
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '"';
+}
+
+static const char *skipSpace(const char *p, const char *end) {
+    while (p < end && isSpace(*p))
+        ++p;
+    return p;
+}
+
+// Decimal number without exponent, as written by CGM exports. Returns the end of the number, or
+// nullptr if p does not start with one. Leading blanks and a quote are skipped.
+static const char *parseNumber(const char *p, const char *end, double &value) {
+    static const double powersOfTen[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+                                          1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18 };
+    p = skipSpace(p, end);
+    bool negative = p < end && *p == '-';
+    if (negative)
+        ++p;
+
+    // Digits past the 18th are beyond double precision; they only shift the decimal exponent.
+    quint64 mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p, ++digits) {
+        if (digits < 18)
+            mantissa = mantissa * 10 + quint64(*p - '0');
+        else
+            ++exponent;
+    }
+    if (p < end && *p == '.') {
+        for (++p; p < end && *p >= '0' && *p <= '9'; ++p, ++digits) {
+            if (digits < 18) {
+                mantissa = mantissa * 10 + quint64(*p - '0');
+                --exponent;
+            }
+        }
+    }
+    if (digits == 0 || exponent > 18)
+        return nullptr;
+
+    value = exponent >= 0 ? double(mantissa) * powersOfTen[exponent] : double(mantissa) / powersOfTen[-exponent];
+    if (negative)
+        value = -value;
+    return p;
+}
+
+// A field that is a number and nothing else: trailing blanks and a closing quote are allowed,
+// anything else after the number ("120abc", "2024-01-01") rejects it.
+static bool parseNumberField(const char *p, const char *end, double &value) {
+    p = parseNumber(p, end, value);
+    return p && skipSpace(p, end) == end;
+}
+
+// Fixed-width run of digits.
+static bool parseDigits(const char *&p, const char *end, int count, int &value) {
+    if (end - p < count)
+        return false;
+    value = 0;
+    for (int i = 0; i < count; ++i, ++p) {
+        if (*p < '0' || *p > '9')
+            return false;
+        value = value * 10 + (*p - '0');
+    }
+    return true;
+}
+
+// Days from 1970-01-01 to the given proleptic Gregorian date.
+static qint64 daysFromCivil(int year, int month, int day) {
+    year -= month <= 2;
+    qint64 era = (year >= 0 ? year : year - 399) / 400;
+    qint64 yearOfEra = year - era * 400;
+    qint64 dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    qint64 dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+// ISO 8601 date and time as written by Dexcom and Libre exports: "YYYY-MM-DD hh:mm[:ss[.fff]]",
+// with 'T' instead of the blank also accepted, optionally followed by 'Z' or a +hh:mm offset.
+// Times without an offset are taken as UTC; only their differences matter for replay.
+static bool parseDateTimeField(const char *p, const char *end, qint64 &milliseconds) {
+    p = skipSpace(p, end);
+    int year, month, day, hour, minute, second = 0, millisecond = 0;
+    if (!parseDigits(p, end, 4, year) || p == end || *p++ != '-' || !parseDigits(p, end, 2, month)
+        || p == end || *p++ != '-' || !parseDigits(p, end, 2, day)
+        || p == end || (*p != ' ' && *p != 'T') || !parseDigits(++p, end, 2, hour)
+        || p == end || *p++ != ':' || !parseDigits(p, end, 2, minute))
+        return false;
+    if (p < end && *p == ':') {
+        if (!parseDigits(++p, end, 2, second))
+            return false;
+        if (p < end && *p == '.') {
+            int scale = 100;
+            for (++p; p < end && *p >= '0' && *p <= '9'; ++p, scale /= 10)
+                millisecond += (*p - '0') * scale;
+        }
+    }
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60)
+        return false;
+
+    int offsetMinutes = 0;
+    if (p < end && *p == 'Z') {
+        ++p;
+    } else if (p < end && (*p == '+' || *p == '-')) {
+        int sign = *p++ == '-' ? -1 : 1;
+        int offsetHours, offsetMins;
+        if (!parseDigits(p, end, 2, offsetHours))
+            return false;
+        if (p < end && *p == ':')
+            ++p;
+        if (!parseDigits(p, end, 2, offsetMins))
+            return false;
+        offsetMinutes = sign * (offsetHours * 60 + offsetMins);
+    }
+    if (skipSpace(p, end) != end)
+        return false;
+
+    qint64 seconds = daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second - offsetMinutes * 60;
+    milliseconds = seconds * 1000 + millisecond;
+    return true;
+}
+
+static double toMmolPerLitre(double glucose) {
+    return glucose > 30 ? glucose / 18.0 : glucose;
+}
+
+// Epoch seconds or milliseconds to milliseconds; anything before 1973 in milliseconds is seconds.
+static qint64 toMilliseconds(double timestamp) {
+    return timestamp < 1e11 ? qint64(timestamp * 1000) : qint64(timestamp);
+}
+
+static bool fieldIs(const char *begin, const char *end, const char *name) {
+    begin = skipSpace(begin, end);
+    while (end > begin && isSpace(end[-1]))
+        --end;
+    size_t length = std::strlen(name);
+    if (size_t(end - begin) != length)
+        return false;
+    for (size_t i = 0; i < length; ++i) {
+        char c = begin[i];
+        if (c >= 'A' && c <= 'Z')
+            c = char(c - 'A' + 'a');
+        if (c != name[i])
+            return false;
+    }
+    return true;
+}
+
+// ---- CGMReplay ----
+
+CGMReplay::CGMReplay()
+    : data(nullptr), end(nullptr), cursor(nullptr), firstRow(nullptr), detectedFormat(Unknown),
+      newestFirst(false), glucoseColumn(-1), timeColumn(-1), patientColumn(-1), patientText(nullptr), patientLength(0),
+      patientIndex(0)
+{
+}
+
+CGMReplay::~CGMReplay() {
+    close();
+}
+
+bool CGMReplay::open(const QString &path) {
+    close();
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    qint64 length = file.size();
+    uchar *mapped = length > 0 ? file.map(0, length) : nullptr;
+    if (!mapped) {
+        file.close();
+        return false;
+    }
+    data = reinterpret_cast<const char*>(mapped);
+    end = data + length;
+
+    const char *first = skipBlank(data, end);
+    if (first < end && (*first == '[' || *first == '{')) {
+        detectedFormat = Nightscout;
+        firstRow = first;
+        // Nightscout's entries API returns newest first; replay always runs forward in time.
+        CGMSample newest, older;
+        cursor = firstRow;
+        newestFirst = nextNightscout(newest) && nextNightscout(older) && older.timestamp < newest.timestamp;
+    } else {
+        detectedFormat = CSV;
+        cursor = data;
+        if (!readHeader()) {
+            close();
+            return false;
+        }
+        firstRow = cursor;
+    }
+    rewind();
+    return true;
+}
+
+void CGMReplay::close() {
+    if (data) {
+        file.unmap(reinterpret_cast<uchar*>(const_cast<char*>(data)));
+        file.close();
+    }
+    data = end = cursor = firstRow = nullptr;
+    detectedFormat = Unknown;
+    newestFirst = false;
+    glucoseColumn = timeColumn = patientColumn = -1;
+    patientText = nullptr;
+    patientLength = 0;
+    patientIndex = 0;
+}
+
+bool CGMReplay::isOpen() const {
+    return data != nullptr;
+}
+
+CGMReplay::Format CGMReplay::format() const {
+    return detectedFormat;
+}
+
+void CGMReplay::rewind() {
+    cursor = newestFirst ? end : firstRow;
+    patientText = nullptr;
+    patientLength = 0;
+    patientIndex = 0;
+}
+
+qint64 CGMReplay::position() const {
+    if (!data)
+        return 0;
+    return newestFirst ? qint64(end - cursor) : qint64(cursor - data);
+}
+
+qint64 CGMReplay::size() const {
+    return data ? qint64(end - data) : 0;
+}
+
+bool CGMReplay::next(CGMSample &sample) {
+    if (!data)
+        return false;
+    return detectedFormat == CSV ? nextCSV(sample) : nextNightscout(sample);
+}
+
+bool CGMReplay::readHeader() {
+    for (int column = 0; cursor < end; ++column) {
+        const char *fieldEnd = findSeparator(cursor, end);
+        if (fieldIs(cursor, fieldEnd, "glucose") || fieldIs(cursor, fieldEnd, "sgv") || fieldIs(cursor, fieldEnd, "value"))
+            glucoseColumn = column;
+        else if (fieldIs(cursor, fieldEnd, "timestamp") || fieldIs(cursor, fieldEnd, "date") || fieldIs(cursor, fieldEnd, "time"))
+            timeColumn = column;
+        else if (fieldIs(cursor, fieldEnd, "patient"))
+            patientColumn = column;
+
+        cursor = fieldEnd < end ? fieldEnd + 1 : end;
+        if (fieldEnd == end || *fieldEnd == '\n')
+            break;
+    }
+    return glucoseColumn >= 0 && timeColumn >= 0;
+}
+
+bool CGMReplay::nextCSV(CGMSample &sample) {
+    while (cursor < end) {
+        bool haveGlucose = false, haveTime = false;
+        double glucose = 0, number = 0;
+        qint64 timestamp = 0;
+        const char *patient = nullptr;
+        int patientChars = 0;
+
+        for (int column = 0;; ++column) {
+            const char *fieldEnd = findSeparator(cursor, end);
+            if (column == glucoseColumn) {
+                haveGlucose = parseNumberField(cursor, fieldEnd, glucose);
+            } else if (column == timeColumn) {
+                if (parseNumberField(cursor, fieldEnd, number)) {
+                    timestamp = toMilliseconds(number);
+                    haveTime = true;
+                } else {
+                    haveTime = parseDateTimeField(cursor, fieldEnd, timestamp);
+                }
+            } else if (column == patientColumn) {
+                patient = cursor;
+                patientChars = int(fieldEnd - cursor);
+            }
+
+            bool endOfRow = fieldEnd == end || *fieldEnd == '\n';
+            cursor = fieldEnd < end ? fieldEnd + 1 : end;
+            if (endOfRow)
+                break;
+        }
+
+        if (!haveGlucose || !haveTime)
+            continue;
+
+        // The id is compared in place in the mapped file, so a patient change costs no copy.
+        if (patient) {
+            if (patientText && (patientChars != patientLength || std::memcmp(patient, patientText, size_t(patientChars)) != 0))
+                ++patientIndex;
+            patientText = patient;
+            patientLength = patientChars;
+        }
+
+        sample.timestamp = timestamp;
+        sample.glucose = toMmolPerLitre(glucose);
+        sample.patient = patientIndex;
+        return true;
+    }
+    return false;
+}
+
+// Last c in [begin, p), or nullptr.
+static const char *findLastByte(const char *begin, const char *p, char c) {
+    while (p > begin) {
+        if (*--p == c)
+            return p;
+    }
+    return nullptr;
+}
+
+// Reads "sgv" and "date" from the entry object between objectStart ('{') and objectEnd ('}').
+static bool parseNightscoutEntry(const char *objectStart, const char *objectEnd, CGMSample &sample) {
+    bool haveGlucose = false, haveTime = false;
+    double glucose = 0, timestamp = 0;
+    const char *p = objectStart + 1;
+    while (p < objectEnd) {
+        const char *keyStart = findByte(p, objectEnd, '"');
+        if (keyStart == objectEnd)
+            break;
+        const char *keyEnd = findByte(keyStart + 1, objectEnd, '"');
+        if (keyEnd == objectEnd)
+            break;
+        const char *colon = skipBlank(keyEnd + 1, objectEnd);
+        if (colon == objectEnd || *colon != ':') {
+            p = keyEnd + 1;
+            continue;
+        }
+
+        // String values are skipped whole so their contents are not mistaken for keys.
+        const char *valueStart = skipBlank(colon + 1, objectEnd);
+        const char *valueEnd;
+        if (valueStart < objectEnd && *valueStart == '"') {
+            valueEnd = findByte(valueStart + 1, objectEnd, '"');
+            p = valueEnd < objectEnd ? valueEnd + 1 : objectEnd;
+        } else {
+            valueEnd = findSeparator(valueStart, objectEnd);
+            p = valueEnd;
+        }
+
+        size_t keyLength = size_t(keyEnd - keyStart - 1);
+        if (keyLength == 3 && std::memcmp(keyStart + 1, "sgv", 3) == 0)
+            haveGlucose = parseNumberField(valueStart, valueEnd, glucose);
+        else if (keyLength == 4 && std::memcmp(keyStart + 1, "date", 4) == 0)
+            haveTime = parseNumberField(valueStart, valueEnd, timestamp);
+    }
+
+    if (!haveGlucose || !haveTime)
+        return false;
+    sample.timestamp = toMilliseconds(timestamp);
+    sample.glucose = toMmolPerLitre(glucose);
+    sample.patient = 0;
+    return true;
+}
+
+// Entries are flat objects, so an entry runs from one '{' to the next '}'. Newest-first exports
+// are walked from the end of the array towards its start.
+bool CGMReplay::nextNightscout(CGMSample &sample) {
+    if (newestFirst) {
+        while (cursor > firstRow) {
+            const char *objectEnd = findLastByte(firstRow, cursor, '}');
+            const char *objectStart = objectEnd ? findLastByte(firstRow, objectEnd, '{') : nullptr;
+            if (!objectStart) {
+                cursor = firstRow;
+                return false;
+            }
+            cursor = objectStart;
+            if (parseNightscoutEntry(objectStart, objectEnd, sample))
+                return true;
+        }
+        return false;
+    }
+
+    while (cursor < end) {
+        const char *objectStart = findByte(cursor, end, '{');
+        if (objectStart == end) {
+            cursor = end;
+            return false;
+        }
+        const char *objectEnd = findByte(objectStart, end, '}');
+        cursor = objectEnd < end ? objectEnd + 1 : end;
+        if (objectEnd < end && parseNightscoutEntry(objectStart, objectEnd, sample))
+            return true;
+    }
+    return false;
+}
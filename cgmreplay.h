@@ -0,0 +1,131 @@
+#ifndef CGMREPLAY_H
+#define CGMREPLAY_H
+
+#include <QFile>
+#include <QString>
+#include <QtGlobal>
+#include <chrono>
+#include <thread>
+#include "profile.h"
+
+struct CGMSample {
+    qint64 timestamp = 0;  // milliseconds since the epoch
+    double glucose = 0;    // mmol/L
+    quint32 patient = 0;   // 0 for the first patient in the file, incremented whenever it changes
+};
+
+// Recorded CGM traces, replayed in place of the random-walk CGM.
+//
+// The file is memory-mapped and parsed in place as next() is called: nothing is copied or
+// allocated per reading, and only the pages being scanned need to be resident, so exports of
+// any size stream at memory bandwidth. Two formats are detected from the first byte:
+//
+//   CSV         header row naming the columns; glucose from "glucose", "sgv" or "value", time
+//               from "timestamp", "date" or "time" (epoch seconds or milliseconds, or an ISO 8601
+//               date and time such as "2024-01-01 00:05:00"), and an optional "patient" column.
+//               Rows whose glucose or time field is empty or not entirely a number (or date) are
+//               skipped. Rows must be in ascending time order within each patient.
+//   Nightscout  JSON array of entry objects, using "sgv" and "date" (epoch milliseconds);
+//               entries without an sgv (calibrations, meter readings) are skipped. The array may
+//               be oldest-first or newest-first (as the entries API returns it), judged from its
+//               first two entries; newest-first arrays are read back to front.
+//
+// Glucose above 30 is taken to be mg/dL and converted to mmol/L.
+class CGMReplay {
+    public:
+        enum Format { Unknown, CSV, Nightscout };
+
+        CGMReplay();
+        ~CGMReplay();
+
+        bool open(const QString &path);
+        void close();
+        bool isOpen() const;
+        Format format() const;
+
+        // Parses the next reading. Returns false at the end of the file.
+        bool next(CGMSample &sample);
+
+        // Rewinds to the first reading.
+        void rewind();
+
+        // Bytes parsed so far, for progress reporting.
+        qint64 position() const;
+        qint64 size() const;
+
+        // Feeds every remaining reading to controller.autoAdjustInsulinDelivery(profile, glucose).
+        // timeWarp is how many times faster than recorded the trace is replayed; 0 replays as fast
+        // as the controller can go. Returns the number of readings replayed.
+        //
+        // Traces from different patients must not be fed into one pump: before the first reading
+        // of every patient after the first, newPatient(patient) is called so the caller can report
+        // on and reset the controller and pump, or return false to stop there (that reading is
+        // consumed but not replayed). Pacing restarts from each patient's first reading.
+        template <typename Controller, typename NewPatient>
+        qint64 replay(Controller &controller, const Profile &profile, NewPatient newPatient, double timeWarp = 0);
+
+        // As above for a single-patient trace; stops at the first change of patient.
+        template <typename Controller>
+        qint64 replay(Controller &controller, const Profile &profile, double timeWarp = 0);
+
+    private:
+        QFile file;
+        const char *data;
+        const char *end;
+        const char *cursor;
+        const char *firstRow;
+        Format detectedFormat;
+        bool newestFirst;  // Nightscout array in descending date order, read back to front
+
+        // CSV column indices, -1 if absent
+        int glucoseColumn;
+        int timeColumn;
+        int patientColumn;
+
+        // Patient id text of the previous row, compared to detect a change of patient.
+        const char *patientText;
+        int patientLength;
+        quint32 patientIndex;
+
+        bool readHeader();
+        bool nextCSV(CGMSample &sample);
+        bool nextNightscout(CGMSample &sample);
+};
+
+template <typename Controller, typename NewPatient>
+qint64 CGMReplay::replay(Controller &controller, const Profile &profile, NewPatient newPatient, double timeWarp) {
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    qint64 firstTimestamp = 0;
+    qint64 readings = 0;
+    bool first = true;
+    quint32 patient = 0;
+    CGMSample sample;
+
+    while (next(sample)) {
+        if (first || sample.patient != patient) {
+            if (!first && !newPatient(sample.patient))
+                break;
+            first = false;
+            patient = sample.patient;
+            start = Clock::now();
+            firstTimestamp = sample.timestamp;
+        }
+        if (timeWarp > 0) {
+            // Sleep until the reading is due, relative to the patient's first one, so rounding never accumulates.
+            double due = double(sample.timestamp - firstTimestamp) / timeWarp;
+            if (due > 0)
+                std::this_thread::sleep_until(start + std::chrono::duration<double, std::milli>(due));
+        }
+        controller.autoAdjustInsulinDelivery(profile, sample.glucose);
+        ++readings;
+    }
+    return readings;
+}
+
+template <typename Controller>
+qint64 CGMReplay::replay(Controller &controller, const Profile &profile, double timeWarp) {
+    return replay(controller, profile, [](quint32) { return false; }, timeWarp);
+}
+
+#endif // CGMREPLAY_H
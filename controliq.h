@@ -4,31 +4,122 @@
 #include "insulinpump.h"
 #include "profile.h"
 #include "cgm.h"
-#include <cstdlib>
+#include "controlpolicies.h"
+#include "allocationcounter.h"
+#include "latencyhistogram.h"
+#include "tracing.h"
 #include <thread>
 #include <atomic>
 #include <chrono>
 
-class ControlIQ {
+// Closed loop controller, specialised at compile time over its decision policy, glucose
+// predictor and clock (see controlpolicies.h).
+template <typename Policy, typename Predictor = RandomDriftPredictor, typename Clock = ThreadSleepClock>
+class BasicControlIQ {
     private:
         InsulinPump *insulinPump;
         CGM *glucoseMonitor;
         std::atomic<bool> running;
         std::atomic<Profile*> currentProfile;
         std::thread workerThread;
+        qint64 lastRecordedReading; // getLastReadingTime() of the reading last recorded in cgmToDelivery
+        Policy policy;
+        Predictor predictor;
 
         void run();
-        void autoAdjustInsulinDelivery(double currentGlucoseLevel);
-        double predictGlucoseLevel(double currentGlucoseLevel);
-        double calculateCorrectionBolus(double currentGlucoseLevel);
-        
+
     public:
-        ControlIQ(InsulinPump *pump, Profile *profile, CGM *monitor);
-        ~ControlIQ();
+        BasicControlIQ(InsulinPump *pump, Profile *profile, CGM *monitor);
+        ~BasicControlIQ();
 
         void start();
         void stop();
         void setProfile(Profile *profile);
+
+        // One iteration of the control loop (CGM reading plus decision). The worker thread calls it
+        // after start(); without start() an external clock such as TickDispatcher can drive it.
+        void tick();
+
+        // One controller decision. Takes the profile explicitly so simulations and benchmarks can
+        // step the controller in a tight loop without going through the atomic profile pointer.
+        void autoAdjustInsulinDelivery(const Profile &profile, double currentGlucoseLevel) {
+            HOT_PATH(AllocationSubsystem::Controller);
+            double predictedGlucoseLevel = predictor.predict(currentGlucoseLevel);
+            policy.apply(*insulinPump, profile, currentGlucoseLevel, predictedGlucoseLevel);
+        }
 };
 
-#endif // CONTROLIQ_H
\ No newline at end of file
+// The controller used by the pump UI.
+typedef BasicControlIQ<ThresholdLadderPolicy<> > ControlIQ;
+
+template <typename Policy, typename Predictor, typename Clock>
+BasicControlIQ<Policy, Predictor, Clock>::BasicControlIQ(InsulinPump *pump, Profile *profile, CGM *monitor)
+    : insulinPump(pump), glucoseMonitor(monitor), running(false), lastRecordedReading(0)
+{
+    currentProfile.store(profile);
+}
+
+template <typename Policy, typename Predictor, typename Clock>
+BasicControlIQ<Policy, Predictor, Clock>::~BasicControlIQ() {
+    stop(); // Ensure the thread stops if the object is destroyed
+}
+
+template <typename Policy, typename Predictor, typename Clock>
+void BasicControlIQ<Policy, Predictor, Clock>::start() {
+    if (running.load()) return;
+    running = true;
+
+    workerThread = std::thread(&BasicControlIQ::run, this);
+}
+
+template <typename Policy, typename Predictor, typename Clock>
+void BasicControlIQ<Policy, Predictor, Clock>::stop() {
+    if (running.load()) {
+        running = false;
+        if (workerThread.joinable()) {
+            workerThread.join();
+        }
+    }
+}
+
+template <typename Policy, typename Predictor, typename Clock>
+void BasicControlIQ<Policy, Predictor, Clock>::setProfile(Profile *profile) {
+    currentProfile.store(profile);
+}
+
+template <typename Policy, typename Predictor, typename Clock>
+void BasicControlIQ<Policy, Predictor, Clock>::tick() {
+    // Need to get glucose reading from CGM
+    double glucoseLevel = glucoseMonitor->getGlucoseLevel();
+    {
+        LatencyTimer decisionTimer(Latency::controlIQDecision);
+        TraceSpan span("ControlIQ decision", "control");
+        autoAdjustInsulinDelivery(*currentProfile.load(), glucoseLevel);
+    }
+    // Only the first decision on a reading measures CGM-to-delivery; later ticks on the same
+    // reading would record ever-growing latencies.
+    qint64 readingTime = glucoseMonitor->getLastReadingTime();
+    if (readingTime > 0 && readingTime != lastRecordedReading) {
+        Latency::cgmToDelivery.record(LatencyHistogram::now() - readingTime);
+        lastRecordedReading = readingTime;
+    }
+}
+
+template <typename Policy, typename Predictor, typename Clock>
+void BasicControlIQ<Policy, Predictor, Clock>::run() {
+    Tracing::setThreadName("ControlIQ");
+    while(running.load()) {
+        tick();
+
+        // Instead of sleeping for 1 second in one go, break the sleep into 100-millisecond intervals.
+        // This allows the loop to check the 'running' flag more frequently, so stop() can be more responsive.
+        for (int i = 0; i < 10 && running.load(); ++i) {
+            Clock::sleepFor(std::chrono::milliseconds(100));
+        }
+    }
+}
+
+// Instantiated once in controliq.cpp; other files link against that copy instead of compiling their own.
+extern template class BasicControlIQ<ThresholdLadderPolicy<> >;
+
+#endif // CONTROLIQ_H
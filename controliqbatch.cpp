@@ -0,0 +1,114 @@
+#include "controliqbatch.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define CONTROLIQ_BATCH_X86
+#include <immintrin.h>
+#endif
+
+static void adjustScalar(const ControlIQBatch &b, int begin) {
+    for (int i = begin; i < b.count; ++i) {
+        controlIQDecide(b.predictedGlucose[i], b.currentGlucose[i], b.currentBasal[i],
+                        b.profileBasal[i], b.targetGlucose[i], b.correctionFactor[i],
+                        b.newBasal[i], b.correctionBolus[i]);
+    }
+}
+
+#ifdef CONTROLIQ_BATCH_X86
+
+// Each kernel mirrors controlIQDecide lane by lane: same operations, same order, with the
+// ternaries turned into compare masks and blends. Ordered compares are false for NaN like the scalar ones.
+
+__attribute__((target("avx2")))
+static int adjustAVX2(const ControlIQBatch &b) {
+    typedef ControlIQThresholds T;
+    const __m256d correctionLevel = _mm256_set1_pd(T::correction);
+    const __m256d increaseLevel = _mm256_set1_pd(T::increase);
+    const __m256d maintainLevel = _mm256_set1_pd(T::maintain);
+    const __m256d decreaseLevel = _mm256_set1_pd(T::decrease);
+    const __m256d step = _mm256_set1_pd(T::basalStep);
+    const __m256d decreaseBy = _mm256_set1_pd(T::basalDecrease);
+    const __m256d zero = _mm256_setzero_pd();
+
+    int i = 0;
+    for (; i + 4 <= b.count; i += 4) {
+        __m256d predicted = _mm256_loadu_pd(b.predictedGlucose + i);
+        __m256d current = _mm256_loadu_pd(b.currentGlucose + i);
+        __m256d basalNow = _mm256_loadu_pd(b.currentBasal + i);
+        __m256d profileBasal = _mm256_loadu_pd(b.profileBasal + i);
+        __m256d target = _mm256_loadu_pd(b.targetGlucose + i);
+        __m256d factor = _mm256_loadu_pd(b.correctionFactor + i);
+
+        __m256d correctionDose = _mm256_div_pd(_mm256_sub_pd(current, target), factor);
+        __m256d canDecrease = _mm256_cmp_pd(basalNow, decreaseBy, _CMP_GT_OQ);
+        __m256d decreased = _mm256_blendv_pd(basalNow, _mm256_sub_pd(basalNow, decreaseBy), canDecrease);
+
+        __m256d aboveCorrection = _mm256_cmp_pd(predicted, correctionLevel, _CMP_GT_OQ);
+        __m256d basal = _mm256_blendv_pd(zero, decreased, _mm256_cmp_pd(predicted, decreaseLevel, _CMP_GT_OQ));
+        basal = _mm256_blendv_pd(basal, profileBasal, _mm256_cmp_pd(predicted, maintainLevel, _CMP_GT_OQ));
+        basal = _mm256_blendv_pd(basal, _mm256_add_pd(basalNow, step), _mm256_cmp_pd(predicted, increaseLevel, _CMP_GT_OQ));
+        basal = _mm256_blendv_pd(basal, basalNow, aboveCorrection);
+
+        _mm256_storeu_pd(b.newBasal + i, basal);
+        _mm256_storeu_pd(b.correctionBolus + i, _mm256_blendv_pd(zero, correctionDose, aboveCorrection));
+    }
+    return i;
+}
+
+__attribute__((target("avx512f")))
+static int adjustAVX512(const ControlIQBatch &b) {
+    typedef ControlIQThresholds T;
+    const __m512d correctionLevel = _mm512_set1_pd(T::correction);
+    const __m512d increaseLevel = _mm512_set1_pd(T::increase);
+    const __m512d maintainLevel = _mm512_set1_pd(T::maintain);
+    const __m512d decreaseLevel = _mm512_set1_pd(T::decrease);
+    const __m512d step = _mm512_set1_pd(T::basalStep);
+    const __m512d decreaseBy = _mm512_set1_pd(T::basalDecrease);
+    const __m512d zero = _mm512_setzero_pd();
+
+    int i = 0;
+    for (; i + 8 <= b.count; i += 8) {
+        __m512d predicted = _mm512_loadu_pd(b.predictedGlucose + i);
+        __m512d current = _mm512_loadu_pd(b.currentGlucose + i);
+        __m512d basalNow = _mm512_loadu_pd(b.currentBasal + i);
+        __m512d profileBasal = _mm512_loadu_pd(b.profileBasal + i);
+        __m512d target = _mm512_loadu_pd(b.targetGlucose + i);
+        __m512d factor = _mm512_loadu_pd(b.correctionFactor + i);
+
+        __m512d correctionDose = _mm512_div_pd(_mm512_sub_pd(current, target), factor);
+        __mmask8 canDecrease = _mm512_cmp_pd_mask(basalNow, decreaseBy, _CMP_GT_OQ);
+        __m512d decreased = _mm512_mask_blend_pd(canDecrease, basalNow, _mm512_sub_pd(basalNow, decreaseBy));
+
+        __mmask8 aboveCorrection = _mm512_cmp_pd_mask(predicted, correctionLevel, _CMP_GT_OQ);
+        __m512d basal = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(predicted, decreaseLevel, _CMP_GT_OQ), zero, decreased);
+        basal = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(predicted, maintainLevel, _CMP_GT_OQ), basal, profileBasal);
+        basal = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(predicted, increaseLevel, _CMP_GT_OQ), basal, _mm512_add_pd(basalNow, step));
+        basal = _mm512_mask_blend_pd(aboveCorrection, basal, basalNow);
+
+        _mm512_storeu_pd(b.newBasal + i, basal);
+        _mm512_storeu_pd(b.correctionBolus + i, _mm512_mask_blend_pd(aboveCorrection, zero, correctionDose));
+    }
+    return i;
+}
+
+#endif // CONTROLIQ_BATCH_X86
+
+void controlIQAdjustBatch(const ControlIQBatch &batch, ControlIQKernel kernel) {
+    int done = 0;
+
+#ifdef CONTROLIQ_BATCH_X86
+    bool hasAVX512 = __builtin_cpu_supports("avx512f");
+    bool hasAVX2 = __builtin_cpu_supports("avx2");
+    if (kernel == ControlIQKernel::Auto)
+        kernel = hasAVX512 ? ControlIQKernel::AVX512 : (hasAVX2 ? ControlIQKernel::AVX2 : ControlIQKernel::Scalar);
+
+    if (kernel == ControlIQKernel::AVX512 && hasAVX512)
+        done = adjustAVX512(batch);
+    else if (kernel == ControlIQKernel::AVX2 && hasAVX2)
+        done = adjustAVX2(batch);
+#else
+    (void)kernel;
+#endif
+
+    // Remainder lanes (and everything on other targets) go through the scalar path.
+    adjustScalar(batch, done);
+}
@@ -0,0 +1,61 @@
+#ifndef CONTROLIQBATCH_H
+#define CONTROLIQBATCH_H
+
+// Control-IQ threshold ladder (mmol/L). Controllers take their thresholds as a type, so a
+// custom ladder is a struct with the same members and is folded in at compile time.
+struct ControlIQThresholds {
+    static constexpr double correction = 10.0;    // above: deliver an automatic correction bolus
+    static constexpr double increase = 8.9;       // above: increase basal by basalStep
+    static constexpr double maintain = 6.25;      // above: use the profile basal rate
+    static constexpr double decrease = 3.9;       // above: decrease basal by basalDecrease, otherwise suspend
+    static constexpr double basalStep = 0.25;
+    static constexpr double basalDecrease = 1.0;
+};
+
+// One Control-IQ decision. Written without branches (selects only) so the scalar and the
+// SIMD kernels perform exactly the same floating point operations and agree bit for bit
+// (tests/controliqbatch checks every kernel against this function).
+// correctionBolus is only meaningful above Thresholds::correction and 0 otherwise;
+// a non-positive correction means nothing is delivered.
+template <typename Thresholds = ControlIQThresholds>
+inline void controlIQDecide(double predictedGlucose, double currentGlucose, double currentBasal,
+                            double profileBasal, double targetGlucose, double correctionFactor,
+                            double &newBasal, double &correctionBolus)
+{
+    double correctionDose = (currentGlucose - targetGlucose) / correctionFactor;
+    double decreased = currentBasal > Thresholds::basalDecrease ? currentBasal - Thresholds::basalDecrease : currentBasal;
+
+    double basal = predictedGlucose > Thresholds::decrease ? decreased : 0.0;
+    basal = predictedGlucose > Thresholds::maintain ? profileBasal : basal;
+    basal = predictedGlucose > Thresholds::increase ? currentBasal + Thresholds::basalStep : basal;
+    basal = predictedGlucose > Thresholds::correction ? currentBasal : basal;
+
+    newBasal = basal;
+    correctionBolus = predictedGlucose > Thresholds::correction ? correctionDose : 0.0;
+}
+
+// Structure-of-arrays input/output for a population of patients. All arrays hold count elements.
+struct ControlIQBatch {
+    const double *predictedGlucose = nullptr;
+    const double *currentGlucose = nullptr;
+    const double *currentBasal = nullptr;
+    const double *profileBasal = nullptr;
+    const double *targetGlucose = nullptr;
+    const double *correctionFactor = nullptr;
+    double *newBasal = nullptr;
+    double *correctionBolus = nullptr;
+    int count = 0;
+};
+
+enum class ControlIQKernel {
+    Auto,    // widest instruction set supported by the running CPU
+    Scalar,
+    AVX2,
+    AVX512
+};
+
+// Runs controlIQDecide over the whole batch. Requesting a kernel the CPU (or compiler) does not
+// support falls back to the scalar one.
+void controlIQAdjustBatch(const ControlIQBatch &batch, ControlIQKernel kernel = ControlIQKernel::Auto);
+
+#endif // CONTROLIQBATCH_H
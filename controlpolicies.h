@@ -0,0 +1,116 @@
+#ifndef CONTROLPOLICIES_H
+#define CONTROLPOLICIES_H
+
+#include "insulinpump.h"
+#include "profile.h"
+#include "controliqbatch.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+// Building blocks for BasicControlIQ (controliq.h). Everything is selected through template
+// parameters, so a controller variant costs no virtual calls and its constants fold at compile time.
+//
+// Policy:    void apply(InsulinPump &pump, const Profile &profile, double currentGlucose, double predictedGlucose)
+// Predictor: double predict(double currentGlucose)
+// Clock:     static void sleepFor(std::chrono::milliseconds duration)
+
+// ---- Predictors ----
+
+// Current reading plus a random drift between -0.5 and 1 mmol/L (the original Control-IQ prediction).
+struct RandomDriftPredictor {
+    double predict(double currentGlucoseLevel);
+};
+
+// Assumes glucose stays where it is; handy for deterministic runs.
+struct PersistencePredictor {
+    double predict(double currentGlucoseLevel) { return currentGlucoseLevel; }
+};
+
+// ---- Clocks ----
+
+struct ThreadSleepClock {
+    static void sleepFor(std::chrono::milliseconds duration) { std::this_thread::sleep_for(duration); }
+};
+
+// Never waits, for simulations that run as fast as possible.
+struct NoWaitClock {
+    static void sleepFor(std::chrono::milliseconds) {}
+};
+
+// ---- Controller policies ----
+
+// The Control-IQ threshold ladder, see controlIQDecide.
+template <typename Thresholds = ControlIQThresholds>
+struct ThresholdLadderPolicy {
+    void apply(InsulinPump &pump, const Profile &profile, double currentGlucose, double predictedGlucose) {
+        double newBasalRate, correctionBolus;
+        controlIQDecide<Thresholds>(predictedGlucose, currentGlucose, pump.getBasalRate(),
+                                    profile.basalRate, profile.targetGlucoseLevel, profile.correctionFactor,
+                                    newBasalRate, correctionBolus);
+
+        if (predictedGlucose > Thresholds::correction) {
+            // deliver automatic correction
+            pump.controlIQDeliver(correctionBolus);
+        } else {
+            // increase, maintain, decrease or stop basal insulin delivery
+            pump.setBasalRate(newBasalRate);
+        }
+    }
+};
+
+struct DefaultPIDGains {
+    static constexpr double proportional = 0.4;   // u/hr per mmol/L above target
+    static constexpr double integral = 0.02;      // u/hr per mmol/L accumulated each step
+    static constexpr double derivative = 0.8;     // u/hr per mmol/L change between steps
+    static constexpr double maxBasalFactor = 3.0; // basal is limited to this multiple of the profile rate
+};
+
+// Basal around the profile rate, driven by the predicted error from the profile target.
+template <typename Gains = DefaultPIDGains>
+struct PIDPolicy {
+    double integralError = 0;
+    double previousError = 0;
+
+    void apply(InsulinPump &pump, const Profile &profile, double, double predictedGlucose) {
+        double error = predictedGlucose - profile.targetGlucoseLevel;
+        integralError += error;
+        double rate = profile.basalRate
+                      + Gains::proportional * error
+                      + Gains::integral * integralError
+                      + Gains::derivative * (error - previousError);
+        previousError = error;
+
+        double maxRate = profile.basalRate * Gains::maxBasalFactor;
+        pump.setBasalRate(std::max(0.0, std::min(rate, maxRate)));
+    }
+};
+
+struct DefaultMPCSettings {
+    static constexpr int horizon = 6;                 // steps of 5 minutes looked ahead
+    static constexpr double insulinPenalty = 0.05;    // cost per (u/hr)^2 of basal
+    static constexpr double candidateFactors[5] = {0.0, 0.5, 1.0, 1.5, 2.0}; // times the profile basal
+};
+
+// Small model predictive controller: tries a fixed set of basal rates, predicts glucose over the
+// horizon with the profile correction factor and keeps the rate with the lowest cost.
+template <typename Settings = DefaultMPCSettings>
+struct MPCPolicy {
+    void apply(InsulinPump &pump, const Profile &profile, double, double predictedGlucose) {
+        double bestRate = profile.basalRate;
+        double bestCost = -1;
+        for (double factor : Settings::candidateFactors) {
+            double rate = profile.basalRate * factor;
+            double glucose = predictedGlucose - Settings::horizon * (rate / 12.0) * profile.correctionFactor;
+            double error = glucose - profile.targetGlucoseLevel;
+            double cost = error * error + Settings::insulinPenalty * rate * rate;
+            if (bestCost < 0 || cost < bestCost) {
+                bestCost = cost;
+                bestRate = rate;
+            }
+        }
+        pump.setBasalRate(bestRate);
+    }
+};
+
+#endif // CONTROLPOLICIES_H
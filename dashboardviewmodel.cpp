@@ -0,0 +1,80 @@
+#include "dashboardviewmodel.h"
+#include <cmath>
+
+static QString levelStyle(DashboardState::Level level) {
+    switch (level) {
+        case DashboardState::Good: return "color: #55cc55; font-weight: bold;";
+        case DashboardState::Low: return "color: #ffaa00; font-weight: bold;";
+        default: return "color: #ff4444; font-weight: bold;";
+    }
+}
+
+DashboardViewModel::DashboardViewModel(QLabel *reservoirLabel, QLabel *basalRateLabel, QLabel *batteryLabel, QLabel *glucoseLabel)
+    : reservoirLabel(reservoirLabel), basalRateLabel(basalRateLabel), batteryLabel(batteryLabel),
+      glucoseLabel(glucoseLabel), hasShown(false), updates(0)
+{
+}
+
+DashboardState DashboardViewModel::snapshot(const InsulinPump &pump, CGM &monitor, int batteryPercent) {
+    DashboardState state;
+
+    Milliunits remaining = pump.getInsulinRemainingMilliunits();
+    state.reservoirTenths = int((remaining + 50) / 100);
+    if (remaining > 50 * milliunitsPerUnit)
+        state.reservoirLevel = DashboardState::Good;
+    else if (remaining > 20 * milliunitsPerUnit)
+        state.reservoirLevel = DashboardState::Low;
+    else
+        state.reservoirLevel = DashboardState::Critical;
+
+    state.basalHundredths = int((pump.getBasalRateMilliunits() + 5) / 10);
+
+    state.batteryPercent = batteryPercent;
+    if (batteryPercent > 50)
+        state.batteryLevel = DashboardState::Good;
+    else if (batteryPercent > 20)
+        state.batteryLevel = DashboardState::Low;
+    else
+        state.batteryLevel = DashboardState::Critical;
+
+    state.glucoseTenths = int(std::lround(monitor.getGlucoseLevel() * 10.0));
+    return state;
+}
+
+void DashboardViewModel::apply(const DashboardState &state) {
+    if (!hasShown || state.reservoirTenths != shown.reservoirTenths) {
+        reservoirLabel->setText(QString::number(state.reservoirTenths / 10.0, 'f', 1) + " u");
+        ++updates;
+    }
+    if (!hasShown || state.reservoirLevel != shown.reservoirLevel) {
+        reservoirLabel->setStyleSheet(levelStyle(state.reservoirLevel));
+        ++updates;
+    }
+    if (!hasShown || state.basalHundredths != shown.basalHundredths) {
+        basalRateLabel->setText("Basal: " + QString::number(state.basalHundredths / 100.0, 'f', 2) + " u/hr");
+        ++updates;
+    }
+    if (!hasShown || state.batteryPercent != shown.batteryPercent) {
+        batteryLabel->setText(QString::number(state.batteryPercent) + "%");
+        ++updates;
+    }
+    if (!hasShown || state.batteryLevel != shown.batteryLevel) {
+        batteryLabel->setStyleSheet(levelStyle(state.batteryLevel));
+        ++updates;
+    }
+    if (!hasShown || state.glucoseTenths != shown.glucoseTenths) {
+        glucoseLabel->setText("Glucose: " + QString::number(state.glucoseTenths / 10.0, 'f', 1) + " mmol/L");
+        ++updates;
+    }
+
+    shown = state;
+    hasShown = true;
+}
+
+void DashboardViewModel::invalidate() {
+    hasShown = false;
+}
+
+quint64 DashboardViewModel::widgetUpdates() const {
+    return updates;
+}
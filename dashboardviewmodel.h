@@ -0,0 +1,45 @@
+#ifndef DASHBOARDVIEWMODEL_H
+#define DASHBOARDVIEWMODEL_H
+
+#include <QLabel>
+#include "insulinpump.h"
+#include "cgm.h"
+
+// Everything the home page shows, quantised to what is displayed, so two snapshots only differ
+// when a widget would actually change.
+struct DashboardState {
+    enum Level { Good, Low, Critical }; // green, orange, red
+
+    int reservoirTenths = -1;     // 0.1 u
+    Level reservoirLevel = Good;
+    int basalHundredths = -1;     // 0.01 u/hr
+    int batteryPercent = -1;
+    Level batteryLevel = Good;
+    int glucoseTenths = -1;       // 0.1 mmol/L
+};
+
+// Pushes a DashboardState to the home page widgets, touching only the properties that changed
+// since the last push. Setting a stylesheet re-polishes the widget, so in steady state the
+// dashboard costs a few integer compares per tick.
+class DashboardViewModel {
+    private:
+        QLabel *reservoirLabel;
+        QLabel *basalRateLabel;
+        QLabel *batteryLabel;
+        QLabel *glucoseLabel;
+        DashboardState shown;
+        bool hasShown;
+        quint64 updates;
+
+    public:
+        DashboardViewModel(QLabel *reservoirLabel, QLabel *basalRateLabel, QLabel *batteryLabel, QLabel *glucoseLabel);
+
+        static DashboardState snapshot(const InsulinPump &pump, CGM &monitor, int batteryPercent);
+
+        void apply(const DashboardState &state);
+        void invalidate(); // next apply() pushes everything
+
+        quint64 widgetUpdates() const;
+};
+
+#endif // DASHBOARDVIEWMODEL_H
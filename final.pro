@@ -4,27 +4,69 @@ greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 CONFIG += c++11
 
+# qmake CONFIG+=count_allocations: count heap allocations per subsystem and abort if the
+# dosing hot path allocates (see allocationcounter.h).
+count_allocations: DEFINES += INSULINPUMP_COUNT_ALLOCATIONS
+
+# Lets qcustomplot.cpp report its replot phases to tracing.h.
+DEFINES += INSULINPUMP_TRACING
+
+# shm_open lives in librt on older glibc.
+linux: LIBS += -lrt
+
 # You can make your code fail to compile if it uses deprecated APIs.
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    alertcenter.cpp \
+    allocationcounter.cpp \
     cgm.cpp \
+    cgmreplay.cpp \
     controliq.cpp \
+    controliqbatch.cpp \
+    dashboardviewmodel.cpp \
     insulinpump.cpp \
+    latencyhistogram.cpp \
     main.cpp \
     mainwindow.cpp \
     profile.cpp \
-    qcustomplot.cpp
+    profilesweep.cpp \
+    pumpserver.cpp \
+    qcustomplot.cpp \
+    simulationbranch.cpp \
+    simulationstore.cpp \
+    telemetrybus.cpp \
+    tickdispatcher.cpp \
+    tracing.cpp \
+    trajectorydensity.cpp
 
 HEADERS += \
+    alertcenter.h \
+    allocationcounter.h \
     cgm.h \
+    cgmreplay.h \
     clickablelabel.h \
     controliq.h \
+    controliqbatch.h \
+    controlpolicies.h \
+    dashboardviewmodel.h \
     insulinpump.h \
+    latencyhistogram.h \
     mainwindow.h \
+    milliunits.h \
+    parallelworkers.h \
     profile.h \
-    qcustomplot.h
+    profilesweep.h \
+    pumpserver.h \
+    qcustomplot.h \
+    sharedseries.h \
+    simulationbranch.h \
+    simulationstore.h \
+    telemetrybus.h \
+    tickdispatcher.h \
+    tracing.h \
+    trajectorydensity.h
 
 FORMS += \
     mainwindow.ui
@@ -1,10 +1,30 @@
 #include "insulinpump.h"
+#include "allocationcounter.h"
+#include "latencyhistogram.h"
+#include "tracing.h"
+#include "telemetrybus.h"
 #include <QTime>
+#include <mutex>
+
+static const char *deliveryTypeName(DeliveryType type) {
+    switch (type) {
+        case DeliveryType::Basal: return "Basal";
+        case DeliveryType::Bolus: return "Bolus";
+        case DeliveryType::ControlIQCorrection: return "ControlIQ Correction Bolus";
+        case DeliveryType::CartridgeRefill: return "Cartridge Refilled";
+    }
+    return "";
+}
 
 InsulinPump::InsulinPump(CGM *monitor) {
-    insulinRemaining = 350.0;
-    basalRate = 0.5;
+    static std::once_flag historyReserved;
+    std::call_once(historyReserved, []() { SharedSeries<DeliveryRecord>::reserveChunks(reservedHistoryChunks); });
+
+    insulinRemaining = 350 * milliunitsPerUnit;
+    basalRate = milliunitsPerUnit / 2;
+    basalCarry = 0;
     glucoseMonitor = monitor;
+    telemetry = nullptr;
 }
 
 double InsulinPump::calculateBolus(double glucose, double carbs, double targetGlucose, double insulinSensitivity, double carbRatio) {
@@ -17,41 +37,103 @@ double InsulinPump::calculateBolus(double glucose, double carbs, double targetGl
     return (totalDose > 0) ? totalDose : 0;
 }
 
-bool InsulinPump::administerInsulin(double dose, const QString &type) {
-    if (dose <= 0.000 || dose > insulinRemaining)
+bool InsulinPump::administerInsulin(double dose, DeliveryType type) {
+    if (!isValidUnits(dose))
+        return false;
+    return administerMilliunits(toMilliunits(dose), type);
+}
+
+bool InsulinPump::administerMilliunits(Milliunits dose, DeliveryType type) {
+    LatencyTimer latencyTimer(Latency::administerInsulin);
+    TraceSpan span("Delivery", "deliver", deliveryTypeName(type));
+    HOT_PATH(AllocationSubsystem::Pump);
+    if (dose <= 0 || dose > insulinRemaining)
         return false;
 
     insulinRemaining -= dose;
     logDelivery(dose, type);
-    glucoseMonitor->injectInsulin(dose);
+    glucoseMonitor->injectInsulin(toUnits(dose));
+    if (telemetry)
+        telemetry->publish(TelemetryKind::Delivery, toUnits(dose), quint32(type));
     return true;
 }
 
-void InsulinPump::logDelivery(double insulinAmount, const QString &type) {
-    QString entry = QTime::currentTime().toString("hh:mm:ss") + ": " + type + " Delivered: " + QString::number(insulinAmount, 'f', 2) + " units";
-    history.append(entry);
+// Delivers one tick of basal. The hourly rate rarely divides evenly into ticks, so the remainder
+// is carried into the next tick; over an hour exactly basalRate milliunits are delivered.
+Milliunits InsulinPump::deliverBasalTick() {
+    SharedSeries<DeliveryRecord>::topUpChunks(historyLowWaterChunks, reservedHistoryChunks);
+    HOT_PATH(AllocationSubsystem::Pump);
+    Milliunits total = basalRate + basalCarry;
+    Milliunits dose = total / basalTicksPerHour;
+
+    if (dose > 0 && !administerMilliunits(dose, DeliveryType::Basal))
+        return 0; // not enough insulin, keep the carry for later
+
+    basalCarry = total - dose * basalTicksPerHour;
+    return dose;
+}
+
+void InsulinPump::logDelivery(Milliunits insulinAmount, DeliveryType type) {
+    DeliveryRecord record;
+    record.timeOfDay = QTime::currentTime().msecsSinceStartOfDay();
+    record.amount = insulinAmount;
+    record.type = type;
+    history.append(record);
 }
 
 QString InsulinPump::getHistory() const {
-    return history.join("\n");
+    QStringList entries;
+    history.forEach([&entries](const DeliveryRecord &record) {
+        entries.append(QTime::fromMSecsSinceStartOfDay(record.timeOfDay).toString("hh:mm:ss") + ": "
+                       + deliveryTypeName(record.type) + " Delivered: " + QString::number(toUnits(record.amount), 'f', 2) + " units");
+    });
+    return entries.join("\n");
+}
+
+void InsulinPump::setGlucoseMonitor(CGM *monitor) {
+    glucoseMonitor = monitor;
+}
+
+void InsulinPump::setTelemetry(TelemetryBus *bus) {
+    telemetry = bus;
 }
 
+// NaN, infinite and out of range rates are ignored and leave the current rate in place.
 void InsulinPump::setBasalRate(double rate) {
-    basalRate = rate;
+    if (!isValidUnits(rate))
+        return;
+    setBasalRateMilliunits(toMilliunits(rate));
 }
 
 double InsulinPump::getBasalRate() {
+    return toUnits(basalRate);
+}
+
+void InsulinPump::setBasalRateMilliunits(Milliunits rate) {
+    Milliunits newRate = rate > 0 ? rate : 0;
+    if (telemetry && newRate != basalRate)
+        telemetry->publish(TelemetryKind::BasalChange, toUnits(newRate));
+    basalRate = newRate;
+}
+
+Milliunits InsulinPump::getBasalRateMilliunits() const {
     return basalRate;
 }
 
 void InsulinPump::refillCartridge() {
-    insulinRemaining = 200.0;
-    logDelivery(0, "Cartridge Refilled");
+    insulinRemaining = 200 * milliunitsPerUnit;
+    logDelivery(0, DeliveryType::CartridgeRefill);
 }
 
 double InsulinPump::getInsulinRemaining() const {
+    return toUnits(insulinRemaining);
+}
+
+Milliunits InsulinPump::getInsulinRemainingMilliunits() const {
     return insulinRemaining;
 }
+
 bool InsulinPump::controlIQDeliver(double units) {
-    return administerInsulin(units, "ControlIQ Correction Bolus");
+    HOT_PATH(AllocationSubsystem::Pump);
+    return administerInsulin(units, DeliveryType::ControlIQCorrection);
 }
@@ -4,28 +4,64 @@
 #include <QString>
 #include <QStringList>
 #include "cgm.h"
+#include "milliunits.h"
+#include "sharedseries.h"
+
+class TelemetryBus;
+
+enum class DeliveryType {
+    Basal,
+    Bolus,
+    ControlIQCorrection,
+    CartridgeRefill
+};
+
+// One history entry. Plain data so logging a delivery never allocates; text is only built in getHistory().
+struct DeliveryRecord {
+    int timeOfDay = 0; // milliseconds since midnight
+    Milliunits amount = 0;
+    DeliveryType type = DeliveryType::Basal;
+};
 
 class InsulinPump {
 private:
-    double insulinRemaining;
-    double basalRate;
-    QStringList history;
+    Milliunits insulinRemaining;
+    Milliunits basalRate;     // milliunits per hour
+    Milliunits basalCarry;    // undelivered remainder of previous basal ticks, in 1/basalTicksPerHour mU
+    SharedSeries<DeliveryRecord> history;
     CGM *glucoseMonitor;
+    TelemetryBus *telemetry;
 
 public:
+    // Basal is delivered in this many ticks per hour (every 5 minutes).
+    static const int basalTicksPerHour = 12;
+    // History chunks preallocated by the first pump (256 records each). deliverBasalTick() adds
+    // another reservedHistoryChunks, before its allocation-free part, whenever fewer than
+    // historyLowWaterChunks are left, so the history can grow without bound. Deliveries between two
+    // basal ticks must fit in historyLowWaterChunks or they fall back to the heap.
+    static const int reservedHistoryChunks = 256;
+    static const int historyLowWaterChunks = 16;
+
     InsulinPump(CGM *monitor);
 
     double calculateBolus(double glucose, double carbs, double targetGlucose, double insulinSensitivity, double carbRatio);
-    bool administerInsulin(double dose, const QString &type);
+    bool administerInsulin(double dose, DeliveryType type);
+    bool administerMilliunits(Milliunits dose, DeliveryType type);
+    Milliunits deliverBasalTick();
 
     void setBasalRate(double rate);
     double getBasalRate();
+    void setBasalRateMilliunits(Milliunits rate);
+    Milliunits getBasalRateMilliunits() const;
 
     void refillCartridge();
     double getInsulinRemaining() const;
+    Milliunits getInsulinRemainingMilliunits() const;
 
-    void logDelivery(double insulinAmount, const QString &type);
+    void logDelivery(Milliunits insulinAmount, DeliveryType type);
     QString getHistory() const;
+    void setGlucoseMonitor(CGM *monitor);
+    void setTelemetry(TelemetryBus *bus); // publishes deliveries and basal changes, nullptr to stop
     bool controlIQDeliver(double units);
 
 };
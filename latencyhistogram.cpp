@@ -0,0 +1,134 @@
+#include "latencyhistogram.h"
+#include <QStringList>
+#include <QtCore/qalgorithms.h>
+
+namespace Latency {
+    LatencyHistogram controlIQDecision("ControlIQ decision");
+    LatencyHistogram cgmToDelivery("CGM reading to delivery");
+    LatencyHistogram administerInsulin("InsulinPump::administerInsulin");
+    LatencyHistogram saveHistory("saveHistoryToFile");
+    LatencyHistogram replot("QCustomPlot::replot");
+    LatencyHistogram tickDrift("Tick drift");
+    LatencyHistogram alertDisplay("Alert raise to display");
+}
+
+static std::atomic<LatencyHistogram*> histograms[LatencyHistogram::maxHistograms];
+static std::atomic<int> histogramCount(0);
+static std::atomic<int> nextThreadRow(0);
+
+LatencyHistogram::LatencyHistogram(const char *name) : histogramName(name), maxValue(0) {
+    reset();
+    int slot = histogramCount.fetch_add(1);
+    if (slot < maxHistograms)
+        histograms[slot].store(this);
+}
+
+qint64 LatencyHistogram::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int LatencyHistogram::threadRow() {
+    static thread_local int row = nextThreadRow.fetch_add(1) % maxThreads;
+    return row;
+}
+
+int LatencyHistogram::bucketIndex(qint64 nanoseconds) {
+    if (nanoseconds < subBuckets)
+        return nanoseconds > 0 ? int(nanoseconds) : 0;
+
+    int exponent = 63 - int(qCountLeadingZeroBits(quint64(nanoseconds)));
+    if (exponent > maxExponent)
+        return bucketCount - 1;
+    int subBucket = int((nanoseconds >> (exponent - subBucketBits)) & (subBuckets - 1));
+    return (exponent - subBucketBits + 1) * subBuckets + subBucket;
+}
+
+qint64 LatencyHistogram::bucketUpperBound(int index) {
+    if (index < subBuckets)
+        return index;
+
+    int exponent = index / subBuckets + subBucketBits - 1;
+    int subBucket = index % subBuckets;
+    qint64 width = qint64(1) << (exponent - subBucketBits);
+    return (qint64(1) << exponent) + (subBucket + 1) * width - 1;
+}
+
+void LatencyHistogram::record(qint64 nanoseconds) {
+    buckets[threadRow()][bucketIndex(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+
+    qint64 currentMax = maxValue.load(std::memory_order_relaxed);
+    while (nanoseconds > currentMax && !maxValue.compare_exchange_weak(currentMax, nanoseconds, std::memory_order_relaxed)) {}
+}
+
+void LatencyHistogram::reset() {
+    for (int row = 0; row < maxThreads; ++row) {
+        for (int i = 0; i < bucketCount; ++i)
+            buckets[row][i].store(0, std::memory_order_relaxed);
+    }
+    maxValue.store(0, std::memory_order_relaxed);
+}
+
+const char *LatencyHistogram::name() const {
+    return histogramName;
+}
+
+quint64 LatencyHistogram::count() const {
+    quint64 total = 0;
+    for (int row = 0; row < maxThreads; ++row) {
+        for (int i = 0; i < bucketCount; ++i)
+            total += buckets[row][i].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+qint64 LatencyHistogram::max() const {
+    return maxValue.load(std::memory_order_relaxed);
+}
+
+qint64 LatencyHistogram::percentile(double fraction) const {
+    quint64 merged[bucketCount] = {};
+    quint64 total = 0;
+    for (int row = 0; row < maxThreads; ++row) {
+        for (int i = 0; i < bucketCount; ++i) {
+            quint64 n = buckets[row][i].load(std::memory_order_relaxed);
+            merged[i] += n;
+            total += n;
+        }
+    }
+    if (total == 0)
+        return 0;
+
+    quint64 rank = quint64(fraction * total);
+    if (rank >= total)
+        rank = total - 1;
+    quint64 seen = 0;
+    for (int i = 0; i < bucketCount; ++i) {
+        seen += merged[i];
+        if (seen > rank)
+            return qMin(bucketUpperBound(i), max());
+    }
+    return max();
+}
+
+static QString formatMicroseconds(qint64 nanoseconds) {
+    return QString::number(nanoseconds / 1000.0, 'f', 1) + "us";
+}
+
+QString LatencyHistogram::summary() const {
+    return QString(histogramName) + ": n=" + QString::number(count())
+           + " p50=" + formatMicroseconds(percentile(0.50))
+           + " p99=" + formatMicroseconds(percentile(0.99))
+           + " p999=" + formatMicroseconds(percentile(0.999))
+           + " max=" + formatMicroseconds(max());
+}
+
+QString LatencyHistogram::report() {
+    QStringList lines;
+    int count = qMin(histogramCount.load(), int(maxHistograms));
+    for (int i = 0; i < count; ++i) {
+        LatencyHistogram *histogram = histograms[i].load();
+        if (histogram)
+            lines.append(histogram->summary());
+    }
+    return lines.join("\n");
+}
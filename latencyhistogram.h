@@ -0,0 +1,72 @@
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+#include <chrono>
+
+// Always-on latency histogram with HDR-style log-linear buckets (16 sub-buckets per power of
+// two, so each bucket is within 6.25% of its value) over nanoseconds.
+//
+// Every recording thread gets its own row of buckets and only ever increments that row, so
+// record() is a handful of relaxed atomic adds on uncontended cache lines: no locks and no
+// allocation. Readers sum the rows on demand.
+class LatencyHistogram {
+    public:
+        static const int subBucketBits = 4;
+        static const int subBuckets = 1 << subBucketBits;
+        static const int maxExponent = 44;   // ~4.9 hours, larger values land in the last bucket
+        static const int bucketCount = (maxExponent - subBucketBits + 2) * subBuckets;
+        static const int maxThreads = 16;    // further threads share rows, which stays correct
+        static const int maxHistograms = 32;
+
+        explicit LatencyHistogram(const char *name);
+
+        void record(qint64 nanoseconds);
+        void reset();
+
+        const char *name() const;
+        quint64 count() const;
+        qint64 max() const;
+        qint64 percentile(double fraction) const; // upper bound of the bucket holding the fraction-th value
+        QString summary() const;
+
+        // p50/p99/p999 of every histogram, one line each.
+        static QString report();
+
+        static qint64 now(); // steady clock in nanoseconds
+
+    private:
+        const char *histogramName;
+        std::atomic<quint64> buckets[maxThreads][bucketCount];
+        std::atomic<qint64> maxValue;
+
+        static int bucketIndex(qint64 nanoseconds);
+        static qint64 bucketUpperBound(int index);
+        static int threadRow();
+};
+
+// Records the lifetime of the scope into a histogram.
+class LatencyTimer {
+    private:
+        LatencyHistogram &histogram;
+        qint64 start;
+
+    public:
+        explicit LatencyTimer(LatencyHistogram &histogram) : histogram(histogram), start(LatencyHistogram::now()) {}
+        ~LatencyTimer() { histogram.record(LatencyHistogram::now() - start); }
+};
+
+// The histograms of the closed loop.
+namespace Latency {
+    extern LatencyHistogram controlIQDecision;   // one controller decision
+    extern LatencyHistogram cgmToDelivery;       // CGM reading to the controller's pump action
+    extern LatencyHistogram administerInsulin;   // InsulinPump::administerMilliunits
+    extern LatencyHistogram saveHistory;         // MainWindow::saveHistoryToFile
+    extern LatencyHistogram replot;              // QCustomPlot::replot, from replotTime()
+    extern LatencyHistogram tickDrift;           // lateness of TickDispatcher wakeups
+    extern LatencyHistogram alertDisplay;        // AlertCenter::raise until the alert is on screen
+}
+
+#endif // LATENCYHISTOGRAM_H
@@ -1,9 +1,85 @@
 #include "mainwindow.h"
+#include "pumpserver.h"
+#include "cgmreplay.h"
+#include "controliq.h"
 #include <QApplication>
 #include <QTimer>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// --headless-socket PATH [--tick-ms N]: serve simulated pumps on a Unix domain socket instead of
+// showing the UI (see pumpserver.h). Without --tick-ms time only advances on Step commands.
+static int runHeadless(int argc, char *argv[])
+{
+    const char *socketPath = nullptr;
+    int tickMilliseconds = 0;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], "--headless-socket") == 0)
+            socketPath = argv[++i];
+        else if (std::strcmp(argv[i], "--tick-ms") == 0)
+            tickMilliseconds = std::atoi(argv[++i]);
+    }
+
+    PumpServer server(tickMilliseconds);
+    if (!server.listen(socketPath) || !server.exec()) {
+        std::fprintf(stderr, "could not serve pumps on %s\n", socketPath);
+        return 1;
+    }
+    return 0;
+}
+
+// --replay FILE [--warp N]: run Control-IQ on a recorded CGM export (see cgmreplay.h) with the
+// default profile, N times faster than recorded (default: as fast as possible), and report the result.
+static int runReplay(int argc, char *argv[])
+{
+    const char *path = nullptr;
+    double timeWarp = 0;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], "--replay") == 0)
+            path = argv[++i];
+        else if (std::strcmp(argv[i], "--warp") == 0)
+            timeWarp = std::atof(argv[++i]);
+    }
+
+    CGMReplay trace;
+    if (!trace.open(QString::fromLocal8Bit(path))) {
+        std::fprintf(stderr, "could not read a CGM trace from %s\n", path);
+        return 1;
+    }
+
+    Profile profile("Replay", 1.0, 10.0, 2.0, 6.0);
+    CGM cgm(profile.correctionFactor);
+    InsulinPump pump(&cgm);
+    BasicControlIQ<ThresholdLadderPolicy<>, RandomDriftPredictor, NoWaitClock> controller(&pump, &profile, &cgm);
+
+    // Each patient in a multi-patient export starts again from a fresh pump.
+    quint32 patient = 0;
+    Milliunits initialBasalRate = pump.getBasalRateMilliunits();
+    auto newPatient = [&](quint32 next) {
+        std::printf("patient %u: %.2f units remaining\n", patient, pump.getInsulinRemaining());
+        patient = next;
+        pump.refillCartridge();
+        pump.setBasalRateMilliunits(initialBasalRate);
+        return true;
+    };
+    qint64 readings = trace.replay(controller, profile, newPatient, timeWarp);
+    if (patient > 0)
+        std::printf("patient %u: %.2f units remaining\n", patient, pump.getInsulinRemaining());
+    std::printf("%lld readings replayed, %.2f units remaining\n", static_cast<long long>(readings), pump.getInsulinRemaining());
+    std::printf("%s\n", LatencyHistogram::report().toLocal8Bit().constData());
+    return 0;
+}
 
 int main(int argc, char *argv[])
 {
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], "--headless-socket") == 0)
+            return runHeadless(argc, argv);
+        if (std::strcmp(argv[i], "--replay") == 0)
+            return runReplay(argc, argv);
+    }
+
     QApplication a(argc, argv);
     MainWindow w;
     w.show();
@@ -5,21 +5,26 @@
 #include "profile.h"
 #include "clickablelabel.h"
 #include "controliq.h"
+#include "latencyhistogram.h"
+#include "tracing.h"
 
 #include <QMessageBox>
 #include <QFile>
 #include <QTextStream>
 #include <QTime>
+#include <QShortcut>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
 {
     ui->setupUi(this);
+    Tracing::setThreadName("GUI");
+    alerts = new AlertCenter(ui->statusbar, this);
     connect(ui->batteryLabel, &ClickableLabel::clicked, this, [=]() {
         if (batteryLevel <= 50) {
             batteryLevel = 100;
-            ui->batteryLabel->setText(QString::number(batteryLevel) + "%");
+            refreshDashboard();
             QMessageBox::information(this, "Battery Recharged", "Battery recharged to 100%!");
         } else {
             QMessageBox::information(this, "Battery", "Battery is above 50%, recharge not needed.");
@@ -40,7 +45,19 @@ MainWindow::MainWindow(QWidget *parent)
     cgm = new CGM(defaultProfile->correctionFactor);
     pump = new InsulinPump(cgm);
 
+    // INSULINPUMP_TELEMETRY=/name publishes readings, basal changes and deliveries to shared memory.
+    QByteArray telemetryName = qgetenv("INSULINPUMP_TELEMETRY");
+    if (!telemetryName.isEmpty()) {
+        if (telemetry.create(telemetryName.constData())) {
+            cgm->setTelemetry(&telemetry);
+            pump->setTelemetry(&telemetry);
+        } else {
+            qDebug() << "could not create telemetry segment" << telemetryName;
+        }
+    }
+
     controlIQ = new ControlIQ(pump, defaultProfile, cgm);
+    dashboard = new DashboardViewModel(ui->reservoirLabel, ui->basalRateLabel, ui->batteryLabel, ui->glucoseLabel);
 
     // TESTING
    // insulinRemaining = 12.0;
@@ -63,6 +80,12 @@ MainWindow::MainWindow(QWidget *parent)
     // updateGlucoseGraph(8.4);
 
     loadHistoryFromFile();
+
+    historyFile.setFileName("insulin_history.txt");
+    qDebug() << "Saving to file:" << QFileInfo(historyFile).absoluteFilePath();
+    if (!historyFile.open(QIODevice::Append | QIODevice::Text)) {
+        qDebug() << "could not oopen file for writing!";
+    }
     basalRate = pump->getBasalRate();
 
     connect(ui->buttonDeliver, &QPushButton::clicked, this, &MainWindow::deliverBolus);
@@ -77,26 +100,42 @@ MainWindow::MainWindow(QWidget *parent)
     connect(ui->buttonViewLog, &QPushButton::clicked, this, &MainWindow::showLog);
     connect(ui->checkBoxControlIQ, &QCheckBox::toggled, this, &MainWindow::on_controlIQToggled);
 
-    // Timer setup
-    basalTimer = new QTimer(this);
-    connect(basalTimer, &QTimer::timeout, this, &MainWindow::deliverBasalInsulin);
-    basalTimer->start(2000);  // Every 2 seconds (simulates 10 minutes)
-
-    glucoseTimer = new QTimer(this);
-    connect(glucoseTimer, &QTimer::timeout, this, &MainWindow::updateGlucose);
-    glucoseTimer->start(1000); // Every second (simulates 5 minutes)
+    // Ctrl+Shift+L dumps p50/p99/p999 of the latency histograms and the alert backlog to the debug output.
+    QShortcut *latencyShortcut = new QShortcut(QKeySequence("Ctrl+Shift+L"), this);
+    connect(latencyShortcut, &QShortcut::activated, this, [this]() {
+        qDebug().noquote() << LatencyHistogram::report();
+        qDebug().noquote() << alerts->metrics();
+    });
 
-    QTimer *batteryTimer = new QTimer(this);
-    connect(batteryTimer, &QTimer::timeout, this, &MainWindow::drainBattery);
-    batteryTimer->start(500); // Every half second (simulates 2.5 minutes)
+    // Ctrl+Shift+T starts tracing, pressing it again writes insulinpump_trace.json (open it in Perfetto).
+    QShortcut *traceShortcut = new QShortcut(QKeySequence("Ctrl+Shift+T"), this);
+    connect(traceShortcut, &QShortcut::activated, this, []() {
+        if (!Tracing::isEnabled()) {
+            Tracing::setEnabled(true);
+            qDebug() << "Tracing started";
+        } else {
+            Tracing::setEnabled(false);
+            Tracing::exportChromeTrace("insulinpump_trace.json");
+            qDebug() << "Trace written to insulinpump_trace.json";
+        }
+    });
 
-    QTimer *pullInfoFromPumpTimer = new QTimer(this);
-    connect(pullInfoFromPumpTimer, &QTimer::timeout, this, &MainWindow::getInfoFromInsulinPump);
-    pullInfoFromPumpTimer->start(1000); // Every second (simulates 5 minutes)
+    // Simulation clock: one wakeup every half second (simulates 2.5 minutes), subscribers run in
+    // phase order sense -> control -> deliver -> display.
+    tickDispatcher = new TickDispatcher(500, this);
+    glucoseSubscription = tickDispatcher->subscribe(TickDispatcher::Sense, 2, [this]() { updateGlucose(); }); // 5 minutes
+    controlIQSubscription = tickDispatcher->subscribe(TickDispatcher::Control, 2, [this]() { controlIQ->tick(); }); // 5 minutes
+    basalSubscription = tickDispatcher->subscribe(TickDispatcher::Deliver, 4, [this]() { deliverBasalInsulin(); }); // 10 minutes
+    tickDispatcher->subscribe(TickDispatcher::Display, 2, [this]() { getInfoFromInsulinPump(); }); // 5 minutes
+    tickDispatcher->subscribe(TickDispatcher::Display, 1, [this]() { drainBattery(); }); // 2.5 minutes
+    tickDispatcher->subscribe(TickDispatcher::Display, 1, [this]() { refreshDashboard(); }); // last, after everything above
+    tickDispatcher->setSubscriberEnabled(controlIQSubscription, ui->checkBoxControlIQ->isChecked());
+    tickDispatcher->start();
 }
 
 MainWindow::~MainWindow()
 {
+    delete dashboard;
     delete ui;
 }
 
@@ -126,18 +165,18 @@ void MainWindow::deliverBolus()
         "Deliver " + QString::number(insulinDose, 'f', 2) + " units?",
         QMessageBox::Yes | QMessageBox::No) == QMessageBox::Yes) {
 
-        pump->administerInsulin(insulinDose, "Bolus");
-        saveHistoryToFile("Bolus: Delivered " + QString::number(insulinDose, 'f', 2) + " units");
+        pump->administerInsulin(insulinDose, DeliveryType::Bolus);
+        saveHistoryToFile("Bolus", toMilliunits(insulinDose));
     }
 }
 
 void MainWindow::deliverBasalInsulin()
 {
-    double dose = pump->getBasalRate() / 12.0;
-    if (insulinRemaining < dose) return;
+    TraceSpan span("basalTimer", "timer");
+    Milliunits dose = pump->deliverBasalTick();
+    if (dose <= 0) return;
 
-    pump->administerInsulin(dose, "Basal");
-    saveHistoryToFile("Basal: Delivered " + QString::number(dose, 'f', 2) + " units");
+    saveHistoryToFile("Basal", dose);
 }
 
 void MainWindow::on_buttonUpdateBasal_clicked()
@@ -172,20 +211,24 @@ void MainWindow::on_buttonBackFromBolus_clicked()
     ui->stackedWidget->setCurrentWidget(ui->homePage);
 }
 
-void MainWindow::saveHistoryToFile(const QString &entry)
+void MainWindow::saveHistoryToFile(const char *type, Milliunits amount)
 {
-    QString filePath = "insulin_history.txt";
-    QFile file(filePath);
-
-    qDebug() <<"Saving to file:" << QFileInfo(file).absoluteFilePath();
+    LatencyTimer latencyTimer(Latency::saveHistory);
+    TraceSpan span("Journal flush", "io");
+    if (!historyFile.isOpen())
+        return;
 
-    if (file.open(QIODevice::Append | QIODevice::Text)) {
-        qDebug() <<"Saving to file" << entry;
-        QTextStream out(&file);
-        out << QTime::currentTime().toString("hh:mm:ss") << ": " << entry << "\n";
-        file.close();
-    } else {
-        qDebug() << "could not oopen file for writing!";
+    // Formatted into a stack buffer and written to the journal opened in the constructor,
+    // so logging a basal tick does not allocate.
+    QTime now = QTime::currentTime();
+    qint64 hundredths = (amount + 5) / 10;
+    char line[128];
+    int length = qsnprintf(line, sizeof(line), "%02d:%02d:%02d: %s: Delivered %lld.%02lld units\n",
+                           now.hour(), now.minute(), now.second(), type,
+                           static_cast<long long>(hundredths / 100), static_cast<long long>(hundredths % 100));
+    if (length > 0) {
+        historyFile.write(line, qMin<int>(length, sizeof(line) - 1));
+        historyFile.flush();
     }
 }
 
@@ -216,13 +259,14 @@ void MainWindow::updateGlucoseGraph(double newValue) {
 
     ui->glucoseGraph->graph(0)->setData(xData, yData);
     ui->glucoseGraph->replot();
+    Latency::replot.record(qint64(ui->glucoseGraph->replotTime() * 1e6));
 }
 
 void MainWindow::updateGlucose() {
+    TraceSpan span("glucoseTimer", "timer");
     cgm->readGlucose();
     double newLevel = cgm->getGlucoseLevel();
     updateGlucoseGraph(newLevel);  // This updates the QCustomPlot
-    ui->glucoseLabel->setText("Glucose: " + QString::number(newLevel, 'f', 1) + " mmol/L");
 
     /*
     if (newLevel < 3.5) {
@@ -288,36 +332,31 @@ void MainWindow::loadProfileFromDropdown() {
 
 void MainWindow::drainBattery()
 {
+    TraceSpan span("batteryTimer", "timer");
     batteryLevel -= 1;
     if (batteryLevel < 0) batteryLevel = 0;
 
-    updateBatteryLabelColour();
-
-    // Update battery label
-    ui->batteryLabel->setText(QString::number(batteryLevel) + "%");
-
     // Show warning at 50%
     if (batteryLevel == 50 && !warnedAt50) {
-        QMessageBox::warning(this, "Low Battery", "Battery is at 50%. Click the battery to recharge.");
+        alerts->raise("battery", AlertCenter::Warning, "Low Battery", "Battery is at 50%. Click the battery to recharge.");
         warnedAt50 = true;
     }
 
     // Warning at 20%
     if (batteryLevel == 20) {
-        QMessageBox::warning(this, "Battery Critical", "Battery is at 20%!");
+        alerts->raise("battery", AlertCenter::Critical, "Battery Critical", "Battery is at 20%!");
     }
 
     // Critical shutdown at 0%
     if (batteryLevel == 0 && !isBatteryDead) {
         isBatteryDead = true;
 
-        QMessageBox::critical(this, "Battery Dead", "Battery has died. Simulation will now stop.");
-
-        // Stop timers
-        if (glucoseTimer) glucoseTimer->stop();
-        if (basalTimer) basalTimer->stop();
+        alerts->raise("battery", AlertCenter::Critical, "Battery Dead", "Battery has died. Simulation will now stop.");
 
-        if (controlIQ) controlIQ->stop();
+        // Stop sensing, control and delivery
+        tickDispatcher->setSubscriberEnabled(glucoseSubscription, false);
+        tickDispatcher->setSubscriberEnabled(basalSubscription, false);
+        tickDispatcher->setSubscriberEnabled(controlIQSubscription, false);
 
         // Disable relevant buttons
         ui->buttonDeliver->setEnabled(false);
@@ -328,40 +367,19 @@ void MainWindow::drainBattery()
 }
 
 
-void MainWindow::updateBatteryLabelColour()
+void MainWindow::refreshDashboard()
 {
-    QString color;
-    if (batteryLevel > 50)
-        color = "#55cc55";
-    else if (batteryLevel > 20)
-        color = "#ffaa00";
-    else
-        color = "#ff4444";
-
-    ui->batteryLabel->setText(QString::number(batteryLevel) + "%");
-    ui->batteryLabel->setStyleSheet("color: " + color + "; font-weight: bold;");
+    dashboard->apply(DashboardViewModel::snapshot(*pump, *cgm, batteryLevel));
 }
 
 void MainWindow::getInfoFromInsulinPump()
 {
+    TraceSpan span("pullInfoFromPumpTimer", "timer");
     insulinRemaining = pump->getInsulinRemaining();
     basalRate = pump->getBasalRate();
 
-    QString color;
-    if (insulinRemaining > 50)
-        color = "#55cc55"; // Green
-    else if (insulinRemaining > 20)
-        color = "#ffaa00"; // Orange
-    else
-        color = "#ff4444"; // Red
-
-    ui->reservoirLabel->setText(QString::number(insulinRemaining, 'f', 1) + " u");
-    ui->reservoirLabel->setStyleSheet("color: " + color + "; font-weight: bold;");
-
-    ui->basalRateLabel->setText("Basal: " + QString::number(basalRate, 'f', 2) + " u/hr");
-
     if (insulinRemaining < 10 && !warnedInsulinLow) {
-        QMessageBox::warning(this, "Low Insulin", "Insulin is running low!");
+        alerts->raise("insulin", AlertCenter::Warning, "Low Insulin", "Insulin is running low!");
         warnedInsulinLow = true;
     }
 }
@@ -383,11 +401,12 @@ void MainWindow::showLog() {
 void MainWindow::on_controlIQToggled(bool enabled) {
     if (!controlIQ) return;
 
-    if (enabled) {
-        controlIQ->start();
+    // Control-IQ runs in the control phase of the simulation tick rather than on its own thread.
+    if (enabled && !isBatteryDead) {
+        tickDispatcher->setSubscriberEnabled(controlIQSubscription, true);
         qDebug() << "Control-IQ Enabled";
     } else {
-        controlIQ->stop();
+        tickDispatcher->setSubscriberEnabled(controlIQSubscription, false);
         qDebug() << "Control-IQ Disabled";
     }
 }
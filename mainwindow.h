@@ -3,10 +3,15 @@
 
 #include <QMainWindow>
 #include <QTimer>
+#include <QFile>
 #include "insulinpump.h"
 #include "cgm.h"
 #include "profile.h"
 #include "controliq.h"
+#include "tickdispatcher.h"
+#include "alertcenter.h"
+#include "dashboardviewmodel.h"
+#include "telemetrybus.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -28,7 +33,6 @@ private slots:
     void on_bolusButton_clicked();
     void on_buttonBackFromOptions_clicked();
     void on_buttonBackFromBolus_clicked();
-    void updateBatteryLabelColour();
     void getInfoFromInsulinPump();
     void showLog();
 
@@ -39,20 +43,26 @@ private:
     InsulinPump* pump;
     double insulinRemaining = 235.0;
     double basalRate;
-    QTimer *basalTimer;
     CGM* cgm;
-    QTimer* glucoseTimer;
+    TickDispatcher *tickDispatcher;
+    int glucoseSubscription;
+    int controlIQSubscription;
+    int basalSubscription;
     std::vector<Profile> profiles;
     bool warnedAt50 = false;
     bool warnedInsulinLow = false;
     bool isBatteryDead = false;
     ControlIQ* controlIQ;
+    QFile historyFile;
+    AlertCenter *alerts;
+    DashboardViewModel *dashboard;
+    TelemetryBus telemetry;
 
 
 
     void updateGlucose();
 
-    void saveHistoryToFile(const QString &entry);
+    void saveHistoryToFile(const char *type, Milliunits amount);
     void loadHistoryFromFile();
     void controlIQDeliver(double units);
     void administerInsulin(double units);
@@ -61,6 +71,7 @@ private:
     void loadProfile(const QString &name);
     void loadProfileFromDropdown();
     void drainBattery();
+    void refreshDashboard();
     void on_controlIQToggled(bool enabled);
 
 
@@ -0,0 +1,35 @@
+#ifndef MILLIUNITS_H
+#define MILLIUNITS_H
+
+#include <QtGlobal>
+#include <cmath>
+
+// Insulin amounts in integer milliunits (1 u = 1000 mU). The pump does all of its accounting
+// in this type so long runs are exactly reproducible and need no FPU; doubles only appear at
+// the UI/controller boundary, converted with the two functions below.
+typedef qint64 Milliunits;
+
+const Milliunits milliunitsPerUnit = 1000;
+
+// Largest amount accepted in units, far beyond any cartridge or basal rate but well inside what
+// llround can represent in milliunits.
+const double maxUnits = 1e12;
+
+// Whether units is an amount the pump can account for: finite and within +-maxUnits.
+inline bool isValidUnits(double units) {
+    return std::isfinite(units) && std::fabs(units) <= maxUnits;
+}
+
+// Rounds to the nearest milliunit, halfway cases away from zero. Invalid amounts (see isValidUnits)
+// give 0 instead of llround's unspecified result; callers that can refuse them should check first.
+inline Milliunits toMilliunits(double units) {
+    if (!isValidUnits(units))
+        return 0;
+    return static_cast<Milliunits>(std::llround(units * milliunitsPerUnit));
+}
+
+inline double toUnits(Milliunits amount) {
+    return static_cast<double>(amount) / milliunitsPerUnit;
+}
+
+#endif // MILLIUNITS_H
@@ -0,0 +1,30 @@
+#ifndef PARALLELWORKERS_H
+#define PARALLELWORKERS_H
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// Fork/join helper shared by the batch evaluators (SimulationBranch, ProfileSweep, TrajectoryDensity).
+
+// Number of workers for items independent work items: one per hardware thread, at most one per
+// item, and at least one.
+inline int workerCount(int items) {
+    return std::max(1, std::min(items, int(std::thread::hardware_concurrency())));
+}
+
+// Runs work(worker, workers) for worker = 0 .. workerCount(items) - 1, each on its own thread
+// except worker 0, which runs on the calling one, and returns once all of them have finished.
+// How the items are split between workers is up to work.
+template <typename Work>
+void runWorkers(int items, Work work) {
+    int workers = workerCount(items);
+    std::vector<std::thread> threads;
+    for (int w = 1; w < workers; ++w)
+        threads.emplace_back(work, w, workers);
+    work(0, workers);
+    for (std::thread &thread : threads)
+        thread.join();
+}
+
+#endif // PARALLELWORKERS_H
@@ -0,0 +1,134 @@
+#include "profilesweep.h"
+#include "controlpolicies.h"
+#include "parallelworkers.h"
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+SweepScenario::SweepScenario(const QString &name, const SimulationBranch &start, int steps)
+    : name(name), start(start), steps(steps), carbsAtStep(steps, 0.0)
+{
+}
+
+void SweepScenario::addMeal(int step, double carbs) {
+    if (step >= 0 && step < steps)
+        carbsAtStep[step] += carbs;
+}
+
+void SweepScenario::prepare() {
+    excursion = QVector<double>(steps, 0.0);
+    for (int step = 0; step < steps; ++step) {
+        if (carbsAtStep[step] <= 0)
+            continue;
+        double perStep = carbsAtStep[step] * glucosePerGram / carbAbsorptionSteps;
+        for (int s = step; s < std::min(steps, step + carbAbsorptionSteps); ++s)
+            excursion[s] += perStep;
+    }
+}
+
+ProfileSweep::ProfileSweep(double maxHypo) : maxHypoFraction(maxHypo), totalSteps(0) {
+}
+
+void ProfileSweep::addScenario(const SweepScenario &scenario) {
+    SweepScenario prepared(scenario);
+    prepared.prepare();
+    scenarios.append(prepared);
+    totalSteps += scenario.steps;
+}
+
+SweepResult ProfileSweep::evaluateCandidate(int index, const Profile &profile) const {
+    SweepResult result;
+    result.candidate = index;
+    int hypoLimit = int(maxHypoFraction * totalSteps);
+    int inRange = 0, hypo = 0;
+    Milliunits delivered = 0;
+
+    for (const SweepScenario &scenario : scenarios) {
+        SimulationBranch branch = scenario.start.fork();
+        CGM &cgm = branch.glucoseMonitor();
+        InsulinPump &pump = branch.insulinPump();
+        ThresholdLadderPolicy<> policy;
+        PersistencePredictor predictor;
+
+        pump.refillCartridge();
+        pump.setBasalRate(profile.basalRate);
+        Milliunits startingInsulin = pump.getInsulinRemainingMilliunits();
+
+        for (int step = 0; step < scenario.steps; ++step) {
+            cgm.shiftGlucose(scenario.excursion[step]);
+            double glucose = cgm.getGlucoseLevel();
+            if (scenario.carbsAtStep[step] > 0) {
+                BranchAction meal;
+                meal.bolus = pump.calculateBolus(glucose, scenario.carbsAtStep[step], profile.targetGlucoseLevel,
+                                                 profile.correctionFactor, profile.carbohydrateRate);
+                branch.apply(meal);
+            }
+            policy.apply(pump, profile, glucose, predictor.predict(glucose));
+            branch.step();
+
+            glucose = cgm.getGlucoseLevel();
+            if (glucose < 3.9) {
+                // Past the limit the candidate is out whatever the remaining readings are.
+                if (++hypo > hypoLimit) {
+                    result.pruned = true;
+                    break;
+                }
+            } else if (glucose <= 10.0) {
+                ++inRange;
+            }
+        }
+        delivered += startingInsulin - pump.getInsulinRemainingMilliunits();
+        if (result.pruned)
+            break;
+    }
+
+    result.timeInRange = totalSteps > 0 ? double(inRange) / totalSteps : 0;
+    result.hypoFraction = totalSteps > 0 ? double(hypo) / totalSteps : 0;
+    result.totalInsulin = toUnits(delivered);
+    return result;
+}
+
+QVector<SweepResult> ProfileSweep::evaluate(const QVector<Profile> &candidates) const {
+    QVector<SweepResult> results(candidates.size());
+    SweepResult *resultData = results.data();
+
+    // Pruned candidates finish early, so workers take the next candidate as they go instead of a fixed share.
+    std::atomic<int> next(0);
+    runWorkers(candidates.size(), [&](int, int) {
+        for (int i = next++; i < candidates.size(); i = next++)
+            resultData[i] = evaluateCandidate(i, candidates[i]);
+    });
+
+    return results;
+}
+
+QVector<Profile> ProfileSweep::grid(const QVector<double> &basalRates, const QVector<double> &carbohydrateRates,
+                                    const QVector<double> &correctionFactors, const QVector<double> &targets) {
+    QVector<Profile> candidates;
+    candidates.reserve(basalRates.size() * carbohydrateRates.size() * correctionFactors.size() * targets.size());
+    for (double basalRate : basalRates)
+        for (double carbohydrateRate : carbohydrateRates)
+            for (double correctionFactor : correctionFactors)
+                for (double target : targets)
+                    candidates.append(Profile("Sweep", basalRate, carbohydrateRate, correctionFactor, target));
+    return candidates;
+}
+
+QVector<SweepResult> ProfileSweep::paretoFrontier(const QVector<SweepResult> &results) {
+    QVector<SweepResult> sorted;
+    for (const SweepResult &result : results) {
+        if (!result.pruned)
+            sorted.append(result);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const SweepResult &a, const SweepResult &b) {
+        return a.totalInsulin != b.totalInsulin ? a.totalInsulin < b.totalInsulin : a.timeInRange > b.timeInRange;
+    });
+
+    // In order of increasing insulin, a result is on the frontier only if it beats every cheaper one.
+    QVector<SweepResult> frontier;
+    for (const SweepResult &result : sorted) {
+        if (frontier.isEmpty() || result.timeInRange > frontier.last().timeInRange)
+            frontier.append(result);
+    }
+    return frontier;
+}
@@ -0,0 +1,74 @@
+#ifndef PROFILESWEEP_H
+#define PROFILESWEEP_H
+
+#include <QString>
+#include <QVector>
+#include "profile.h"
+#include "simulationbranch.h"
+
+// A simulated day (or any span) that candidate profiles are scored on: a starting patient state
+// plus meals. Meal absorption is turned into a per-step glucose excursion once, when the scenario
+// is added to a sweep, and shared read-only by every candidate.
+class SweepScenario {
+    public:
+        // Carbohydrates raise glucose by this much per gram, spread evenly over carbAbsorptionSteps readings.
+        static constexpr double glucosePerGram = 0.2;
+        static const int carbAbsorptionSteps = 6;
+
+        SweepScenario(const QString &name, const SimulationBranch &start, int steps);
+
+        // A meal of carbs grams at the given step; the candidate profile decides the meal bolus.
+        void addMeal(int step, double carbs);
+
+        // Builds excursion from the meals; called by ProfileSweep::addScenario.
+        void prepare();
+
+        QString name;
+        SimulationBranch start;
+        int steps;
+        QVector<double> carbsAtStep;
+        QVector<double> excursion;  // glucose added by meal absorption before each step, mmol/L
+};
+
+struct SweepResult {
+    int candidate = 0;          // index into the evaluated candidates
+    double timeInRange = 0;     // fraction of readings between 3.9 and 10.0 mmol/L, over all scenarios
+    double hypoFraction = 0;    // fraction of readings below 3.9 mmol/L
+    double totalInsulin = 0;    // units delivered over all scenarios
+    bool pruned = false;        // stopped early, its hypo time already exceeded the limit
+};
+
+// Scores Profile candidates (basal rate, carbohydrate ratio, correction factor, target) against a
+// scenario set, in parallel across cores. Each candidate drives the threshold-ladder controller
+// with a deterministic predictor on a fork of every scenario's start state, so all candidates see
+// the same CGM noise and differ only by their own decisions.
+//
+// evaluate() takes any candidate list, so a grid from grid() and the populations of an outer
+// optimiser (e.g. CMA-ES) go through the same path.
+class ProfileSweep {
+    private:
+        QVector<SweepScenario> scenarios;
+        double maxHypoFraction;
+        int totalSteps;
+
+        SweepResult evaluateCandidate(int index, const Profile &profile) const;
+
+    public:
+        // Candidates spending more than maxHypo of all readings below 3.9 mmol/L are pruned as soon
+        // as they cross the limit, without running their remaining scenarios.
+        explicit ProfileSweep(double maxHypo = 0.04);
+
+        void addScenario(const SweepScenario &scenario);
+
+        QVector<SweepResult> evaluate(const QVector<Profile> &candidates) const;
+
+        // Every combination of the given values.
+        static QVector<Profile> grid(const QVector<double> &basalRates, const QVector<double> &carbohydrateRates,
+                                     const QVector<double> &correctionFactors, const QVector<double> &targets);
+
+        // Results not dominated in (higher time in range, lower total insulin), pruned candidates
+        // excluded, sorted by total insulin.
+        static QVector<SweepResult> paretoFrontier(const QVector<SweepResult> &results);
+};
+
+#endif // PROFILESWEEP_H
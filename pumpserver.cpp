@@ -0,0 +1,623 @@
+#include "pumpserver.h"
+#include "controliq.h"
+#include "telemetrybus.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// Remote pumps are stepped by the server, never by a worker thread, so the controller must not sleep.
+typedef BasicControlIQ<ThresholdLadderPolicy<>, RandomDriftPredictor, NoWaitClock> RemoteControlIQ;
+
+struct PumpSubscription {
+    PumpConnection *connection;
+    quint32 mask;
+};
+
+struct SimulatedPump {
+    quint32 id;
+    PumpConnection *owner;
+    quint64 ticks;
+    Profile profile;
+    CGM cgm;
+    InsulinPump pump;
+    RemoteControlIQ controller;
+    std::vector<PumpSubscription> subscribers;
+
+    SimulatedPump(quint32 pumpId, PumpConnection *connection, const Profile &initialProfile)
+        : id(pumpId), owner(connection), ticks(0), profile(initialProfile),
+          cgm(initialProfile.correctionFactor), pump(&cgm), controller(&pump, &profile, &cgm)
+    {
+        pump.setBasalRate(profile.basalRate);
+    }
+};
+
+struct PumpConnection {
+    int fd;
+    bool closing;
+    std::vector<uchar> input;
+    std::vector<uchar> output;
+    size_t outputOffset;  // bytes of output already written
+    bool waitingForWrite; // EPOLLOUT armed
+};
+
+// ---- Little-endian encoding ----
+
+static void putU8(std::vector<uchar> &out, quint8 value) {
+    out.push_back(value);
+}
+
+static void putU32(std::vector<uchar> &out, quint32 value) {
+    for (int i = 0; i < 4; ++i)
+        out.push_back(uchar(value >> (8 * i)));
+}
+
+static void putU64(std::vector<uchar> &out, quint64 value) {
+    for (int i = 0; i < 8; ++i)
+        out.push_back(uchar(value >> (8 * i)));
+}
+
+static void putF64(std::vector<uchar> &out, double value) {
+    quint64 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    putU64(out, bits);
+}
+
+static quint32 getU32(const uchar *in) {
+    return quint32(in[0]) | quint32(in[1]) << 8 | quint32(in[2]) << 16 | quint32(in[3]) << 24;
+}
+
+static double getF64(const uchar *in) {
+    quint64 bits = 0;
+    for (int i = 7; i >= 0; --i)
+        bits = bits << 8 | in[i];
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Starts a frame; the length is patched in by endFrame().
+static size_t beginFrame(std::vector<uchar> &out, PumpMessage type, quint32 pumpId) {
+    size_t start = out.size();
+    putU32(out, 0);
+    putU8(out, quint8(type));
+    putU32(out, pumpId);
+    return start;
+}
+
+static void endFrame(std::vector<uchar> &out, size_t start) {
+    quint32 length = quint32(out.size() - start - 4);
+    for (int i = 0; i < 4; ++i)
+        out[start + i] = uchar(length >> (8 * i));
+}
+
+// Validates all four values before touching profile, which may be the live one the controller reads.
+static bool readProfile(const uchar *body, quint32 bodyLength, Profile &profile) {
+    if (bodyLength < 32)
+        return false;
+    double basalRate = getF64(body);
+    double carbohydrateRate = getF64(body + 8);
+    double correctionFactor = getF64(body + 16);
+    double targetGlucoseLevel = getF64(body + 24);
+    if (!std::isfinite(basalRate) || !std::isfinite(carbohydrateRate)
+            || !std::isfinite(correctionFactor) || !std::isfinite(targetGlucoseLevel))
+        return false;
+    if (basalRate < 0 || correctionFactor <= 0 || carbohydrateRate <= 0 || targetGlucoseLevel <= 0)
+        return false;
+    profile.basalRate = basalRate;
+    profile.carbohydrateRate = carbohydrateRate;
+    profile.correctionFactor = correctionFactor;
+    profile.targetGlucoseLevel = targetGlucoseLevel;
+    return true;
+}
+
+// ---- Server ----
+
+PumpServer::PumpServer(int tickMilliseconds)
+    : epollFd(-1), listenFd(-1), timerFd(-1), wakeFd(-1), tickMilliseconds(tickMilliseconds), running(false)
+{
+    socketPath[0] = '\0';
+#ifdef Q_OS_LINUX
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+}
+
+PumpServer::~PumpServer() {
+    for (SimulatedPump *pump : pumps)
+        delete pump;
+#ifdef Q_OS_LINUX
+    for (PumpConnection *connection : connections) {
+        close(connection->fd);
+        delete connection;
+    }
+    if (timerFd >= 0)
+        close(timerFd);
+    if (wakeFd >= 0)
+        close(wakeFd);
+    if (listenFd >= 0) {
+        close(listenFd);
+        unlink(socketPath);
+    }
+    if (epollFd >= 0)
+        close(epollFd);
+#endif
+}
+
+bool PumpServer::listen(const char *path) {
+#ifdef Q_OS_LINUX
+    sockaddr_un address;
+    if (listenFd >= 0 || std::strlen(path) >= sizeof(address.sun_path))
+        return false;
+
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return false;
+    unlink(path);
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || ::listen(fd, SOMAXCONN) < 0) {
+        close(fd);
+        return false;
+    }
+
+    listenFd = fd;
+    std::strcpy(socketPath, path);
+    return true;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+bool PumpServer::exec() {
+#ifdef Q_OS_LINUX
+    if (listenFd < 0 || wakeFd < 0)
+        return false;
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0)
+        return false;
+
+    // Listening socket, wake-up eventfd and timer are told apart from connections by their data pointer.
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = &listenFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event);
+    event.events = EPOLLIN;
+    event.data.ptr = &wakeFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+
+    if (tickMilliseconds > 0) {
+        timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        itimerspec period;
+        period.it_interval.tv_sec = tickMilliseconds / 1000;
+        period.it_interval.tv_nsec = long(tickMilliseconds % 1000) * 1000000;
+        period.it_value = period.it_interval;
+        timerfd_settime(timerFd, 0, &period, nullptr);
+        event.events = EPOLLIN;
+        event.data.ptr = &timerFd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, timerFd, &event);
+    }
+
+    Tracing::setThreadName("PumpServer");
+    running = true;
+    const int maxEvents = 64;
+    epoll_event events[maxEvents];
+    bool backlog = false;
+    while (running) {
+        int ready = epoll_wait(epollFd, events, maxEvents, backlog ? 0 : -1);
+        if (ready < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+
+        for (int i = 0; i < ready; ++i) {
+            if (events[i].data.ptr == &listenFd) {
+                acceptConnections();
+            } else if (events[i].data.ptr == &wakeFd) {
+                quint64 wakeups;
+                while (read(wakeFd, &wakeups, sizeof(wakeups)) == sizeof(wakeups)) {
+                }
+            } else if (events[i].data.ptr == &timerFd) {
+                quint64 expirations = 0;
+                if (read(timerFd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+                    for (quint64 n = 0; n < expirations; ++n)
+                        tickAll();
+                }
+            } else {
+                PumpConnection *connection = static_cast<PumpConnection*>(events[i].data.ptr);
+                if (connection->closing)
+                    continue;
+                // Read before honouring a hangup so commands sent just before it are still answered.
+                // Frames are handled below, once per connection per wakeup.
+                if (events[i].events & EPOLLIN)
+                    readFrom(connection);
+                else if (events[i].events & (EPOLLERR | EPOLLHUP))
+                    connection->closing = true;
+                if (!connection->closing && (events[i].events & EPOLLOUT))
+                    flush(connection);
+            }
+        }
+
+        // Each connection gets the same budget per wakeup, so a client pipelining expensive
+        // commands cannot starve the others; its backlog is picked up on the next pass without
+        // blocking in epoll_wait.
+        backlog = false;
+        for (PumpConnection *connection : connections) {
+            if (!connection->closing && handleFrames(connection))
+                backlog = true;
+        }
+
+        // Send what this batch produced, then drop connections that failed or fell too far behind.
+        // Closing is deferred to here so no pointer in events[] is left dangling.
+        for (PumpConnection *connection : connections) {
+            if (!connection->closing && connection->output.size() > connection->outputOffset)
+                flush(connection);
+        }
+        for (size_t i = 0; i < connections.size();) {
+            if (connections[i]->closing)
+                closeConnection(connections[i]);
+            else
+                ++i;
+        }
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void PumpServer::stop() {
+    running.store(false);
+#ifdef Q_OS_LINUX
+    if (wakeFd >= 0) {
+        quint64 one = 1;
+        ssize_t written = write(wakeFd, &one, sizeof(one));
+        (void)written; // only fails if the counter is already non-zero, which wakes the loop too
+    }
+#endif
+}
+
+int PumpServer::pumpCount() const {
+    return int(std::count_if(pumps.begin(), pumps.end(), [](SimulatedPump *pump) { return pump != nullptr; }));
+}
+
+void PumpServer::acceptConnections() {
+#ifdef Q_OS_LINUX
+    while (true) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return; // EAGAIN once the backlog is drained
+
+        PumpConnection *connection = new PumpConnection();
+        connection->fd = fd;
+        connection->closing = false;
+        connection->outputOffset = 0;
+        connection->waitingForWrite = false;
+
+        epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = connection;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            close(fd);
+            delete connection;
+            continue;
+        }
+        connections.push_back(connection);
+    }
+#endif
+}
+
+// Reads what the socket has, up to maxInputBuffered bytes buffered. The rest stays in the socket;
+// epoll is level-triggered, so the connection is reported again on the next wakeup.
+void PumpServer::readFrom(PumpConnection *connection) {
+#ifdef Q_OS_LINUX
+    uchar buffer[16384];
+    std::vector<uchar> &input = connection->input;
+    while (input.size() < maxInputBuffered) {
+        size_t room = std::min(sizeof(buffer), size_t(maxInputBuffered - input.size()));
+        ssize_t received = read(connection->fd, buffer, room);
+        if (received > 0) {
+            input.insert(input.end(), buffer, buffer + received);
+            continue;
+        }
+        if (received < 0 && errno == EINTR)
+            continue;
+        if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+            connection->closing = true;
+        break;
+    }
+#else
+    (void)connection;
+#endif
+}
+
+// Handles buffered complete frames until the connection has used its share of this wakeup:
+// maxFramesPerWakeup frames or maxTicksPerWakeup stepped ticks, whichever comes first (at least one
+// frame). A partial frame, or whatever is over budget, stays buffered. Returns whether a complete
+// frame is still waiting.
+bool PumpServer::handleFrames(PumpConnection *connection) {
+    size_t offset = 0;
+    std::vector<uchar> &input = connection->input;
+    int frames = 0;
+    quint64 ticks = 0;
+    bool backlog = false;
+    while (!connection->closing && input.size() - offset >= 4) {
+        quint32 length = getU32(input.data() + offset);
+        if (length < 5 || length > maxFrameLength) {
+            connection->closing = true;
+            break;
+        }
+        if (input.size() - offset - 4 < length)
+            break;
+        const uchar *frame = input.data() + offset + 4;
+        quint32 cost = PumpCommand(frame[0]) == PumpCommand::Step && length >= 9 ? getU32(frame + 5) : 0;
+        if (cost > maxStepTicks)
+            cost = 0; // rejected without stepping
+        if (frames > 0 && (frames >= maxFramesPerWakeup || ticks + cost > maxTicksPerWakeup)) {
+            backlog = true;
+            break;
+        }
+        handleFrame(connection, frame, length);
+        offset += 4 + length;
+        ++frames;
+        ticks += cost;
+    }
+    input.erase(input.begin(), input.begin() + std::min(offset, input.size()));
+    return backlog && !connection->closing;
+}
+
+void PumpServer::flush(PumpConnection *connection) {
+#ifdef Q_OS_LINUX
+    std::vector<uchar> &output = connection->output;
+    while (connection->outputOffset < output.size()) {
+        ssize_t written = send(connection->fd, output.data() + connection->outputOffset,
+                               output.size() - connection->outputOffset, MSG_NOSIGNAL);
+        if (written > 0) {
+            connection->outputOffset += size_t(written);
+        } else if (written < 0 && errno == EINTR) {
+            continue;
+        } else if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            connection->closing = true;
+            return;
+        }
+    }
+
+    bool pending = connection->outputOffset < output.size();
+    if (!pending) {
+        output.clear();
+        connection->outputOffset = 0;
+    }
+    // Only ask for EPOLLOUT while the socket buffer is full, otherwise it fires continuously.
+    if (pending != connection->waitingForWrite) {
+        epoll_event event;
+        event.events = pending ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+        event.data.ptr = connection;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, connection->fd, &event);
+        connection->waitingForWrite = pending;
+    }
+#else
+    (void)connection;
+#endif
+}
+
+void PumpServer::closeConnection(PumpConnection *connection) {
+#ifdef Q_OS_LINUX
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, connection->fd, nullptr);
+    close(connection->fd);
+#endif
+    // Pumps die with the connection that opened them.
+    for (SimulatedPump *&pump : pumps) {
+        if (!pump)
+            continue;
+        if (pump->owner == connection) {
+            delete pump;
+            pump = nullptr;
+            continue;
+        }
+        std::vector<PumpSubscription> &subscribers = pump->subscribers;
+        subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(),
+                                         [connection](const PumpSubscription &s) { return s.connection == connection; }),
+                          subscribers.end());
+    }
+    connections.erase(std::find(connections.begin(), connections.end(), connection));
+    delete connection;
+}
+
+SimulatedPump *PumpServer::findPump(quint32 pumpId) const {
+    return pumpId >= 1 && pumpId <= pumps.size() ? pumps[pumpId - 1] : nullptr;
+}
+
+void PumpServer::closePump(quint32 pumpId) {
+    delete pumps[pumpId - 1];
+    pumps[pumpId - 1] = nullptr;
+}
+
+void PumpServer::reply(PumpConnection *connection, PumpCommand command, quint32 pumpId, PumpStatus status, double value) {
+    std::vector<uchar> &out = connection->output;
+    size_t start = beginFrame(out, PumpMessage::Reply, pumpId);
+    putU8(out, quint8(command));
+    putU8(out, quint8(status));
+    putF64(out, value);
+    endFrame(out, start);
+
+    // A client that keeps sending but never reads its replies is dropped like a slow subscriber.
+    if (int(out.size() - connection->outputOffset) > maxPendingOutput)
+        connection->closing = true;
+}
+
+void PumpServer::emitEvent(SimulatedPump *pump, quint32 kind, quint32 detail, double value) {
+    for (const PumpSubscription &subscription : pump->subscribers) {
+        if (!(subscription.mask & (1u << kind)))
+            continue;
+        PumpConnection *connection = subscription.connection;
+        if (connection->closing)
+            continue;
+
+        std::vector<uchar> &out = connection->output;
+        size_t start = beginFrame(out, PumpMessage::Event, pump->id);
+        putU8(out, quint8(kind));
+        putU32(out, detail);
+        putU64(out, pump->ticks);
+        putF64(out, value);
+        endFrame(out, start);
+
+        if (int(out.size() - connection->outputOffset) > maxPendingOutput)
+            connection->closing = true;
+    }
+}
+
+void PumpServer::handleFrame(PumpConnection *connection, const uchar *frame, quint32 length) {
+    PumpCommand command = PumpCommand(frame[0]);
+    quint32 pumpId = getU32(frame + 1);
+    const uchar *body = frame + 5;
+    quint32 bodyLength = length - 5;
+
+    if (command == PumpCommand::Open) {
+        Profile profile("Remote", 0, 0, 0, 0);
+        if (!readProfile(body, bodyLength, profile)) {
+            reply(connection, command, 0, PumpStatus::Malformed);
+            return;
+        }
+        quint32 id = quint32(pumps.size() + 1);
+        pumps.push_back(new SimulatedPump(id, connection, profile));
+        reply(connection, command, id, PumpStatus::Ok, id);
+        return;
+    }
+
+    SimulatedPump *pump = findPump(pumpId);
+    if (!pump) {
+        reply(connection, command, pumpId, PumpStatus::UnknownPump);
+        return;
+    }
+
+    switch (command) {
+    case PumpCommand::Close:
+        if (pump->owner != connection) {
+            reply(connection, command, pumpId, PumpStatus::Rejected);
+            return;
+        }
+        closePump(pumpId);
+        reply(connection, command, pumpId, PumpStatus::Ok);
+        return;
+
+    case PumpCommand::Bolus: {
+        if (bodyLength < 8) break;
+        double units = getF64(body);
+        if (!std::isfinite(units)) break;
+        if (!pump->pump.administerInsulin(units, DeliveryType::Bolus)) {
+            reply(connection, command, pumpId, PumpStatus::Rejected, pump->pump.getInsulinRemaining());
+            return;
+        }
+        emitEvent(pump, quint32(TelemetryKind::Delivery), quint32(DeliveryType::Bolus), units);
+        reply(connection, command, pumpId, PumpStatus::Ok, pump->pump.getInsulinRemaining());
+        return;
+    }
+
+    case PumpCommand::SetBasal: {
+        if (bodyLength < 8) break;
+        double rate = getF64(body);
+        if (!std::isfinite(rate)) break;
+        pump->pump.setBasalRate(rate);
+        emitEvent(pump, quint32(TelemetryKind::BasalChange), 0, pump->pump.getBasalRate());
+        reply(connection, command, pumpId, PumpStatus::Ok, pump->pump.getBasalRate());
+        return;
+    }
+
+    case PumpCommand::SwitchProfile: {
+        // The controller holds a pointer to pump->profile and reads it on its next tick.
+        if (!readProfile(body, bodyLength, pump->profile)) break;
+        pump->cgm.setCorrectionFactor(pump->profile.correctionFactor);
+        pump->pump.setBasalRate(pump->profile.basalRate);
+        emitEvent(pump, quint32(TelemetryKind::BasalChange), 0, pump->pump.getBasalRate());
+        reply(connection, command, pumpId, PumpStatus::Ok, pump->pump.getBasalRate());
+        return;
+    }
+
+    case PumpCommand::Refill:
+        pump->pump.refillCartridge();
+        emitEvent(pump, quint32(TelemetryKind::Delivery), quint32(DeliveryType::CartridgeRefill), 0);
+        reply(connection, command, pumpId, PumpStatus::Ok, pump->pump.getInsulinRemaining());
+        return;
+
+    case PumpCommand::Subscribe: {
+        if (bodyLength < 4) break;
+        quint32 mask = getU32(body);
+        std::vector<PumpSubscription> &subscribers = pump->subscribers;
+        auto existing = std::find_if(subscribers.begin(), subscribers.end(),
+                                     [connection](const PumpSubscription &s) { return s.connection == connection; });
+        if (existing != subscribers.end()) {
+            if (mask)
+                existing->mask = mask;
+            else
+                subscribers.erase(existing);
+        } else if (mask) {
+            PumpSubscription subscription = { connection, mask };
+            subscribers.push_back(subscription);
+        }
+        reply(connection, command, pumpId, PumpStatus::Ok);
+        return;
+    }
+
+    case PumpCommand::Step: {
+        if (bodyLength < 4) break;
+        quint32 ticks = getU32(body);
+        // Steps run inside the event loop; larger advances have to be split across requests.
+        if (ticks > maxStepTicks) {
+            reply(connection, command, pumpId, PumpStatus::Rejected, pump->cgm.getGlucoseLevel());
+            return;
+        }
+        for (quint32 n = 0; n < ticks; ++n)
+            tick(pump);
+        reply(connection, command, pumpId, PumpStatus::Ok, pump->cgm.getGlucoseLevel());
+        return;
+    }
+
+    default:
+        break;
+    }
+    reply(connection, command, pumpId, PumpStatus::Malformed);
+}
+
+// Five minutes of pump time: CGM reading, controller decision, basal tick.
+void PumpServer::tick(SimulatedPump *pump) {
+    ++pump->ticks;
+    pump->cgm.readGlucose();
+    emitEvent(pump, quint32(TelemetryKind::GlucoseReading), 0, pump->cgm.getGlucoseLevel());
+
+    Milliunits remaining = pump->pump.getInsulinRemainingMilliunits();
+    Milliunits rate = pump->pump.getBasalRateMilliunits();
+    pump->controller.tick();
+    if (pump->pump.getBasalRateMilliunits() != rate)
+        emitEvent(pump, quint32(TelemetryKind::BasalChange), 0, pump->pump.getBasalRate());
+    Milliunits correction = remaining - pump->pump.getInsulinRemainingMilliunits();
+    if (correction > 0)
+        emitEvent(pump, quint32(TelemetryKind::Delivery), quint32(DeliveryType::ControlIQCorrection), toUnits(correction));
+
+    Milliunits basal = pump->pump.deliverBasalTick();
+    if (basal > 0)
+        emitEvent(pump, quint32(TelemetryKind::Delivery), quint32(DeliveryType::Basal), toUnits(basal));
+}
+
+void PumpServer::tickAll() {
+    TraceSpan span("Remote pumps tick", "sense");
+    for (SimulatedPump *pump : pumps) {
+        if (pump)
+            tick(pump);
+    }
+}
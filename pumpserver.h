@@ -0,0 +1,119 @@
+#ifndef PUMPSERVER_H
+#define PUMPSERVER_H
+
+#include <QtGlobal>
+#include <atomic>
+#include <vector>
+
+// Headless pump control over a Unix domain socket, for test harnesses and hardware-in-the-loop rigs.
+//
+// One process hosts any number of simulated pumps (Profile + CGM + InsulinPump + ControlIQ), all
+// served by a single epoll loop: non-blocking sockets, no thread per client. Simulated time is
+// advanced either by a periodic timer (tickMilliseconds > 0) or explicitly with the Step command;
+// each tick is 5 minutes of pump time (one CGM reading, one controller decision, one basal tick).
+// Stepping makes the timing reproducible, not the values: CGM noise and the controller's drift
+// prediction are still random, so two runs of the same command sequence diverge.
+//
+// Every message is a frame, all integers little-endian and doubles IEEE 754 little-endian:
+//
+//   u32 length     bytes that follow (type + pump + body)
+//   u8  type       PumpCommand from the client, PumpMessage from the server
+//   u32 pump       pump id, ignored by Open
+//   ... body
+//
+// Command bodies:
+//   Open           f64 basalRate, f64 carbohydrateRate, f64 correctionFactor, f64 targetGlucose
+//   Close          -
+//   Bolus          f64 units
+//   SetBasal       f64 u/hr
+//   SwitchProfile  f64 basalRate, f64 carbohydrateRate, f64 correctionFactor, f64 targetGlucose
+//   Refill         -
+//   Subscribe      u32 event mask, bit (1 << TelemetryKind); 0 unsubscribes
+//   Step           u32 ticks, at most maxStepTicks (Rejected otherwise)
+//
+// Every command is answered, in order, by a Reply: u8 command, u8 PumpStatus, f64 value
+// (Open: the new pump id; Bolus, Refill: insulin remaining; SetBasal, SwitchProfile: basal rate;
+// Step: glucose after the last tick). Subscribers additionally receive Event frames:
+// u8 TelemetryKind, u32 detail, u64 tick, f64 value (same meaning as in telemetrybus.h).
+
+enum class PumpCommand : quint8 {
+    Open = 1,
+    Close = 2,
+    Bolus = 3,
+    SetBasal = 4,
+    SwitchProfile = 5,
+    Refill = 6,
+    Subscribe = 7,
+    Step = 8
+};
+
+enum class PumpMessage : quint8 {
+    Reply = 0x80,
+    Event = 0x81
+};
+
+enum class PumpStatus : quint8 {
+    Ok = 0,
+    UnknownPump = 1,
+    Rejected = 2,   // e.g. not enough insulin for a bolus
+    Malformed = 3
+};
+
+struct SimulatedPump;
+struct PumpConnection;
+
+class PumpServer {
+    private:
+        int epollFd;
+        int listenFd;
+        int timerFd;
+        int wakeFd;  // eventfd written by stop() to interrupt epoll_wait
+        int tickMilliseconds;
+        std::atomic<bool> running;
+        char socketPath[108];
+        std::vector<SimulatedPump*> pumps;  // indexed by pump id - 1, nullptr once closed
+        std::vector<PumpConnection*> connections;
+
+        void acceptConnections();
+        void readFrom(PumpConnection *connection);
+        bool handleFrames(PumpConnection *connection);
+        void flush(PumpConnection *connection);
+        void closeConnection(PumpConnection *connection);
+        void handleFrame(PumpConnection *connection, const uchar *frame, quint32 length);
+        void reply(PumpConnection *connection, PumpCommand command, quint32 pumpId, PumpStatus status, double value = 0);
+        void emitEvent(SimulatedPump *pump, quint32 kind, quint32 detail, double value);
+        void tick(SimulatedPump *pump);
+        void tickAll();
+        void closePump(quint32 pumpId);
+        SimulatedPump *findPump(quint32 pumpId) const;
+
+    public:
+        // Frames larger than this close the connection; so does a client that stops reading
+        // and lets more than maxPendingOutput bytes of replies and events pile up.
+        static const quint32 maxFrameLength = 4096;
+        static const int maxPendingOutput = 4 * 1024 * 1024;
+        // A Step runs synchronously in the event loop; this bounds how long one request can stall it
+        // (a week of pump time).
+        static const quint32 maxStepTicks = 7 * 24 * 12;
+        // Per connection and epoll wakeup: bytes buffered from the socket, and frames and stepped ticks
+        // handled. Requests beyond that wait for the next wakeup, after every other connection had
+        // its turn.
+        static const quint32 maxInputBuffered = 64 * 1024;
+        static const int maxFramesPerWakeup = 256;
+        static const quint32 maxTicksPerWakeup = maxStepTicks;
+
+        explicit PumpServer(int tickMilliseconds = 0);
+        ~PumpServer();
+
+        // Binds and listens on path, replacing a stale socket file.
+        bool listen(const char *path);
+
+        // Serves clients until stop() is called. Returns false if the loop failed to start.
+        bool exec();
+        // Makes exec() return after the current batch. Safe to call from any thread.
+        void stop();
+
+        int pumpCount() const;
+};
+
+#endif // PUMPSERVER_H
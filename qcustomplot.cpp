@@ -25,6 +25,26 @@
 
 #include "qcustomplot.h"
 
+// Render phase spans for the application's tracer (tracing.h); compiles away without it.
+#ifdef INSULINPUMP_TRACING
+#  include "tracing.h"
+#  define QCP_TRACE_SPAN(name, detail) TraceSpan qcpTraceSpan(name, "render", detail)
+#else
+#  define QCP_TRACE_SPAN(name, detail) do {} while (0)
+#endif
+
+// Vectorised colorize kernels, compiled for AVX2 and selected at runtime (see QCPColorGradient::colorize).
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#  define QCP_COLORIZE_AVX2
+#  include <immintrin.h>
+#endif
+
+// Thread pool used by QCPColorMap::updateMapImage.
+#include <QtCore/QRunnable>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThreadPool>
+#include <functional>
+
 
 /* including file 'src/vector2d.cpp'       */
 /* modified 2022-11-06T12:45:56, size 7973 */
@@ -271,6 +291,335 @@ QCPVector2D &QCPVector2D::operator-=(const QCPVector2D &vector)
 /* end of 'src/vector2d.cpp' */
 
 
+/* including file 'src/pixelgrid.cpp' */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////// QCPPixelGrid
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! \class QCPPixelGrid
+  \brief A spatial index of points or line segments in pixel coordinates
+  
+  QCPPixelGrid divides a pixel rect, typically an axis rect, into square cells and records which
+  points (\ref setPoints) or line segments (\ref setSegments) fall into each cell. This lets \ref
+  nearest find the item closest to a pixel position by looking only at the cells around it, and
+  \ref pointsIn the points inside a rect by looking only at the cells the rect covers, instead of
+  testing every item. Plottables use it to speed up hit-testing of dense data, see \ref
+  QCPGraph::setSpatialIndex.
+  
+  Items outside the bounds are recorded in the nearest border cell, so queries stay exact for
+  positions within the bounds. Items with NaN coordinates are left out.
+*/
+
+/*!
+  Creates an empty pixel grid.
+*/
+QCPPixelGrid::QCPPixelGrid() :
+  mCellSize(8),
+  mColumns(0),
+  mRows(0),
+  mStep(0)
+{
+}
+
+/*!
+  Indexes the given \a points, replacing any previous items. The grid covers \a bounds with cells
+  of \a cellSize pixels. The item indices returned by \ref nearest and \ref pointsIn are indices
+  into \a points.
+*/
+void QCPPixelGrid::setPoints(const QVector<QPointF> &points, const QRect &bounds, int cellSize)
+{
+  setupCells(bounds, cellSize);
+  mStep = 0;
+  mPoints = points;
+  
+  // count the points of each cell, then place them in one array ordered by cell:
+  QVector<int> cells(points.size(), -1);
+  for (int i=0; i<points.size(); ++i)
+  {
+    const QPointF &point = points.at(i);
+    if (qIsNaN(point.x()) || qIsNaN(point.y()))
+      continue;
+    cells[i] = row(point.y())*mColumns+column(point.x());
+    ++mCellStart[cells.at(i)+1];
+  }
+  for (int c=0; c<mColumns*mRows; ++c)
+    mCellStart[c+1] += mCellStart.at(c);
+  mItems.resize(mCellStart.last());
+  QVector<int> fill(mCellStart);
+  for (int i=0; i<points.size(); ++i)
+  {
+    if (cells.at(i) >= 0)
+      mItems[fill[cells.at(i)]++] = i;
+  }
+}
+
+/*!
+  Indexes the line segments given by \a lines, replacing any previous items. A segment starts at
+  every \a step-th point and ends at the point after it, so a polyline is indexed with \a step 1
+  and separate point pairs (e.g. \ref QCPGraph::lsImpulse lines) with \a step 2. The item indices
+  returned by \ref nearest are the indices of the segments' start points in \a lines.
+  
+  A segment is recorded in all cells its bounding rect touches.
+*/
+void QCPPixelGrid::setSegments(const QVector<QPointF> &lines, int step, const QRect &bounds, int cellSize)
+{
+  setupCells(bounds, cellSize);
+  mStep = qMax(1, step);
+  mPoints = lines;
+  
+  // count the segments of each cell, then place them in one array ordered by cell:
+  for (int pass=0; pass<2; ++pass)
+  {
+    QVector<int> fill;
+    if (pass == 1)
+    {
+      for (int c=0; c<mColumns*mRows; ++c)
+        mCellStart[c+1] += mCellStart.at(c);
+      mItems.resize(mCellStart.last());
+      fill = mCellStart;
+    }
+    for (int i=0; i<lines.size()-1; i+=mStep)
+    {
+      const QPointF &start = lines.at(i);
+      const QPointF &end = lines.at(i+1);
+      if (qIsNaN(start.x()) || qIsNaN(start.y()) || qIsNaN(end.x()) || qIsNaN(end.y()))
+        continue;
+      const int columnBegin = column(qMin(start.x(), end.x()));
+      const int columnEnd = column(qMax(start.x(), end.x()));
+      const int rowBegin = row(qMin(start.y(), end.y()));
+      const int rowEnd = row(qMax(start.y(), end.y()));
+      for (int r=rowBegin; r<=rowEnd; ++r)
+      {
+        for (int c=columnBegin; c<=columnEnd; ++c)
+        {
+          if (pass == 0)
+            ++mCellStart[r*mColumns+c+1];
+          else
+            mItems[fill[r*mColumns+c]++] = i;
+        }
+      }
+    }
+  }
+}
+
+/*!
+  Removes all items from the grid.
+*/
+void QCPPixelGrid::clear()
+{
+  mPoints.clear();
+  mCellStart.clear();
+  mItems.clear();
+  mColumns = 0;
+  mRows = 0;
+}
+
+/*!
+  Returns the index of the item closest to \a pos and sets \a distance to its distance in pixels.
+  If the grid is empty, returns -1 and sets \a distance to the square root of the largest double,
+  like the plottables' linear distance searches do when they find nothing.
+  
+  The cells are searched in rings of growing distance around the cell of \a pos, stopping once no
+  unsearched cell can hold a closer item. The result is exact if \a pos lies within \ref bounds.
+*/
+int QCPPixelGrid::nearest(const QPointF &pos, double &distance) const
+{
+  int result = -1;
+  double minDistSqr = (std::numeric_limits<double>::max)();
+  if (mItems.isEmpty())
+  {
+    distance = qSqrt(minDistSqr);
+    return result;
+  }
+  
+  const int posColumn = column(pos.x());
+  const int posRow = row(pos.y());
+  const int maxRing = qMax(qMax(posColumn, mColumns-1-posColumn), qMax(posRow, mRows-1-posRow));
+  for (int ring=0; ring<=maxRing; ++ring)
+  {
+    // items in this ring or beyond are at least (ring-1) cells away:
+    const double ringDist = (ring-1)*double(mCellSize);
+    if (ring > 0 && result >= 0 && minDistSqr <= ringDist*ringDist)
+      break;
+    const int rowBegin = qMax(0, posRow-ring);
+    const int rowEnd = qMin(mRows-1, posRow+ring);
+    for (int r=rowBegin; r<=rowEnd; ++r)
+    {
+      // full row at the top and bottom of the ring, only its left and right cell in between:
+      const bool edgeRow = r == posRow-ring || r == posRow+ring;
+      const int columnStep = edgeRow ? 1 : qMax(1, 2*ring);
+      for (int c=posColumn-ring; c<=posColumn+ring; c+=columnStep)
+      {
+        if (c < 0 || c >= mColumns)
+          continue;
+        const int cell = r*mColumns+c;
+        for (int i=mCellStart.at(cell); i<mCellStart.at(cell+1); ++i)
+        {
+          const double distSqr = itemDistanceSquared(mItems.at(i), pos);
+          if (distSqr < minDistSqr)
+          {
+            minDistSqr = distSqr;
+            result = mItems.at(i);
+          }
+        }
+      }
+    }
+  }
+  distance = qSqrt(minDistSqr);
+  return result;
+}
+
+/*!
+  Returns the indices of the points inside \a rect (including its border), in ascending order. Only
+  meaningful if the grid was filled with \ref setPoints.
+*/
+QVector<int> QCPPixelGrid::pointsIn(const QRectF &rect) const
+{
+  QVector<int> result;
+  if (mItems.isEmpty() || mStep != 0)
+    return result;
+  const QRectF bounds = rect.normalized();
+  const int rowEnd = row(bounds.bottom());
+  const int columnEnd = column(bounds.right());
+  for (int r=row(bounds.top()); r<=rowEnd; ++r)
+  {
+    for (int c=column(bounds.left()); c<=columnEnd; ++c)
+    {
+      const int cell = r*mColumns+c;
+      for (int i=mCellStart.at(cell); i<mCellStart.at(cell+1); ++i)
+      {
+        const QPointF &point = mPoints.at(mItems.at(i));
+        if (point.x() >= bounds.left() && point.x() <= bounds.right() && point.y() >= bounds.top() && point.y() <= bounds.bottom())
+          result.append(mItems.at(i));
+      }
+    }
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+/*! \internal
+  
+  Covers \a bounds with empty cells of \a cellSize pixels.
+*/
+void QCPPixelGrid::setupCells(const QRect &bounds, int cellSize)
+{
+  mBounds = bounds;
+  mCellSize = qMax(1, cellSize);
+  mColumns = qMax(1, (bounds.width()+mCellSize-1)/mCellSize);
+  mRows = qMax(1, (bounds.height()+mCellSize-1)/mCellSize);
+  mCellStart.fill(0, mColumns*mRows+1);
+  mItems.clear();
+}
+
+/*! \internal
+  
+  Returns the squared pixel distance of \a pos to the point or segment \a item.
+*/
+double QCPPixelGrid::itemDistanceSquared(int item, const QPointF &pos) const
+{
+  if (mStep == 0)
+    return QCPVector2D(mPoints.at(item)-pos).lengthSquared();
+  else
+    return QCPVector2D(pos).distanceSquaredToLine(QCPVector2D(mPoints.at(item)), QCPVector2D(mPoints.at(item+1)));
+}
+/* end of 'src/pixelgrid.cpp' */
+
+
+/* including file 'src/columnreducer.cpp' */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////// QCPColumnReducer
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! \class QCPColumnReducer
+  \brief Reduces a dense line to the minimum and maximum value per pixel column
+  
+  Plottables with many more data points than the key axis has pixels feed the points, in key
+  order and already in pixel coordinates, to \ref addPoint. Points falling into the same pixel
+  column are merged into that column's minimum and maximum value, appended in the order they
+  occurred, which draws the same shape with at most two points per column. Call \ref finish after
+  the last point to flush the last column.
+  
+  A NaN value closes the current column and appends a single point with NaN value per run of NaNs,
+  so the line is broken there just as without the reduction.
+*/
+
+/*!
+  Creates a reducer that appends to \a lines. \a keyIsHorizontal determines whether the key pixel
+  is the x or the y coordinate of the appended points.
+*/
+QCPColumnReducer::QCPColumnReducer(QVector<QPointF> *lines, bool keyIsHorizontal) :
+  mLines(lines),
+  mKeyIsHorizontal(keyIsHorizontal),
+  mColumn((std::numeric_limits<int>::min)()),
+  mColumnKey(0),
+  mMinValue(0),
+  mMaxValue(0),
+  mMinFirst(true),
+  mGap(false)
+{
+}
+
+/*!
+  Adds the point at \a keyPixel, \a valuePixel. \a valuePixel may be NaN to mark a gap.
+*/
+void QCPColumnReducer::addPoint(double keyPixel, double valuePixel)
+{
+  if (qIsNaN(valuePixel))
+  {
+    closeColumn();
+    if (!mGap)
+      append(keyPixel, qQNaN());
+    mGap = true;
+    return;
+  }
+  mGap = false;
+  const int column = int(qFloor(keyPixel));
+  if (column != mColumn)
+  {
+    closeColumn();
+    mColumn = column;
+    mColumnKey = keyPixel;
+    mMinValue = mMaxValue = valuePixel;
+    mMinFirst = true;
+  } else if (valuePixel < mMinValue)
+  {
+    mMinValue = valuePixel;
+    mMinFirst = false;
+  } else if (valuePixel > mMaxValue)
+  {
+    mMaxValue = valuePixel;
+    mMinFirst = true;
+  }
+}
+
+/*!
+  Appends the points of the last column. The reducer can be reused afterwards.
+*/
+void QCPColumnReducer::finish()
+{
+  closeColumn();
+  mGap = false;
+}
+
+/*! \internal
+
+  Appends the extremes of the current column, if any, and starts over.
+*/
+void QCPColumnReducer::closeColumn()
+{
+  if (mColumn == (std::numeric_limits<int>::min)())
+    return;
+  append(mColumnKey, mMinFirst ? mMinValue : mMaxValue);
+  if (mMinValue != mMaxValue)
+    append(mColumnKey, mMinFirst ? mMaxValue : mMinValue);
+  mColumn = (std::numeric_limits<int>::min)();
+}
+/* end of 'src/columnreducer.cpp' */
+
+
 /* including file 'src/painter.cpp'        */
 /* modified 2022-11-06T12:45:56, size 8656 */
 
@@ -15129,6 +15478,7 @@ void QCustomPlot::replot(QCustomPlot::RefreshPriority refreshPriority)
   
   if (mReplotting) // incase signals loop back to replot slot
     return;
+  QCP_TRACE_SPAN("replot", "");
   mReplotting = true;
   mReplotQueued = false;
   emit beforeReplot();
@@ -15141,11 +15491,20 @@ void QCustomPlot::replot(QCustomPlot::RefreshPriority refreshPriority)
   replotTimer.start();
 # endif
   
-  updateLayout();
+  {
+    QCP_TRACE_SPAN("updateLayout", "");
+    updateLayout();
+  }
   // draw all layered objects (grid, axes, plottables, items, legend,...) into their buffers:
-  setupPaintBuffers();
+  {
+    QCP_TRACE_SPAN("setupPaintBuffers", "");
+    setupPaintBuffers();
+  }
   foreach (QCPLayer *layer, mLayers)
+  {
+    QCP_TRACE_SPAN("drawToPaintBuffer", layer->name());
     layer->drawToPaintBuffer();
+  }
   foreach (QSharedPointer<QCPAbstractPaintBuffer> buffer, mPaintBuffers)
     buffer->setInvalidated(false);
   
@@ -16688,6 +17047,64 @@ void QCPColorGradient::setPeriodic(bool enabled)
   mPeriodic = enabled;
 }
 
+/*! \internal
+
+  Returns whether the CPU supports the AVX2 colorize kernel.
+*/
+static bool qcpColorizeAvx2Available()
+{
+#ifdef QCP_COLORIZE_AVX2
+  static const bool available = __builtin_cpu_supports("avx2");
+  return available;
+#else
+  return false;
+#endif
+}
+
+#ifdef QCP_COLORIZE_AVX2
+/*! \internal
+
+  AVX2 kernel of \ref QCPColorGradient::colorize for linear, non-periodic gradients. Colorizes the
+  first <tt>n - n%4</tt> values four at a time (strided loads and the color buffer lookup are
+  gathers) and returns that count; the caller does the remainder with the scalar loop.
+
+  The output is identical to the scalar loop: the scaled position is clamped to <tt>[0,
+  levelCount-1]</tt> before truncation, which is the same as truncating and then clamping, and
+  positions that the scalar qint64 conversion cannot represent (NaN, beyond 2^63) yield index 0,
+  as the x86 conversion does there. If \a nanColor is given, NaN values get that color instead.
+*/
+__attribute__((target("avx2")))
+static int qcpColorizeLinearAvx2(const double *data, int dataIndexFactor, double lower, double posToIndexFactor,
+                                 const QRgb *colors, int levelCount, const QRgb *nanColor, QRgb *scanLine, int n)
+{
+  const __m256d lowerV = _mm256_set1_pd(lower);
+  const __m256d factorV = _mm256_set1_pd(posToIndexFactor);
+  const __m256d zero = _mm256_setzero_pd();
+  const __m256d maxIndex = _mm256_set1_pd(levelCount-1);
+  const __m256d representable = _mm256_set1_pd(9223372036854775808.0); // 2^63
+  const __m128i offsets = _mm_mullo_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32(dataIndexFactor));
+  const __m256i packLow = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+  const __m128i nanV = _mm_set1_epi32(nanColor ? int(*nanColor) : 0);
+  const int count = n - n%4;
+  for (int i=0; i<count; i+=4)
+  {
+    const double *source = data + qint64(dataIndexFactor)*i;
+    const __m256d value = dataIndexFactor == 1 ? _mm256_loadu_pd(source) : _mm256_i32gather_pd(source, offsets, 8);
+    const __m256d position = _mm256_mul_pd(_mm256_sub_pd(value, lowerV), factorV);
+    __m256d clamped = _mm256_min_pd(_mm256_max_pd(position, zero), maxIndex);
+    clamped = _mm256_blendv_pd(zero, clamped, _mm256_cmp_pd(position, representable, _CMP_LT_OQ));
+    __m128i rgb = _mm_i32gather_epi32(reinterpret_cast<const int*>(colors), _mm256_cvttpd_epi32(clamped), 4);
+    if (nanColor)
+    {
+      const __m256i nanMask = _mm256_castpd_si256(_mm256_cmp_pd(value, value, _CMP_UNORD_Q));
+      rgb = _mm_blendv_epi8(rgb, nanV, _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(nanMask, packLow)));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(scanLine+i), rgb);
+  }
+  return count;
+}
+#endif
+
 /*! \overload
   
   This method is used to quickly convert a \a data array to colors. The colors will be output in
@@ -16708,7 +17125,10 @@ void QCPColorGradient::setPeriodic(bool enabled)
 */
 void QCPColorGradient::colorize(const double *data, const QCPRange &range, QRgb *scanLine, int n, int dataIndexFactor, bool logarithmic)
 {
-  // If you change something here, make sure to also adapt color() and the other colorize() overload
+  // If you change something here, make sure to also adapt color() and the other colorize() overload.
+  // QCPColorMap calls this from several threads at once on one gradient (after bringing the color
+  // buffer up to date), so past updateColorBuffer it must not write any member: read mColorBuffer
+  // only through at()/constData(), since the non-const accessors may detach the shared buffer.
   if (!data)
   {
     qDebug() << Q_FUNC_INFO << "null pointer given as data";
@@ -16724,7 +17144,8 @@ void QCPColorGradient::colorize(const double *data, const QCPRange &range, QRgb
   
   const bool skipNanCheck = mNanHandling == nhNone;
   const double posToIndexFactor = !logarithmic ? (mLevelCount-1)/range.size() : (mLevelCount-1)/qLn(range.upper/range.lower);
-  for (int i=0; i<n; ++i)
+  const int first = colorizeVectorized(data, range, scanLine, n, dataIndexFactor, logarithmic, posToIndexFactor);
+  for (int i=first; i<n; ++i)
   {
     const double value = data[dataIndexFactor*i];
     if (skipNanCheck || !std::isnan(value))
@@ -16744,8 +17165,8 @@ void QCPColorGradient::colorize(const double *data, const QCPRange &range, QRgb
     {
       switch(mNanHandling)
       {
-      case nhLowestColor: scanLine[i] = mColorBuffer.first(); break;
-      case nhHighestColor: scanLine[i] = mColorBuffer.last(); break;
+      case nhLowestColor: scanLine[i] = mColorBuffer.at(0); break;
+      case nhHighestColor: scanLine[i] = mColorBuffer.at(mColorBuffer.size()-1); break;
       case nhTransparent: scanLine[i] = qRgba(0, 0, 0, 0); break;
       case nhNanColor: scanLine[i] = mNanColor.rgba(); break;
       case nhNone: break; // shouldn't happen
@@ -16764,7 +17185,8 @@ void QCPColorGradient::colorize(const double *data, const QCPRange &range, QRgb
 */
 void QCPColorGradient::colorize(const double *data, const unsigned char *alpha, const QCPRange &range, QRgb *scanLine, int n, int dataIndexFactor, bool logarithmic)
 {
-  // If you change something here, make sure to also adapt color() and the other colorize() overload
+  // If you change something here, make sure to also adapt color() and the other colorize() overload.
+  // Must stay free of writes past updateColorBuffer, see the other overload.
   if (!data)
   {
     qDebug() << Q_FUNC_INFO << "null pointer given as data";
@@ -16785,7 +17207,18 @@ void QCPColorGradient::colorize(const double *data, const unsigned char *alpha,
   
   const bool skipNanCheck = mNanHandling == nhNone;
   const double posToIndexFactor = !logarithmic ? (mLevelCount-1)/range.size() : (mLevelCount-1)/qLn(range.upper/range.lower);
-  for (int i=0; i<n; ++i)
+  const int first = colorizeVectorized(data, range, scanLine, n, dataIndexFactor, logarithmic, posToIndexFactor);
+  for (int i=0; i<first; ++i) // apply alpha to the vectorized part, NaN colors stay as they are (like below)
+  {
+    const unsigned char a = alpha[dataIndexFactor*i];
+    if (a != 255 && (skipNanCheck || !std::isnan(data[dataIndexFactor*i])))
+    {
+      const QRgb rgb = scanLine[i];
+      const float alphaF = a/255.0f;
+      scanLine[i] = qRgba(int(qRed(rgb)*alphaF), int(qGreen(rgb)*alphaF), int(qBlue(rgb)*alphaF), int(qAlpha(rgb)*alphaF));
+    }
+  }
+  for (int i=first; i<n; ++i)
   {
     const double value = data[dataIndexFactor*i];
     if (skipNanCheck || !std::isnan(value))
@@ -16813,8 +17246,8 @@ void QCPColorGradient::colorize(const double *data, const unsigned char *alpha,
     {
       switch(mNanHandling)
       {
-      case nhLowestColor: scanLine[i] = mColorBuffer.first(); break;
-      case nhHighestColor: scanLine[i] = mColorBuffer.last(); break;
+      case nhLowestColor: scanLine[i] = mColorBuffer.at(0); break;
+      case nhHighestColor: scanLine[i] = mColorBuffer.at(mColorBuffer.size()-1); break;
       case nhTransparent: scanLine[i] = qRgba(0, 0, 0, 0); break;
       case nhNanColor: scanLine[i] = mNanColor.rgba(); break;
       case nhNone: break; // shouldn't happen
@@ -16823,6 +17256,39 @@ void QCPColorGradient::colorize(const double *data, const unsigned char *alpha,
   }
 }
 
+/*! \internal
+
+  Colorizes as many leading values of \a data as a vectorized kernel can and returns how many
+  that were, so \ref colorize continues with its scalar loop from there. Only linear, non-periodic
+  gradients are vectorized; logarithmic and periodic ones return 0, since a vectorized logarithm
+  would not reproduce the scalar color indices exactly at level boundaries.
+
+  Expects the color buffer to be up to date.
+*/
+int QCPColorGradient::colorizeVectorized(const double *data, const QCPRange &range, QRgb *scanLine, int n, int dataIndexFactor, bool logarithmic, double posToIndexFactor)
+{
+  if (logarithmic || mPeriodic || n < 4 || !qcpColorizeAvx2Available())
+    return 0;
+#ifdef QCP_COLORIZE_AVX2
+  if (qint64(dataIndexFactor)*4 > (std::numeric_limits<int>::max)()) // gather offsets are 32 bit
+    return 0;
+  QRgb nanColor = 0;
+  switch(mNanHandling)
+  {
+  case nhLowestColor: nanColor = mColorBuffer.at(0); break;
+  case nhHighestColor: nanColor = mColorBuffer.at(mColorBuffer.size()-1); break;
+  case nhTransparent: nanColor = qRgba(0, 0, 0, 0); break;
+  case nhNanColor: nanColor = mNanColor.rgba(); break;
+  case nhNone: break;
+  }
+  return qcpColorizeLinearAvx2(data, dataIndexFactor, range.lower, posToIndexFactor, mColorBuffer.constData(), mLevelCount,
+                               mNanHandling == nhNone ? nullptr : &nanColor, scanLine, n);
+#else
+  Q_UNUSED(data) Q_UNUSED(range) Q_UNUSED(scanLine) Q_UNUSED(dataIndexFactor) Q_UNUSED(posToIndexFactor)
+  return 0;
+#endif
+}
+
 /*! \internal
 
   This method is used to colorize a single data value given in \a position, to colors. The data
@@ -16846,8 +17312,8 @@ QRgb QCPColorGradient::color(double position, const QCPRange &range, bool logari
   {
     switch(mNanHandling)
     {
-    case nhLowestColor: return mColorBuffer.first();
-    case nhHighestColor: return mColorBuffer.last();
+    case nhLowestColor: return mColorBuffer.at(0);
+    case nhHighestColor: return mColorBuffer.at(mColorBuffer.size()-1);
     case nhTransparent: return qRgba(0, 0, 0, 0);
     case nhNanColor: return mNanColor.rgba();
     case nhNone: return qRgba(0, 0, 0, 0); // shouldn't happen
@@ -20880,7 +21346,11 @@ QCPGraph::QCPGraph(QCPAxis *keyAxis, QCPAxis *valueAxis) :
   QCPAbstractPlottable1D<QCPGraphData>(keyAxis, valueAxis),
   mLineStyle{},
   mScatterSkip{},
-  mAdaptiveSampling{}
+  mAdaptiveSampling{},
+  mSpatialIndex(false),
+  mPointGridOffset(0),
+  mSpatialIndexValid(false),
+  mSpatialIndexRevision(0)
 {
   // special handling for QCPGraphs to maintain the simple graph interface:
   mParentPlot->registerGraph(this);
@@ -20916,6 +21386,7 @@ QCPGraph::~QCPGraph()
 void QCPGraph::setData(QSharedPointer<QCPGraphDataContainer> data)
 {
   mDataContainer = data;
+  mSpatialIndexValid = false;
 }
 
 /*! \overload
@@ -20944,6 +21415,7 @@ void QCPGraph::setData(const QVector<double> &keys, const QVector<double> &value
 void QCPGraph::setLineStyle(LineStyle ls)
 {
   mLineStyle = ls;
+  mSpatialIndexValid = false;
 }
 
 /*!
@@ -21036,6 +21508,32 @@ void QCPGraph::setChannelFillGraph(QCPGraph *targetGraph)
 void QCPGraph::setAdaptiveSampling(bool enabled)
 {
   mAdaptiveSampling = enabled;
+  mSpatialIndexValid = false;
+}
+
+/*!
+  Sets whether this graph keeps a spatial index of its visible data points and line segments in
+  pixel coordinates (see \ref QCPPixelGrid). With the index, \ref selectTest and \ref
+  selectTestRect only look at the part of the graph near the tested position, instead of all data
+  in the tested key range and all visible line segments. This keeps hit-testing fast on every mouse
+  move, e.g. for \ref QCustomPlot::plottableAt in hover tooltips, when the graph has many points.
+  
+  The index is built on the first hit-test after the axis ranges, the axis rect or the data
+  changed, in time linear in the number of visible points, and takes roughly 20 to 40 bytes per
+  visible point. It is only used for positions within the axis rect, others are tested without it.
+  
+  Unlike the test without index, the closest data point reported in the details of \ref selectTest
+  isn't restricted to the key range within the selection tolerance; this only makes a difference if
+  no data point is within the selection tolerance.
+  
+  By default, the spatial index is disabled.
+*/
+void QCPGraph::setSpatialIndex(bool enabled)
+{
+  mSpatialIndex = enabled;
+  mSpatialIndexValid = false;
+  mPointGrid.clear();
+  mLineGrid.clear();
 }
 
 /*! \overload
@@ -21081,6 +21579,43 @@ void QCPGraph::addData(double key, double value)
   mDataContainer->add(QCPGraphData(key, value));
 }
 
+/*!
+  \copydoc QCPPlottableInterface1D::selectTestRect
+  
+  If the spatial index is enabled (\ref setSpatialIndex), only the data points in the index cells
+  covered by \a rect are tested.
+*/
+QCPDataSelection QCPGraph::selectTestRect(const QRectF &rect, bool onlySelectable) const
+{
+  if ((onlySelectable && mSelectable == QCP::stNone) || mDataContainer->isEmpty())
+    return QCPDataSelection();
+  // data outside the visible key range isn't indexed, so rects reaching beyond the axis rect are tested without index:
+  if (!updateSpatialIndex() || !QRectF(mPointGrid.bounds()).contains(rect.normalized()))
+    return QCPAbstractPlottable1D<QCPGraphData>::selectTestRect(rect, onlySelectable);
+  
+  QCPDataSelection result;
+  const QVector<int> points = mPointGrid.pointsIn(rect);
+  int segmentBegin = -1;
+  int previous = -1;
+  for (int i=0; i<points.size(); ++i)
+  {
+    const int index = mPointGridOffset+points.at(i);
+    if (segmentBegin == -1)
+      segmentBegin = index;
+    else if (index != previous+1) // a data point between is outside rect, segment just ended
+    {
+      result.addDataRange(QCPDataRange(segmentBegin, previous+1), false);
+      segmentBegin = index;
+    }
+    previous = index;
+  }
+  if (segmentBegin != -1)
+    result.addDataRange(QCPDataRange(segmentBegin, previous+1), false);
+  
+  result.simplify();
+  return result;
+}
+
 /*!
   Implements a selectTest specific to this plottable's point geometry.
 
@@ -22427,6 +22962,19 @@ double QCPGraph::pointDistance(const QPointF &pixelPoint, QCPGraphDataContainer:
   if (mLineStyle == lsNone && mScatterStyle.isNone())
     return -1.0;
   
+  // with a spatial index, only look at the points and line segments near pixelPoint:
+  if (updateSpatialIndex() && mPointGrid.bounds().contains(pixelPoint.toPoint()))
+  {
+    double minDist;
+    const int index = mPointGrid.nearest(pixelPoint, minDist);
+    if (index >= 0)
+      closestData = mDataContainer->constBegin()+mPointGridOffset+index;
+    double lineDist;
+    if (mLineStyle != lsNone && mLineGrid.nearest(pixelPoint, lineDist) >= 0 && lineDist < minDist)
+      minDist = lineDist;
+    return minDist;
+  }
+  
   // calculate minimum distances to graph data points and find closestData iterator:
   double minDistSqr = (std::numeric_limits<double>::max)();
   // determine which key range comes into question, taking selection tolerance around pos into account:
@@ -22467,6 +23015,57 @@ double QCPGraph::pointDistance(const QPointF &pixelPoint, QCPGraphDataContainer:
   return qSqrt(minDistSqr);
 }
 
+/*! \internal
+  
+  Brings the spatial index (\ref setSpatialIndex) up to date with the current axis ranges, axis rect
+  and data, rebuilding it if any of them changed since it was built. The index holds the pixel
+  positions of the data points in the visible key range and the line segments as returned by \ref
+  getLines, i.e. as drawn.
+  
+  Returns false if the spatial index is disabled or the graph has no valid axes.
+*/
+bool QCPGraph::updateSpatialIndex() const
+{
+  QCPAxis *keyAxis = mKeyAxis.data();
+  QCPAxis *valueAxis = mValueAxis.data();
+  if (!mSpatialIndex || !keyAxis || !valueAxis || !keyAxis->axisRect())
+    return false;
+  
+  const QCPRange keyRange = keyAxis->range();
+  const QCPRange valueRange = valueAxis->range();
+  const QPointF origin = coordsToPixels(keyRange.lower, valueRange.lower);
+  const QPointF center = coordsToPixels(keyRange.center(), valueRange.center());
+  if (mSpatialIndexValid && mSpatialIndexRevision == mDataContainer->revision() &&
+      mSpatialIndexKeyRange == keyRange && mSpatialIndexValueRange == valueRange &&
+      mSpatialIndexOrigin == origin && mSpatialIndexCenter == center)
+    return true;
+  
+  const QRect bounds = keyAxis->axisRect()->rect();
+  QCPGraphDataContainer::const_iterator begin, end;
+  getVisibleDataBounds(begin, end, QCPDataRange(0, dataCount()));
+  QVector<QPointF> points(int(end-begin));
+  QPointF *point = points.data();
+  for (QCPGraphDataContainer::const_iterator it=begin; it!=end; ++it)
+    *point++ = coordsToPixels(it->key, it->value);
+  mPointGrid.setPoints(points, bounds);
+  mPointGridOffset = int(begin-mDataContainer->constBegin());
+  if (mLineStyle != lsNone)
+  {
+    QVector<QPointF> lines;
+    getLines(&lines, QCPDataRange(0, dataCount()));
+    mLineGrid.setSegments(lines, mLineStyle == lsImpulse ? 2 : 1, bounds); // impulse lines are only pairwise connected
+  } else
+    mLineGrid.clear();
+  
+  mSpatialIndexValid = true;
+  mSpatialIndexRevision = mDataContainer->revision();
+  mSpatialIndexKeyRange = keyRange;
+  mSpatialIndexValueRange = valueRange;
+  mSpatialIndexOrigin = origin;
+  mSpatialIndexCenter = center;
+  return true;
+}
+
 /*! \internal
   
   Finds the highest index of \a data, whose points y value is just below \a y. Assumes y values in
@@ -24446,7 +25045,8 @@ QCPBars::QCPBars(QCPAxis *keyAxis, QCPAxis *valueAxis) :
   mWidthType(wtPlotCoords),
   mBarsGroup(nullptr),
   mBaseValue(0),
-  mStackingGap(1)
+  mStackingGap(1),
+  mStackedBaseValid(false)
 {
   // modify inherited properties from abstract plottable:
   mPen.setColor(Qt::blue);
@@ -24481,6 +25081,7 @@ QCPBars::~QCPBars()
 void QCPBars::setData(QSharedPointer<QCPBarsDataContainer> data)
 {
   mDataContainer = data;
+  invalidateStackedBase();
 }
 
 /*! \overload
@@ -24556,6 +25157,7 @@ void QCPBars::setBarsGroup(QCPBarsGroup *barsGroup)
 void QCPBars::setBaseValue(double baseValue)
 {
   mBaseValue = baseValue;
+  invalidateStackedBase();
 }
 
 /*!
@@ -24687,12 +25289,13 @@ QCPDataSelection QCPBars::selectTestRect(const QRectF &rect, bool onlySelectable
   if (!mKeyAxis || !mValueAxis)
     return result;
   
+  updateStackedBase();
   QCPBarsDataContainer::const_iterator visibleBegin, visibleEnd;
   getVisibleDataBounds(visibleBegin, visibleEnd);
   
   for (QCPBarsDataContainer::const_iterator it=visibleBegin; it!=visibleEnd; ++it)
   {
-    if (rect.intersects(getBarRect(it->key, it->value)))
+    if (rect.intersects(getBarRect(it->key, it->value, stackedBaseValue(it))))
       result.addDataRange(QCPDataRange(int(it-mDataContainer->constBegin()), int(it-mDataContainer->constBegin()+1)), false);
   }
   result.simplify();
@@ -24718,11 +25321,12 @@ double QCPBars::selectTest(const QPointF &pos, bool onlySelectable, QVariant *de
   if (mKeyAxis.data()->axisRect()->rect().contains(pos.toPoint()) || mParentPlot->interactions().testFlag(QCP::iSelectPlottablesBeyondAxisRect))
   {
     // get visible data range:
+    updateStackedBase();
     QCPBarsDataContainer::const_iterator visibleBegin, visibleEnd;
     getVisibleDataBounds(visibleBegin, visibleEnd);
     for (QCPBarsDataContainer::const_iterator it=visibleBegin; it!=visibleEnd; ++it)
     {
-      if (getBarRect(it->key, it->value).contains(pos))
+      if (getBarRect(it->key, it->value, stackedBaseValue(it)).contains(pos))
       {
         if (details)
         {
@@ -24792,9 +25396,10 @@ QCPRange QCPBars::getValueRange(bool &foundRange, QCP::SignDomain inSignDomain,
     itBegin = mDataContainer->findBegin(inKeyRange.lower, false);
     itEnd = mDataContainer->findEnd(inKeyRange.upper, false);
   }
+  updateStackedBase();
   for (QCPBarsDataContainer::const_iterator it = itBegin; it != itEnd; ++it)
   {
-    const double current = it->value + getStackedBaseValue(it->key, it->value >= 0);
+    const double current = it->value + stackedBaseValue(it);
     if (qIsNaN(current)) continue;
     if (inSignDomain == QCP::sdBoth || (inSignDomain == QCP::sdNegative && current < 0) || (inSignDomain == QCP::sdPositive && current > 0))
     {
@@ -24825,7 +25430,8 @@ QPointF QCPBars::dataPixelPosition(int index) const
     if (!keyAxis || !valueAxis) { qDebug() << Q_FUNC_INFO << "invalid key or value axis"; return {}; }
     
     const QCPDataContainer<QCPBarsData>::const_iterator it = mDataContainer->constBegin()+index;
-    const double valuePixel = valueAxis->coordToPixel(getStackedBaseValue(it->key, it->value >= 0) + it->value);
+    updateStackedBase();
+    const double valuePixel = valueAxis->coordToPixel(stackedBaseValue(it) + it->value);
     const double keyPixel = keyAxis->coordToPixel(it->key) + (mBarsGroup ? mBarsGroup->keyPixelOffset(this, it->key) : 0);
     if (keyAxis->orientation() == Qt::Horizontal)
       return {keyPixel, valuePixel};
@@ -24844,6 +25450,7 @@ void QCPBars::draw(QCPPainter *painter)
   if (!mKeyAxis || !mValueAxis) { qDebug() << Q_FUNC_INFO << "invalid key or value axis"; return; }
   if (mDataContainer->isEmpty()) return;
   
+  updateStackedBase();
   QCPBarsDataContainer::const_iterator visibleBegin, visibleEnd;
   getVisibleDataBounds(visibleBegin, visibleEnd);
   
@@ -24878,7 +25485,7 @@ void QCPBars::draw(QCPPainter *painter)
         painter->setPen(mPen);
       }
       applyDefaultAntialiasingHint(painter);
-      painter->drawPolygon(getBarRect(it->key, it->value));
+      painter->drawPolygon(getBarRect(it->key, it->value, stackedBaseValue(it)));
     }
   }
   
@@ -24912,6 +25519,8 @@ void QCPBars::drawLegendIcon(QCPPainter *painter, const QRectF &rect) const
   may also lie just outside of the visible range.
   
   if the plottable contains no data, both \a begin and \a end point to constEnd.
+  
+  The stacked base values must be up to date, see \ref updateStackedBase.
 */
 void QCPBars::getVisibleDataBounds(QCPBarsDataContainer::const_iterator &begin, QCPBarsDataContainer::const_iterator &end) const
 {
@@ -24940,7 +25549,7 @@ void QCPBars::getVisibleDataBounds(QCPBarsDataContainer::const_iterator &begin,
   while (it != mDataContainer->constBegin())
   {
     --it;
-    const QRectF barRect = getBarRect(it->key, it->value);
+    const QRectF barRect = getBarRect(it->key, it->value, stackedBaseValue(it));
     if (mKeyAxis.data()->orientation() == Qt::Horizontal)
       isVisible = ((!mKeyAxis.data()->rangeReversed() && barRect.right() >= lowerPixelBound) || (mKeyAxis.data()->rangeReversed() && barRect.left() <= lowerPixelBound));
     else // keyaxis is vertical
@@ -24954,7 +25563,7 @@ void QCPBars::getVisibleDataBounds(QCPBarsDataContainer::const_iterator &begin,
   it = end;
   while (it != mDataContainer->constEnd())
   {
-    const QRectF barRect = getBarRect(it->key, it->value);
+    const QRectF barRect = getBarRect(it->key, it->value, stackedBaseValue(it));
     if (mKeyAxis.data()->orientation() == Qt::Horizontal)
       isVisible = ((!mKeyAxis.data()->rangeReversed() && barRect.left() <= upperPixelBound) || (mKeyAxis.data()->rangeReversed() && barRect.right() >= upperPixelBound));
     else // keyaxis is vertical
@@ -24974,6 +25583,16 @@ void QCPBars::getVisibleDataBounds(QCPBarsDataContainer::const_iterator &begin,
   setBaseValue), and to have non-overlapping border lines with the bars stacked below.
 */
 QRectF QCPBars::getBarRect(double key, double value) const
+{
+  return getBarRect(key, value, getStackedBaseValue(key, value >= 0));
+}
+
+/*! \internal \overload
+  
+  Returns the rect of a bar whose stacked base value is already known as \a base, e.g. from \ref
+  stackedBaseValue.
+*/
+QRectF QCPBars::getBarRect(double key, double value, double base) const
 {
   QCPAxis *keyAxis = mKeyAxis.data();
   QCPAxis *valueAxis = mValueAxis.data();
@@ -24981,7 +25600,6 @@ QRectF QCPBars::getBarRect(double key, double value) const
   
   double lowerPixelWidth, upperPixelWidth;
   getPixelWidth(key, lowerPixelWidth, upperPixelWidth);
-  double base = getStackedBaseValue(key, value >= 0);
   double basePixel = valueAxis->coordToPixel(base);
   double valuePixel = valueAxis->coordToPixel(base+value);
   double keyPixel = keyAxis->coordToPixel(key);
@@ -25088,18 +25706,156 @@ double QCPBars::getStackedBaseValue(double key, bool positive) const
 }
 
 /*! \internal
-
-  Connects \a below and \a above to each other via their mBarAbove/mBarBelow properties. The bar(s)
-  currently above lower and below upper will become disconnected to lower/upper.
   
-  If lower is zero, upper will be disconnected at the bottom.
-  If upper is zero, lower will be disconnected at the top.
+  Returns the value at which the bar of the data point \a it starts, like \ref getStackedBaseValue
+  does for its key, but in constant time by looking it up in the table built by \ref
+  updateStackedBase. That method must have been called since the last change to the data or
+  stacking.
 */
-void QCPBars::connectBars(QCPBars *lower, QCPBars *upper)
+double QCPBars::stackedBaseValue(QCPBarsDataContainer::const_iterator it) const
 {
-  if (!lower && !upper) return;
-  
-  if (!lower) // disconnect upper at bottom
+  if (!mBarBelow)
+    return mBaseValue;
+  const int index = int(it-mDataContainer->constBegin());
+  if (index < 0 || index >= mStackedBasePositive.size())
+    return getStackedBaseValue(it->key, it->value >= 0);
+  return it->value >= 0 ? mStackedBasePositive.at(index) : mStackedBaseNegative.at(index);
+}
+
+/*! \internal
+  
+  Makes sure the stacked base values of this bars plottable (see \ref stackedBaseValue) are up to
+  date. \ref getStackedBaseValue walks down the whole stack with a key search in every level, for
+  every single bar. Instead, when the table of this bars is outdated, the tables of all bars in its
+  stack are rebuilt at once: the keys of the stack are collected and sorted, and each level is
+  swept through them once, accumulating the heights of the levels below. This is linear in the
+  number of stacked data points per level.
+  
+  A table is outdated when the data of this bars or one below it has changed since it was built,
+  which is told by \ref QCPDataContainer::revision, or when the stacking or base value changed (\ref
+  invalidateStackedBase).
+*/
+void QCPBars::updateStackedBase() const
+{
+  if (!mBarBelow)
+    return;
+  
+  // check whether the table is still current:
+  if (mStackedBaseValid)
+  {
+    int level = 0;
+    const QCPBars *bars = this;
+    while (bars && level < mStackedBaseRevisions.size() && mStackedBaseRevisions.at(level) == bars->mDataContainer->revision())
+    {
+      bars = bars->mBarBelow.data();
+      ++level;
+    }
+    if (!bars && level == mStackedBaseRevisions.size())
+      return;
+  }
+  
+  // collect the stack from bottom to top:
+  QVector<const QCPBars*> stack;
+  const QCPBars *top = this;
+  while (top->mBarAbove)
+    top = top->mBarAbove.data();
+  for (const QCPBars *bars = top; bars; bars = bars->mBarBelow.data())
+    stack.prepend(bars);
+  
+  // all keys at which a stacked bar may be drawn:
+  QVector<double> keys;
+  for (int level=1; level<stack.size(); ++level)
+  {
+    const QCPBarsDataContainer *data = stack.at(level)->mDataContainer.data();
+    for (QCPBarsDataContainer::const_iterator it=data->constBegin(); it!=data->constEnd(); ++it)
+    {
+      if (!qIsNaN(it->key))
+        keys.append(it->key);
+    }
+  }
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  
+  QVector<double> positive(keys.size(), stack.first()->mBaseValue);
+  QVector<double> negative(keys.size(), stack.first()->mBaseValue);
+  for (int level=1; level<stack.size(); ++level)
+  {
+    // add the largest positive and smallest negative bar of the level below near each key, with the
+    // same key tolerance as getStackedBaseValue:
+    const QCPBarsDataContainer *below = stack.at(level-1)->mDataContainer.data();
+    QCPBarsDataContainer::const_iterator first = below->constBegin();
+    for (int i=0; i<keys.size(); ++i)
+    {
+      const double key = keys.at(i);
+      const double epsilon = key == 0 ? 1e-14 : qAbs(key)*1e-14;
+      while (first != below->constEnd() && first->key <= key-epsilon)
+        ++first;
+      while (first != below->constBegin() && (first-1)->key > key-epsilon) // the tolerance window isn't monotonic around zero
+        --first;
+      double max = 0, min = 0;
+      for (QCPBarsDataContainer::const_iterator it=first; it!=below->constEnd() && it->key < key+epsilon; ++it)
+      {
+        if (it->value > max)
+          max = it->value;
+        if (it->value < min)
+          min = it->value;
+      }
+      positive[i] += max;
+      negative[i] += min;
+    }
+    
+    // look up the base of each data point of this level:
+    const QCPBars *bars = stack.at(level);
+    bars->mStackedBasePositive.resize(bars->mDataContainer->size());
+    bars->mStackedBaseNegative.resize(bars->mDataContainer->size());
+    int keyIndex = 0;
+    int index = 0;
+    for (QCPBarsDataContainer::const_iterator it=bars->mDataContainer->constBegin(); it!=bars->mDataContainer->constEnd(); ++it, ++index)
+    {
+      while (keyIndex < keys.size() && keys.at(keyIndex) < it->key)
+        ++keyIndex;
+      if (keyIndex < keys.size() && keys.at(keyIndex) == it->key)
+      {
+        bars->mStackedBasePositive[index] = positive.at(keyIndex);
+        bars->mStackedBaseNegative[index] = negative.at(keyIndex);
+      } else // NaN key
+      {
+        bars->mStackedBasePositive[index] = bars->getStackedBaseValue(it->key, true);
+        bars->mStackedBaseNegative[index] = bars->getStackedBaseValue(it->key, false);
+      }
+    }
+    bars->mStackedBaseRevisions.clear();
+    for (int i=level; i>=0; --i)
+      bars->mStackedBaseRevisions.append(stack.at(i)->mDataContainer->revision());
+    bars->mStackedBaseValid = true;
+  }
+}
+
+/*! \internal
+  
+  Marks the stacked base values of this bars plottable and all bars stacked above it as outdated,
+  for changes that \ref updateStackedBase can't tell from the data revisions.
+*/
+void QCPBars::invalidateStackedBase()
+{
+  for (QCPBars *bars = this; bars; bars = bars->mBarAbove.data())
+    bars->mStackedBaseValid = false;
+}
+
+/*! \internal
+
+  Connects \a below and \a above to each other via their mBarAbove/mBarBelow properties. The bar(s)
+  currently above lower and below upper will become disconnected to lower/upper.
+  
+  If lower is zero, upper will be disconnected at the bottom.
+  If upper is zero, lower will be disconnected at the top.
+*/
+void QCPBars::connectBars(QCPBars *lower, QCPBars *upper)
+{
+  if (!lower && !upper) return;
+  QCPBars *oldAbove = lower ? lower->mBarAbove.data() : nullptr;
+  
+  if (!lower) // disconnect upper at bottom
   {
     // disconnect old bar below upper:
     if (upper->mBarBelow && upper->mBarBelow.data()->mBarAbove.data() == upper)
@@ -25122,6 +25878,11 @@ void QCPBars::connectBars(QCPBars *lower, QCPBars *upper)
     lower->mBarAbove = upper;
     upper->mBarBelow = lower;
   }
+  // bars that now stand on something else:
+  if (upper)
+    upper->invalidateStackedBase();
+  if (oldAbove)
+    oldAbove->invalidateStackedBase();
 }
 /* end of 'src/plottables/plottable-bars.cpp' */
 
@@ -25826,6 +26587,12 @@ QVector<QLineF> QCPStatisticalBox::getWhiskerBarLines(QCPStatisticalBoxDataConta
   true current minimum and maximum. The method QCPColorMap::rescaleDataRange offers a convenience
   parameter \a recalculateDataBounds which may be set to true to automatically call \ref
   recalculateDataBounds internally.
+  
+  To keep \ref recalculateDataBounds cheap, the minimum and maximum are additionally tracked per
+  key index (column). Only columns in which a bounding cell was overwritten are rescanned, so
+  finding the true bounds costs O(keySize) plus O(valueSize) per modified column instead of a pass
+  over all cells. For streaming data, e.g. one new column per measurement, \ref appendColumn and
+  \ref scrollKeys move the existing cells in place instead of reallocating the data array.
 */
 
 /* start of documentation of inline functions */
@@ -25902,6 +26669,9 @@ QCPColorMapData &QCPColorMapData::operator=(const QCPColorMapData &other)
         memcpy(mAlpha, other.mAlpha, sizeof(mAlpha[0])*size_t(keySize*valueSize));
     }
     mDataBounds = other.mDataBounds;
+    mColumnMinimum = other.mColumnMinimum;
+    mColumnMaximum = other.mColumnMaximum;
+    mColumnBoundsDirty = other.mColumnBoundsDirty;
     mDataModified = true;
   }
   return *this;
@@ -25972,12 +26742,21 @@ void QCPColorMapData::setSize(int keySize, int valueSize)
 #ifdef __EXCEPTIONS
       } catch (...) { mData = nullptr; }
 #endif
+      mColumnMinimum.resize(mKeySize);
+      mColumnMaximum.resize(mKeySize);
+      mColumnBoundsDirty.resize(mKeySize);
       if (mData)
         fill(0);
       else
         qDebug() << Q_FUNC_INFO << "out of memory for data dimensions "<< mKeySize << "*" << mValueSize;
     } else
       mData = nullptr;
+    if (!mData)
+    {
+      mColumnMinimum.clear();
+      mColumnMaximum.clear();
+      mColumnBoundsDirty.clear();
+    }
     
     if (mAlpha) // if we had an alpha map, recreate it with new size
       createAlpha();
@@ -26080,6 +26859,7 @@ void QCPColorMapData::setData(double key, double value, double z)
   int valueCell = int( (value-mValueRange.lower)/(mValueRange.upper-mValueRange.lower)*(mValueSize-1)+0.5 );
   if (keyCell >= 0 && keyCell < mKeySize && valueCell >= 0 && valueCell < mValueSize)
   {
+    updateColumnBounds(keyCell, mData[valueCell*mKeySize + keyCell], z);
     mData[valueCell*mKeySize + keyCell] = z;
     if (z < mDataBounds.lower)
       mDataBounds.lower = z;
@@ -26104,6 +26884,7 @@ void QCPColorMapData::setCell(int keyIndex, int valueIndex, double z)
 {
   if (keyIndex >= 0 && keyIndex < mKeySize && valueIndex >= 0 && valueIndex < mValueSize)
   {
+    updateColumnBounds(keyIndex, mData[valueIndex*mKeySize + keyIndex], z);
     mData[valueIndex*mKeySize + keyIndex] = z;
     if (z < mDataBounds.lower)
       mDataBounds.lower = z;
@@ -26114,6 +26895,42 @@ void QCPColorMapData::setCell(int keyIndex, int valueIndex, double z)
     qDebug() << Q_FUNC_INFO << "index out of bounds:" << keyIndex << valueIndex;
 }
 
+/*!
+  Sets all cells with the key index \a keyIndex to the values in \a values, which must hold \ref
+  valueSize elements, ordered by value index. This is faster than calling \ref setCell for each
+  cell, since the column's data bounds are determined in one pass.
+  
+  \see appendColumn, setCell
+*/
+void QCPColorMapData::setColumn(int keyIndex, const double *values)
+{
+  if (keyIndex < 0 || keyIndex >= mKeySize || !values)
+  {
+    qDebug() << Q_FUNC_INFO << "index out of bounds or null values:" << keyIndex;
+    return;
+  }
+  double minimum = (std::numeric_limits<double>::max)();
+  double maximum = -(std::numeric_limits<double>::max)();
+  double *cell = mData + keyIndex;
+  for (int valueIndex=0; valueIndex<mValueSize; ++valueIndex, cell += mKeySize)
+  {
+    const double z = values[valueIndex];
+    *cell = z;
+    if (z < minimum)
+      minimum = z;
+    if (z > maximum)
+      maximum = z;
+  }
+  mColumnMinimum[keyIndex] = minimum;
+  mColumnMaximum[keyIndex] = maximum;
+  mColumnBoundsDirty[keyIndex] = false;
+  if (minimum < mDataBounds.lower)
+    mDataBounds.lower = minimum;
+  if (maximum > mDataBounds.upper)
+    mDataBounds.upper = maximum;
+  mDataModified = true;
+}
+
 /*!
   Sets the alpha of the color map cell given by \a keyIndex and \a valueIndex to \a alpha. A value
   of 0 for \a alpha results in a fully transparent cell, and a value of 255 results in a fully
@@ -26143,7 +26960,82 @@ void QCPColorMapData::setAlpha(int keyIndex, int valueIndex, unsigned char alpha
 }
 
 /*!
-  Goes through the data and updates the buffered minimum and maximum data values.
+  Moves all cells \a cells key indices towards lower key indices, in place. The cells with the
+  lowest key indices are dropped and the \a cells columns that become free at the high end are set
+  to 0 (and full opacity, if an alpha map exists). A negative \a cells scrolls the other way.
+  
+  If \a shiftKeyRange is true, the key range is moved by the same number of cells, so every
+  remaining cell keeps its plot coordinate. This allows a map of fixed size to follow a stream of
+  columns, such as one per CGM reading, without reallocating its data.
+  
+  \see appendColumn
+*/
+void QCPColorMapData::scrollKeys(int cells, bool shiftKeyRange)
+{
+  if (isEmpty() || cells == 0)
+    return;
+  const int shift = qBound(-mKeySize, cells, mKeySize);
+  const int kept = mKeySize-qAbs(shift);
+  const int keptFrom = shift > 0 ? shift : 0; // first kept key index before the move
+  const int keptTo = shift > 0 ? 0 : -shift;  // and after the move
+  const int freedFrom = shift > 0 ? kept : 0;
+  for (int valueIndex=0; valueIndex<mValueSize; ++valueIndex)
+  {
+    double *row = mData + qint64(valueIndex)*mKeySize;
+    memmove(row+keptTo, row+keptFrom, sizeof(*row)*size_t(kept));
+    std::fill(row+freedFrom, row+freedFrom+qAbs(shift), 0.0);
+    if (mAlpha)
+    {
+      unsigned char *alphaRow = mAlpha + qint64(valueIndex)*mKeySize;
+      memmove(alphaRow+keptTo, alphaRow+keptFrom, size_t(kept));
+      memset(alphaRow+freedFrom, 255, size_t(qAbs(shift)));
+    }
+  }
+  memmove(mColumnMinimum.data()+keptTo, mColumnMinimum.constData()+keptFrom, sizeof(double)*size_t(kept));
+  memmove(mColumnMaximum.data()+keptTo, mColumnMaximum.constData()+keptFrom, sizeof(double)*size_t(kept));
+  if (shift > 0)
+    std::copy(mColumnBoundsDirty.constBegin()+keptFrom, mColumnBoundsDirty.constBegin()+keptFrom+kept, mColumnBoundsDirty.begin()+keptTo);
+  else
+    std::copy_backward(mColumnBoundsDirty.constBegin()+keptFrom, mColumnBoundsDirty.constBegin()+keptFrom+kept, mColumnBoundsDirty.begin()+keptTo+kept);
+  for (int keyIndex=freedFrom; keyIndex<freedFrom+qAbs(shift); ++keyIndex)
+  {
+    mColumnMinimum[keyIndex] = 0;
+    mColumnMaximum[keyIndex] = 0;
+    mColumnBoundsDirty[keyIndex] = false;
+  }
+  if (0 < mDataBounds.lower)
+    mDataBounds.lower = 0;
+  if (0 > mDataBounds.upper)
+    mDataBounds.upper = 0;
+  
+  if (shiftKeyRange && mKeySize > 1)
+  {
+    const double cellWidth = (mKeyRange.upper-mKeyRange.lower)/double(mKeySize-1);
+    mKeyRange += shift*cellWidth;
+  }
+  mDataModified = true;
+}
+
+/*!
+  Scrolls the map by one key index (see \ref scrollKeys) and sets the freed column at the highest
+  key index to \a values, which must hold \ref valueSize elements.
+  
+  \see setColumn
+*/
+void QCPColorMapData::appendColumn(const double *values, bool shiftKeyRange)
+{
+  if (isEmpty())
+    return;
+  scrollKeys(1, shiftKeyRange);
+  setColumn(mKeySize-1, values);
+}
+
+/*!
+  Updates the buffered minimum and maximum data values to the true bounds of the data.
+  
+  Only columns in which a cell holding that column's minimum or maximum was overwritten are scanned
+  again; all other columns contribute their tracked bounds. The cost is therefore O(keySize), plus
+  O(valueSize) for every such column.
   
   Calling this method is only advised if you are about to call \ref QCPColorMap::rescaleDataRange
   and can not guarantee that the cells holding the maximum or minimum data haven't been overwritten
@@ -26157,17 +27049,18 @@ void QCPColorMapData::setAlpha(int keyIndex, int valueIndex, unsigned char alpha
 */
 void QCPColorMapData::recalculateDataBounds()
 {
-  if (mKeySize > 0 && mValueSize > 0)
+  if (mKeySize > 0 && mValueSize > 0 && mData)
   {
     double minHeight = std::numeric_limits<double>::max();
     double maxHeight = -std::numeric_limits<double>::max();
-    const int dataCount = mValueSize*mKeySize;
-    for (int i=0; i<dataCount; ++i)
+    for (int keyIndex=0; keyIndex<mKeySize; ++keyIndex)
     {
-      if (mData[i] > maxHeight)
-        maxHeight = mData[i];
-      if (mData[i] < minHeight)
-        minHeight = mData[i];
+      if (mColumnBoundsDirty.at(keyIndex))
+        recalculateColumnBounds(keyIndex);
+      if (mColumnMaximum.at(keyIndex) > maxHeight)
+        maxHeight = mColumnMaximum.at(keyIndex);
+      if (mColumnMinimum.at(keyIndex) < minHeight)
+        minHeight = mColumnMinimum.at(keyIndex);
     }
     mDataBounds.lower = minHeight;
     mDataBounds.upper = maxHeight;
@@ -26203,7 +27096,11 @@ void QCPColorMapData::clearAlpha()
 void QCPColorMapData::fill(double z)
 {
   const int dataCount = mValueSize*mKeySize;
-  memset(mData, z, dataCount*sizeof(*mData));
+  if (mData)
+    std::fill(mData, mData+dataCount, z);
+  mColumnMinimum.fill(z);
+  mColumnMaximum.fill(z);
+  mColumnBoundsDirty.fill(false);
   mDataBounds = QCPRange(z, z);
   mDataModified = true;
 }
@@ -26313,6 +27210,46 @@ bool QCPColorMapData::createAlpha(bool initializeOpaque)
   }
 }
 
+/*! \internal
+
+  Keeps the bounds of column \a keyIndex up to date when one of its cells changes from \a oldZ to
+  \a z. Growing is applied directly. If the cell held the column's minimum or maximum and moves
+  inwards, the column may have become narrower, which is only known after a rescan; the column is
+  then marked for \ref recalculateColumnBounds.
+*/
+void QCPColorMapData::updateColumnBounds(int keyIndex, double oldZ, double z)
+{
+  double &minimum = mColumnMinimum[keyIndex];
+  double &maximum = mColumnMaximum[keyIndex];
+  if ((oldZ <= minimum && !(z <= minimum)) || (oldZ >= maximum && !(z >= maximum)))
+    mColumnBoundsDirty[keyIndex] = true;
+  if (z < minimum)
+    minimum = z;
+  if (z > maximum)
+    maximum = z;
+}
+
+/*! \internal
+
+  Scans the cells of column \a keyIndex for their minimum and maximum.
+*/
+void QCPColorMapData::recalculateColumnBounds(int keyIndex)
+{
+  double minimum = (std::numeric_limits<double>::max)();
+  double maximum = -(std::numeric_limits<double>::max)();
+  const double *cell = mData + keyIndex;
+  for (int valueIndex=0; valueIndex<mValueSize; ++valueIndex, cell += mKeySize)
+  {
+    if (*cell < minimum)
+      minimum = *cell;
+    if (*cell > maximum)
+      maximum = *cell;
+  }
+  mColumnMinimum[keyIndex] = minimum;
+  mColumnMaximum[keyIndex] = maximum;
+  mColumnBoundsDirty[keyIndex] = false;
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////// QCPColorMap
@@ -26737,6 +27674,89 @@ QCPRange QCPColorMap::getValueRange(bool &foundRange, QCP::SignDomain inSignDoma
   return result;
 }
 
+/*! \internal
+
+  Shared state of one \ref qcpForEachScanlineBand call. The calling thread and every pool task
+  pull band numbers from \a nextBand until all bands are taken.
+*/
+struct QCPScanlineBands
+{
+  std::function<void(int, int)> job;
+  QAtomicInt nextBand;
+  int bandCount;
+  int bandLines;
+  int lineCount;
+  QSemaphore finished;
+  
+  void work()
+  {
+    for (int band = nextBand.fetchAndAddRelaxed(1); band < bandCount; band = nextBand.fetchAndAddRelaxed(1))
+      job(band*bandLines, qMin(lineCount, (band+1)*bandLines));
+  }
+};
+
+/*! \internal
+
+  Pool task helping with the bands of a \ref QCPScanlineBands.
+*/
+class QCPScanlineBandTask : public QRunnable
+{
+public:
+  explicit QCPScanlineBandTask(QCPScanlineBands *bands) : mBands(bands) {}
+  void run() Q_DECL_OVERRIDE
+  {
+    mBands->work();
+    mBands->finished.release(); // last access, the caller may destroy mBands right after
+  }
+  
+private:
+  QCPScanlineBands *mBands;
+};
+
+/*! \internal
+
+  Calls \a job(firstLine, endLine) for consecutive bands covering the \a lineCount scanlines of an
+  image, on the calling thread and on idle threads of QThreadPool::globalInstance(), and returns when
+  all bands are done. The scanlines of a band must be independent of those of other bands.
+
+  Images below about 64k pixels (\a lineCount times \a lineLength) are processed on the calling
+  thread only, where the dispatch would cost more than it saves. Helpers are started with
+  QThreadPool::tryStart, so a busy pool just means fewer helpers and can never block the caller.
+*/
+static void qcpForEachScanlineBand(int lineCount, int lineLength, const std::function<void(int, int)> &job)
+{
+  const qint64 minimumPixelsPerBand = 16384;
+  QThreadPool *pool = QThreadPool::globalInstance();
+  const int maxBands = int(qMin(qint64(lineCount), qint64(lineCount)*lineLength/minimumPixelsPerBand));
+  const int threadCount = qMin(pool->maxThreadCount(), maxBands);
+  if (threadCount < 2)
+  {
+    job(0, lineCount);
+    return;
+  }
+  
+  QCPScanlineBands bands;
+  bands.job = job;
+  bands.bandCount = qMin(maxBands, 4*threadCount); // a few bands per thread evens out uneven progress
+  bands.bandLines = (lineCount+bands.bandCount-1)/bands.bandCount;
+  bands.bandCount = (lineCount+bands.bandLines-1)/bands.bandLines;
+  bands.lineCount = lineCount;
+  
+  int helpers = 0;
+  for (int i=1; i<threadCount; ++i)
+  {
+    QCPScanlineBandTask *task = new QCPScanlineBandTask(&bands);
+    if (!pool->tryStart(task))
+    {
+      delete task;
+      break;
+    }
+    ++helpers;
+  }
+  bands.work();
+  bands.finished.acquire(helpers);
+}
+
 /*! \internal
   
   Updates the internal map image buffer by going through the internal \ref QCPColorMapData and
@@ -26750,6 +27770,9 @@ QCPRange QCPColorMap::getValueRange(bool &foundRange, QCP::SignDomain inSignDoma
   QPainter::drawImage bug which makes inner pixel boundaries jitter when stretch-drawing images
   without smooth transform enabled. Accordingly, oversampling isn't performed if \ref
   setInterpolate is true.
+  
+  Scanlines are independent, so colorization and oversampling are split into bands of scanlines
+  that run in parallel on QThreadPool::globalInstance() (see \ref qcpForEachScanlineBand).
 */
 void QCPColorMap::updateMapImage()
 {
@@ -26790,38 +27813,53 @@ void QCPColorMap::updateMapImage()
     
     const double *rawData = mMapData->mData;
     const unsigned char *rawAlpha = mMapData->mAlpha;
-    if (keyAxis->orientation() == Qt::Horizontal)
-    {
-      const int lineCount = valueSize;
-      const int rowCount = keySize;
-      for (int line=0; line<lineCount; ++line)
-      {
-        QRgb* pixels = reinterpret_cast<QRgb*>(localMapImage->scanLine(lineCount-1-line)); // invert scanline index because QImage counts scanlines from top, but our vertical index counts from bottom (mathematical coordinate system)
-        if (rawAlpha)
-          mGradient.colorize(rawData+line*rowCount, rawAlpha+line*rowCount, mDataRange, pixels, rowCount, 1, mDataScaleType==QCPAxis::stLogarithmic);
-        else
-          mGradient.colorize(rawData+line*rowCount, mDataRange, pixels, rowCount, 1, mDataScaleType==QCPAxis::stLogarithmic);
-      }
-    } else // keyAxis->orientation() == Qt::Vertical
-    {
-      const int lineCount = keySize;
-      const int rowCount = valueSize;
-      for (int line=0; line<lineCount; ++line)
+    const bool logarithmic = mDataScaleType==QCPAxis::stLogarithmic;
+    const bool horizontal = keyAxis->orientation() == Qt::Horizontal;
+    // a scanline is a row of constant value (horizontal key axis) or a column of constant key (vertical key axis):
+    const int lineCount = horizontal ? valueSize : keySize;
+    const int rowCount = horizontal ? keySize : valueSize;
+    const int dataIndexFactor = horizontal ? 1 : lineCount;
+    const int dataLineStride = horizontal ? rowCount : 1;
+    // the band threads must neither update the gradient's color buffer nor detach an image, so both happen here:
+    mGradient.color(mDataRange.lower, mDataRange);
+    uchar *imageBits = localMapImage->bits();
+    const qint64 bytesPerLine = localMapImage->bytesPerLine();
+    qcpForEachScanlineBand(lineCount, rowCount, [&](int firstLine, int endLine)
+    {
+      for (int line=firstLine; line<endLine; ++line)
       {
-        QRgb* pixels = reinterpret_cast<QRgb*>(localMapImage->scanLine(lineCount-1-line)); // invert scanline index because QImage counts scanlines from top, but our vertical index counts from bottom (mathematical coordinate system)
+        QRgb* pixels = reinterpret_cast<QRgb*>(imageBits + (lineCount-1-line)*bytesPerLine); // invert scanline index because QImage counts scanlines from top, but our vertical index counts from bottom (mathematical coordinate system)
+        const qint64 dataOffset = qint64(line)*dataLineStride;
         if (rawAlpha)
-          mGradient.colorize(rawData+line, rawAlpha+line, mDataRange, pixels, rowCount, lineCount, mDataScaleType==QCPAxis::stLogarithmic);
+          mGradient.colorize(rawData+dataOffset, rawAlpha+dataOffset, mDataRange, pixels, rowCount, dataIndexFactor, logarithmic);
         else
-          mGradient.colorize(rawData+line, mDataRange, pixels, rowCount, lineCount, mDataScaleType==QCPAxis::stLogarithmic);
+          mGradient.colorize(rawData+dataOffset, mDataRange, pixels, rowCount, dataIndexFactor, logarithmic);
       }
-    }
+    });
     
     if (keyOversamplingFactor > 1 || valueOversamplingFactor > 1)
     {
-      if (keyAxis->orientation() == Qt::Horizontal)
-        mMapImage = mUndersampledMapImage.scaled(keySize*keyOversamplingFactor, valueSize*valueOversamplingFactor, Qt::IgnoreAspectRatio, Qt::FastTransformation);
-      else
-        mMapImage = mUndersampledMapImage.scaled(valueSize*valueOversamplingFactor, keySize*keyOversamplingFactor, Qt::IgnoreAspectRatio, Qt::FastTransformation);
+      // nearest neighbour upscaling by integer factors, the same as QImage::scaled with Qt::FastTransformation, but in bands:
+      const int widthFactor = horizontal ? keyOversamplingFactor : valueOversamplingFactor;
+      const int heightFactor = horizontal ? valueOversamplingFactor : keyOversamplingFactor;
+      const int sourceWidth = mUndersampledMapImage.width();
+      const uchar *sourceBits = mUndersampledMapImage.constBits();
+      const qint64 sourceBytesPerLine = mUndersampledMapImage.bytesPerLine();
+      uchar *targetBits = mMapImage.bits();
+      const qint64 targetBytesPerLine = mMapImage.bytesPerLine();
+      qcpForEachScanlineBand(mMapImage.height(), mMapImage.width(), [&](int firstLine, int endLine)
+      {
+        for (int y=firstLine; y<endLine; ++y)
+        {
+          const QRgb *sourcePixels = reinterpret_cast<const QRgb*>(sourceBits + (y/heightFactor)*sourceBytesPerLine);
+          QRgb *pixels = reinterpret_cast<QRgb*>(targetBits + y*targetBytesPerLine);
+          for (int x=0; x<sourceWidth; ++x)
+          {
+            for (int k=0; k<widthFactor; ++k)
+              *pixels++ = sourcePixels[x];
+          }
+        }
+      });
     }
   }
   mMapData->mDataModified = false;
@@ -28849,6 +29887,1708 @@ bool QCPErrorBars::rectIntersectsLine(const QRectF &pixelRect, const QLineF &lin
 /* end of 'src/plottables/plottable-errorbar.cpp' */
 
 
+/* including file 'src/plottables/plottable-multigraph.cpp' */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////// QCPMultiGraph
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! \class QCPMultiGraph
+  \brief A plottable drawing many line series that share their storage and pens
+
+  Plotting a population of trajectories as individual \ref QCPGraph "QCPGraphs" gives every series
+  its own QObject, data container, pen, selection state and layerable, which becomes expensive in
+  memory and in \ref QCustomPlot::layerableListAt / \ref selectTest once there are thousands of
+  them. QCPMultiGraph instead stores all series back to back in two contiguous arrays (keys and
+  values) with an offset table, and is a single layerable.
+  
+  Series are added with \ref addSeries and addressed by their index. Each series belongs to a
+  group (\ref setSeriesGroup), and all series of a group are drawn with the group's pen (\ref
+  setGroupPen), so the painter changes pen once per group rather than once per series. Within a
+  series, keys must be ascending; \ref addSeries sorts them if they aren't. NaN values break the
+  line.
+  
+  \section qcpmultigraph-selection Selection
+  
+  The data indices used in selections are series indices. With the selection type \ref
+  QCP::stSingleData, clicking a line selects that series, and \ref selection returns
+  <tt>QCPDataRange(series, series+1)</tt>; \ref QCP::stMultipleDataRanges allows selecting several
+  series. Selected series are drawn last, with the pen of the \ref selectionDecorator. The closest
+  series to a pixel position can also be queried directly with \ref seriesAt.
+  
+  Rectangle selection (\ref QCustomPlot::setSelectionRectMode) is not supported.
+*/
+
+/* start of documentation of inline functions */
+
+/*! \fn int QCPMultiGraph::seriesCount() const
+
+  Returns the number of series added with \ref addSeries.
+*/
+
+/*! \fn const double *QCPMultiGraph::seriesKeys(int series) const
+
+  Returns a pointer to the \ref seriesSize keys of \a series. The pointer is invalidated by the
+  next \ref addSeries or \ref clearData.
+*/
+
+/* end of documentation of inline functions */
+
+/*!
+  Constructs a multi graph which uses \a keyAxis as its key axis ("x") and \a valueAxis as its
+  value axis ("y"). \a keyAxis and \a valueAxis must reside in the same QCustomPlot instance and
+  not have the same orientation.
+  
+  The created QCPMultiGraph is automatically registered with the QCustomPlot instance inferred from
+  \a keyAxis. This QCustomPlot instance takes ownership of the QCPMultiGraph, so do not delete it
+  manually but use QCustomPlot::removePlottable() instead.
+*/
+QCPMultiGraph::QCPMultiGraph(QCPAxis *keyAxis, QCPAxis *valueAxis) :
+  QCPAbstractPlottable(keyAxis, valueAxis),
+  mOffsets(1, 0)
+{
+  setPen(QPen(Qt::blue, 0));
+  setBrush(Qt::NoBrush);
+}
+
+QCPMultiGraph::~QCPMultiGraph()
+{
+}
+
+/*!
+  Returns the pen used for series of \a group. Groups without an own pen (see \ref setGroupPen)
+  use the plottable's \ref setPen "pen".
+*/
+QPen QCPMultiGraph::groupPen(int group) const
+{
+  if (group >= 0 && group < mGroupPens.size())
+    return mGroupPens.at(group);
+  return mPen;
+}
+
+/*!
+  Sets the pen of all series in \a group. Groups between the previously highest group with a pen
+  and \a group start out with the plottable's current \ref setPen "pen".
+  
+  \see setSeriesGroup
+*/
+void QCPMultiGraph::setGroupPen(int group, const QPen &pen)
+{
+  if (group < 0)
+    return;
+  while (mGroupPens.size() <= group)
+    mGroupPens.append(mPen);
+  mGroupPens[group] = pen;
+}
+
+/*!
+  Moves \a series to \a group, so it is drawn with \ref groupPen "groupPen(group)".
+*/
+void QCPMultiGraph::setSeriesGroup(int series, int group)
+{
+  if (series < 0 || series >= seriesCount() || group < 0)
+  {
+    qDebug() << Q_FUNC_INFO << "invalid series or group" << series << group;
+    return;
+  }
+  mGroups[series] = group;
+}
+
+/*!
+  Preallocates room for \a series series with \a points data points in total, so adding them
+  doesn't reallocate the storage.
+*/
+void QCPMultiGraph::reserve(int series, int points)
+{
+  mKeys.reserve(points);
+  mValues.reserve(points);
+  mOffsets.reserve(series+1);
+  mGroups.reserve(series);
+  mKeyBounds.reserve(series);
+  mValueBounds.reserve(series);
+}
+
+/*!
+  Appends a series with the \a count data points given by \a keys and \a values, drawn with the pen
+  of \a group. The data is copied. Returns the index of the new series.
+*/
+int QCPMultiGraph::addSeries(const double *keys, const double *values, int count, int group)
+{
+  count = qMax(0, count);
+  const int offset = mKeys.size();
+  mKeys.resize(offset+count);
+  mValues.resize(offset+count);
+  double *seriesKeys = mKeys.data()+offset;
+  double *seriesValues = mValues.data()+offset;
+  if (std::is_sorted(keys, keys+count))
+  {
+    std::copy(keys, keys+count, seriesKeys);
+    std::copy(values, values+count, seriesValues);
+  } else
+  {
+    QVector<int> order(count);
+    for (int i=0; i<count; ++i)
+      order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [keys](int a, int b) { return keys[a] < keys[b]; });
+    for (int i=0; i<count; ++i)
+    {
+      seriesKeys[i] = keys[order.at(i)];
+      seriesValues[i] = values[order.at(i)];
+    }
+  }
+  
+  // bounds are kept per series, so drawing, hit testing and rescaling can skip series without touching their data:
+  QCPRange keyBounds(0, 0), valueBounds(0, 0);
+  bool found = false;
+  for (int i=0; i<count; ++i)
+  {
+    if (qIsNaN(seriesKeys[i]) || qIsNaN(seriesValues[i]))
+      continue;
+    if (!found)
+    {
+      keyBounds = QCPRange(seriesKeys[i], seriesKeys[i]);
+      valueBounds = QCPRange(seriesValues[i], seriesValues[i]);
+      found = true;
+    } else
+    {
+      keyBounds.expand(seriesKeys[i]);
+      valueBounds.expand(seriesValues[i]);
+    }
+  }
+  if (!found) // series without valid points are never visible
+  {
+    keyBounds = QCPRange(qQNaN(), qQNaN());
+    valueBounds = QCPRange(qQNaN(), qQNaN());
+  }
+  
+  mOffsets.append(offset+count);
+  mGroups.append(qMax(0, group));
+  mKeyBounds.append(keyBounds);
+  mValueBounds.append(valueBounds);
+  return seriesCount()-1;
+}
+
+/*! \overload
+
+  Appends a series from the vectors \a keys and \a values, which should have equal size. If they
+  don't, the extra points of the longer one are ignored.
+*/
+int QCPMultiGraph::addSeries(const QVector<double> &keys, const QVector<double> &values, int group)
+{
+  return addSeries(keys.constData(), values.constData(), qMin(keys.size(), values.size()), group);
+}
+
+/*!
+  Removes all series. The group pens are kept.
+*/
+void QCPMultiGraph::clearData()
+{
+  mKeys.clear();
+  mValues.clear();
+  mOffsets = QVector<int>(1, 0);
+  mGroups.clear();
+  mKeyBounds.clear();
+  mValueBounds.clear();
+}
+
+/*!
+  Returns the index of the series whose line passes closest to \a pixelPos, or -1 if no series
+  comes within the parent plot's \ref QCustomPlot::setSelectionTolerance "selection tolerance". If
+  \a distance is not null, it is set to the pixel distance of that series.
+*/
+int QCPMultiGraph::seriesAt(const QPointF &pixelPos, double *distance) const
+{
+  if (!mKeyAxis || !mValueAxis || !mParentPlot)
+    return -1;
+  
+  // only series whose bounds come within the tolerance around pixelPos are tested point by point:
+  const double tolerance = mParentPlot->selectionTolerance();
+  double key1, value1, key2, value2;
+  pixelsToCoords(pixelPos-QPointF(tolerance, tolerance), key1, value1);
+  pixelsToCoords(pixelPos+QPointF(tolerance, tolerance), key2, value2);
+  const QCPRange keyRange(qMin(key1, key2), qMax(key1, key2));
+  const QCPRange valueRange(qMin(value1, value2), qMax(value1, value2));
+  
+  int closestSeries = -1;
+  double closestDistance = tolerance;
+  for (int series=0; series<seriesCount(); ++series)
+  {
+    const QCPRange &keyBounds = mKeyBounds.at(series);
+    const QCPRange &valueBounds = mValueBounds.at(series);
+    if (!(keyBounds.upper >= keyRange.lower && keyBounds.lower <= keyRange.upper &&
+          valueBounds.upper >= valueRange.lower && valueBounds.lower <= valueRange.upper))
+      continue;
+    const double currentDistance = seriesDistance(series, pixelPos, keyRange);
+    if (currentDistance >= 0 && currentDistance <= closestDistance)
+    {
+      closestDistance = currentDistance;
+      closestSeries = series;
+    }
+  }
+  if (distance)
+    *distance = closestSeries >= 0 ? closestDistance : -1;
+  return closestSeries;
+}
+
+/*!
+  Implements a selectTest specific to this plottable's point geometry.
+
+  If \a details is not 0, it will be set to a \ref QCPDataSelection holding the index of the series
+  closest to \a pos (see \ref seriesAt).
+  
+  \seebaseclassmethod \ref QCPAbstractPlottable::selectTest
+*/
+double QCPMultiGraph::selectTest(const QPointF &pos, bool onlySelectable, QVariant *details) const
+{
+  if ((onlySelectable && mSelectable == QCP::stNone) || seriesCount() == 0)
+    return -1;
+  if (!mKeyAxis || !mValueAxis)
+    return -1;
+  
+  if (mKeyAxis.data()->axisRect()->rect().contains(pos.toPoint()) || mParentPlot->interactions().testFlag(QCP::iSelectPlottablesBeyondAxisRect))
+  {
+    double distance;
+    const int series = seriesAt(pos, &distance);
+    if (series < 0)
+      return -1;
+    if (details)
+      details->setValue(QCPDataSelection(QCPDataRange(series, series+1)));
+    return distance;
+  } else
+    return -1;
+}
+
+/* inherits documentation from base class */
+QCPRange QCPMultiGraph::getKeyRange(bool &foundRange, QCP::SignDomain inSignDomain) const
+{
+  QCPRange range;
+  foundRange = false;
+  for (int series=0; series<seriesCount(); ++series)
+  {
+    if (qIsNaN(mKeyBounds.at(series).lower))
+      continue;
+    if (inSignDomain == QCP::sdBoth)
+    {
+      if (!foundRange)
+        range = mKeyBounds.at(series);
+      else
+        range.expand(mKeyBounds.at(series));
+      foundRange = true;
+      continue;
+    }
+    for (int i=mOffsets.at(series); i<mOffsets.at(series+1); ++i)
+    {
+      const double current = mKeys.at(i);
+      if (qIsNaN(current) || qIsNaN(mValues.at(i)))
+        continue;
+      if ((inSignDomain == QCP::sdNegative && current < 0) || (inSignDomain == QCP::sdPositive && current > 0))
+      {
+        if (!foundRange)
+          range = QCPRange(current, current);
+        else
+          range.expand(current);
+        foundRange = true;
+      }
+    }
+  }
+  return range;
+}
+
+/* inherits documentation from base class */
+QCPRange QCPMultiGraph::getValueRange(bool &foundRange, QCP::SignDomain inSignDomain, const QCPRange &inKeyRange) const
+{
+  const bool restrictKeyRange = inKeyRange != QCPRange();
+  QCPRange range;
+  foundRange = false;
+  for (int series=0; series<seriesCount(); ++series)
+  {
+    const QCPRange &keyBounds = mKeyBounds.at(series);
+    if (qIsNaN(keyBounds.lower))
+      continue;
+    if (restrictKeyRange && (keyBounds.upper < inKeyRange.lower || keyBounds.lower > inKeyRange.upper))
+      continue;
+    // series entirely inside the key range and sign domain contribute their cached bounds:
+    if (inSignDomain == QCP::sdBoth && (!restrictKeyRange || (keyBounds.lower >= inKeyRange.lower && keyBounds.upper <= inKeyRange.upper)))
+    {
+      if (!foundRange)
+        range = mValueBounds.at(series);
+      else
+        range.expand(mValueBounds.at(series));
+      foundRange = true;
+      continue;
+    }
+    int begin = mOffsets.at(series), end = mOffsets.at(series+1);
+    if (restrictKeyRange)
+    {
+      begin = int(std::lower_bound(mKeys.constBegin()+begin, mKeys.constBegin()+end, inKeyRange.lower)-mKeys.constBegin());
+      end = int(std::upper_bound(mKeys.constBegin()+begin, mKeys.constBegin()+end, inKeyRange.upper)-mKeys.constBegin());
+    }
+    for (int i=begin; i<end; ++i)
+    {
+      const double current = mValues.at(i);
+      if (qIsNaN(current) || qIsNaN(mKeys.at(i)))
+        continue;
+      if (inSignDomain == QCP::sdBoth || (inSignDomain == QCP::sdNegative && current < 0) || (inSignDomain == QCP::sdPositive && current > 0))
+      {
+        if (!foundRange)
+          range = QCPRange(current, current);
+        else
+          range.expand(current);
+        foundRange = true;
+      }
+    }
+  }
+  return range;
+}
+
+/* inherits documentation from base class */
+void QCPMultiGraph::draw(QCPPainter *painter)
+{
+  if (!mKeyAxis || !mValueAxis) { qDebug() << Q_FUNC_INFO << "invalid key or value axis"; return; }
+  if (mKeyAxis.data()->range().size() <= 0 || seriesCount() == 0) return;
+  
+  const QCPRange keyRange = mKeyAxis.data()->range();
+  const QCPRange valueRange = mValueAxis.data()->range();
+  const int count = seriesCount();
+  
+  // selected series are drawn last, on top of the others:
+  QVector<bool> selectedSeries(count, mSelectable == QCP::stWhole && selected());
+  if (mSelectable != QCP::stWhole)
+  {
+    foreach (const QCPDataRange &dataRange, mSelection.dataRanges())
+    {
+      for (int series=qMax(0, dataRange.begin()); series<qMin(count, dataRange.end()); ++series)
+        selectedSeries[series] = true;
+    }
+  }
+  
+  // bucket the visible series by group, so each group's pen is set once:
+  int groupCount = mGroupPens.size();
+  for (int series=0; series<count; ++series)
+    groupCount = qMax(groupCount, mGroups.at(series)+1);
+  QVector<int> groupStart(groupCount+1, 0);
+  QVector<int> order;
+  order.reserve(count);
+  for (int series=0; series<count; ++series)
+  {
+    const QCPRange &keyBounds = mKeyBounds.at(series);
+    const QCPRange &valueBounds = mValueBounds.at(series);
+    if (keyBounds.upper >= keyRange.lower && keyBounds.lower <= keyRange.upper &&
+        valueBounds.upper >= valueRange.lower && valueBounds.lower <= valueRange.upper)
+      ++groupStart[mGroups.at(series)+1];
+  }
+  for (int group=0; group<groupCount; ++group)
+    groupStart[group+1] += groupStart[group];
+  order.resize(groupStart.last());
+  QVector<int> groupFill(groupStart);
+  for (int series=0; series<count; ++series)
+  {
+    const QCPRange &keyBounds = mKeyBounds.at(series);
+    const QCPRange &valueBounds = mValueBounds.at(series);
+    if (keyBounds.upper >= keyRange.lower && keyBounds.lower <= keyRange.upper &&
+        valueBounds.upper >= valueRange.lower && valueBounds.lower <= valueRange.upper)
+      order[groupFill[mGroups.at(series)]++] = series;
+  }
+  
+  applyDefaultAntialiasingHint(painter);
+  painter->setBrush(Qt::NoBrush);
+  QVector<QPointF> lineBuffer;
+  for (int group=0; group<groupCount; ++group)
+  {
+    if (groupStart.at(group) == groupStart.at(group+1))
+      continue;
+    painter->setPen(groupPen(group));
+    for (int i=groupStart.at(group); i<groupStart.at(group+1); ++i)
+    {
+      if (!selectedSeries.at(order.at(i)))
+        drawSeries(painter, order.at(i), lineBuffer);
+    }
+  }
+  if (mSelectionDecorator)
+    mSelectionDecorator->applyPen(painter);
+  else
+    painter->setPen(mPen);
+  for (int i=0; i<order.size(); ++i)
+  {
+    if (selectedSeries.at(order.at(i)))
+      drawSeries(painter, order.at(i), lineBuffer);
+  }
+}
+
+/* inherits documentation from base class */
+void QCPMultiGraph::drawLegendIcon(QCPPainter *painter, const QRectF &rect) const
+{
+  applyDefaultAntialiasingHint(painter);
+  painter->setPen(groupPen(0));
+  painter->drawLine(QLineF(rect.left(), rect.y()+rect.height()/2.0, rect.right()+5, rect.y()+rect.height()/2.0)); // +5 on x2 else last segment is missing from dashed/dotted pens
+}
+
+/*! \internal
+
+  Sets \a begin and \a end to the absolute indices (into \ref mKeys) of the points of \a series that
+  are needed to draw it over \a keyRange: the points inside the range plus one neighbour on each
+  side, so lines leaving the range are drawn up to the border.
+*/
+void QCPMultiGraph::getVisibleRange(int series, const QCPRange &keyRange, int &begin, int &end) const
+{
+  const double *first = mKeys.constData()+mOffsets.at(series);
+  const double *last = mKeys.constData()+mOffsets.at(series+1);
+  const double *lower = std::lower_bound(first, last, keyRange.lower);
+  const double *upper = std::upper_bound(lower, last, keyRange.upper);
+  if (lower != first)
+    --lower;
+  if (upper != last)
+    ++upper;
+  begin = int(lower-mKeys.constData());
+  end = int(upper-mKeys.constData());
+}
+
+/*! \internal
+
+  Fills \a lines with the pixel coordinates of the visible part of \a series. NaN values are passed
+  on as NaN points, so \ref drawSeries can break the line there.
+  
+  If the series has many more points than the key axis has pixels, the points are reduced to the
+  minimum and maximum value per pixel column, in the order they occur, which draws the same shape
+  with at most two points per column (see \ref QCPColumnReducer).
+*/
+void QCPMultiGraph::getSeriesLines(int series, QVector<QPointF> *lines) const
+{
+  lines->clear();
+  QCPAxis *keyAxis = mKeyAxis.data();
+  QCPAxis *valueAxis = mValueAxis.data();
+  int begin, end;
+  getVisibleRange(series, keyAxis->range(), begin, end);
+  if (begin == end)
+    return;
+  const bool keyIsHorizontal = keyAxis->orientation() == Qt::Horizontal;
+  const double *keys = mKeys.constData();
+  const double *values = mValues.constData();
+  const int pixelLength = qMax(1, keyIsHorizontal ? keyAxis->axisRect()->width() : keyAxis->axisRect()->height());
+  
+  if (end-begin <= 4*pixelLength)
+  {
+    lines->resize(end-begin);
+    QPointF *point = lines->data();
+    for (int i=begin; i<end; ++i, ++point)
+    {
+      const double keyPixel = keyAxis->coordToPixel(keys[i]);
+      const double valuePixel = qIsNaN(values[i]) ? qQNaN() : valueAxis->coordToPixel(values[i]);
+      *point = keyIsHorizontal ? QPointF(keyPixel, valuePixel) : QPointF(valuePixel, keyPixel);
+    }
+    return;
+  }
+  
+  lines->reserve(2*pixelLength+4);
+  QCPColumnReducer reducer(lines, keyIsHorizontal);
+  for (int i=begin; i<end; ++i)
+    reducer.addPoint(keyAxis->coordToPixel(keys[i]), qIsNaN(values[i]) ? qQNaN() : valueAxis->coordToPixel(values[i]));
+  reducer.finish();
+}
+
+/*! \internal
+
+  Draws \a series with the painter's current pen. \a lineBuffer is reused between calls to avoid
+  reallocating it for every series.
+*/
+void QCPMultiGraph::drawSeries(QCPPainter *painter, int series, QVector<QPointF> &lineBuffer) const
+{
+  getSeriesLines(series, &lineBuffer);
+  const QPointF *points = lineBuffer.constData();
+  const int count = lineBuffer.size();
+  int segmentStart = 0;
+  for (int i=0; i<=count; ++i)
+  {
+    if (i == count || qIsNaN(points[i].x()) || qIsNaN(points[i].y()))
+    {
+      if (i-segmentStart > 1)
+        painter->drawPolyline(points+segmentStart, i-segmentStart);
+      segmentStart = i+1;
+    }
+  }
+}
+
+/*! \internal
+
+  Returns the pixel distance of \a pixelPos to the line of \a series, considering only the
+  segments around \a keyRange, or -1 if the series has no points there.
+*/
+double QCPMultiGraph::seriesDistance(int series, const QPointF &pixelPos, const QCPRange &keyRange) const
+{
+  int begin, end;
+  getVisibleRange(series, keyRange, begin, end);
+  double minDistSqr = (std::numeric_limits<double>::max)();
+  const QCPVector2D pos(pixelPos);
+  bool havePrevious = false;
+  QPointF previous;
+  for (int i=begin; i<end; ++i)
+  {
+    if (qIsNaN(mValues.at(i)))
+    {
+      havePrevious = false;
+      continue;
+    }
+    const QPointF current = coordsToPixels(mKeys.at(i), mValues.at(i));
+    const double currentDistSqr = havePrevious ? pos.distanceSquaredToLine(previous, current) : (QCPVector2D(current)-pos).lengthSquared();
+    if (currentDistSqr < minDistSqr)
+      minDistSqr = currentDistSqr;
+    previous = current;
+    havePrevious = true;
+  }
+  return minDistSqr == (std::numeric_limits<double>::max)() ? -1 : qSqrt(minDistSqr);
+}
+/* end of 'src/plottables/plottable-multigraph.cpp' */
+
+
+/* including file 'src/plottables/plottable-seriesgraph.cpp' */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////// QCPAbstractSeriesStorage
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! \class QCPAbstractSeriesStorage
+  \brief Interface of the data storage behind a \ref QCPSeriesGraph
+
+  A \ref QCPDataContainer owns its data as an array of data point structs, so plotting data that
+  already lives elsewhere means copying (and sorting) it. A series storage instead presents data
+  points by index, sorted by key, and leaves the memory layout to the subclass: \ref
+  QCPArraySeriesStorage adapts external key and value arrays without copying them.
+  
+  Subclasses must implement \ref size, \ref key and \ref value. The remaining methods have generic
+  implementations based on these, with the same semantics as their \ref QCPDataContainer
+  counterparts, and may be reimplemented where the layout allows doing better. Plottables read
+  data in blocks of up to \ref readBlockSize points through \ref read, which should be the fastest
+  way to get at a range of points.
+*/
+
+/* start of documentation of pure virtual functions */
+
+/*! \fn virtual int QCPAbstractSeriesStorage::size() const = 0
+
+  Returns the number of data points.
+*/
+
+/*! \fn virtual double QCPAbstractSeriesStorage::key(int index) const = 0
+
+  Returns the key of the data point at \a index. Keys must be ascending with the index.
+*/
+
+/*! \fn virtual double QCPAbstractSeriesStorage::value(int index) const = 0
+
+  Returns the value of the data point at \a index. NaN values create gaps in the graph.
+*/
+
+/* end of documentation of pure virtual functions */
+
+/*!
+  Writes the keys and values of the data points in the index range [\a begin, \a end) to \a keys
+  and \a values, which must have room for <tt>end-begin</tt> elements each.
+*/
+void QCPAbstractSeriesStorage::read(int begin, int end, double *keys, double *values) const
+{
+  for (int i=begin; i<end; ++i)
+  {
+    *keys++ = key(i);
+    *values++ = value(i);
+  }
+}
+
+/*!
+  Returns the index of the data point with a key that is equal to, just below, or just above \a
+  sortKey. If \a expandedRange is true, the data point just below \a sortKey will be considered,
+  otherwise the one just above. Behaves like \ref QCPDataContainer::findBegin, with indices in
+  place of iterators.
+*/
+int QCPAbstractSeriesStorage::findBegin(double sortKey, bool expandedRange) const
+{
+  int begin = 0, end = size();
+  while (begin < end) // lower bound: first index with key >= sortKey
+  {
+    const int middle = begin+(end-begin)/2;
+    if (key(middle) < sortKey)
+      begin = middle+1;
+    else
+      end = middle;
+  }
+  if (expandedRange && begin > 0)
+    --begin;
+  return begin;
+}
+
+/*!
+  Returns the index after the data point with a key that is equal to, just above, or just below \a
+  sortKey. If \a expandedRange is true, the data point just above \a sortKey will be considered,
+  otherwise the one just below. Behaves like \ref QCPDataContainer::findEnd, with indices in place
+  of iterators.
+*/
+int QCPAbstractSeriesStorage::findEnd(double sortKey, bool expandedRange) const
+{
+  const int count = size();
+  int begin = 0, end = count;
+  while (begin < end) // upper bound: first index with key > sortKey
+  {
+    const int middle = begin+(end-begin)/2;
+    if (sortKey < key(middle))
+      end = middle;
+    else
+      begin = middle+1;
+  }
+  if (expandedRange && begin < count)
+    ++begin;
+  return begin;
+}
+
+/*!
+  Returns the range encompassed by the keys of all data points with a non-NaN value, like \ref
+  QCPDataContainer::keyRange. The output parameter \a foundRange indicates whether a sensible range
+  was found.
+*/
+QCPRange QCPAbstractSeriesStorage::keyRange(bool &foundRange, QCP::SignDomain signDomain) const
+{
+  QCPRange range;
+  bool haveLower = false;
+  bool haveUpper = false;
+  const int count = size();
+  if (signDomain == QCP::sdBoth) // keys are sorted, so the range is spanned by the outermost points with a value
+  {
+    for (int i=0; i<count; ++i)
+    {
+      if (!qIsNaN(value(i)))
+      {
+        range.lower = key(i);
+        haveLower = true;
+        break;
+      }
+    }
+    for (int i=count-1; i>=0; --i)
+    {
+      if (!qIsNaN(value(i)))
+      {
+        range.upper = key(i);
+        haveUpper = true;
+        break;
+      }
+    }
+  } else
+  {
+    double keys[readBlockSize], values[readBlockSize];
+    for (int blockBegin=0; blockBegin<count; blockBegin+=readBlockSize)
+    {
+      const int blockSize = qMin(int(readBlockSize), count-blockBegin);
+      read(blockBegin, blockBegin+blockSize, keys, values);
+      for (int i=0; i<blockSize; ++i)
+      {
+        const double current = keys[i];
+        if (qIsNaN(values[i]) || (signDomain == QCP::sdNegative && current >= 0) || (signDomain == QCP::sdPositive && current <= 0))
+          continue;
+        if (current < range.lower || !haveLower)
+        {
+          range.lower = current;
+          haveLower = true;
+        }
+        if (current > range.upper || !haveUpper)
+        {
+          range.upper = current;
+          haveUpper = true;
+        }
+      }
+    }
+  }
+  
+  foundRange = haveLower && haveUpper;
+  return range;
+}
+
+/*!
+  Returns the range encompassed by the values of the data points in the key range \a inKeyRange,
+  like \ref QCPDataContainer::valueRange. If \a inKeyRange is <tt>QCPRange()</tt>, all data
+  points are considered. NaN and infinite values are ignored.
+*/
+QCPRange QCPAbstractSeriesStorage::valueRange(bool &foundRange, QCP::SignDomain signDomain, const QCPRange &inKeyRange) const
+{
+  QCPRange range;
+  const bool restrictKeyRange = inKeyRange != QCPRange();
+  bool haveLower = false;
+  bool haveUpper = false;
+  int begin = 0;
+  int end = size();
+  if (restrictKeyRange)
+  {
+    begin = findBegin(inKeyRange.lower, false);
+    end = findEnd(inKeyRange.upper, false);
+  }
+  double keys[readBlockSize], values[readBlockSize];
+  for (int blockBegin=begin; blockBegin<end; blockBegin+=readBlockSize)
+  {
+    const int blockSize = qMin(int(readBlockSize), end-blockBegin);
+    read(blockBegin, blockBegin+blockSize, keys, values);
+    for (int i=0; i<blockSize; ++i)
+    {
+      const double current = values[i];
+      if (qIsNaN(current) || !std::isfinite(current) || (signDomain == QCP::sdNegative && current >= 0) || (signDomain == QCP::sdPositive && current <= 0))
+        continue;
+      if (current < range.lower || !haveLower)
+      {
+        range.lower = current;
+        haveLower = true;
+      }
+      if (current > range.upper || !haveUpper)
+      {
+        range.upper = current;
+        haveUpper = true;
+      }
+    }
+  }
+  
+  foundRange = haveLower && haveUpper;
+  return range;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////// QCPCompressedSeriesStorage
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! \class QCPCompressedSeriesStorage
+  \brief Series storage keeping its data compressed in memory
+
+  Stores data points in compressed blocks of \ref pointsPerBlock points, so long series such as
+  years of sensor readings take a fraction of the 16 bytes per point of a \ref
+  QCPGraphDataContainer. Blocks are only decompressed when their points are read, so drawing a
+  \ref QCPSeriesGraph decompresses just the blocks of the visible key range.
+  
+  Keys are stored as delta-of-deltas when all keys of a block are integers (e.g. timestamps in
+  seconds), which costs a single byte per point for a regular sampling interval. Other keys, and
+  all values, are stored as the XOR with the previous key or value, without the leading and
+  trailing zero bytes, so repeated and slowly changing values are cheap. With \ref vpSingle, values
+  are rounded to single precision first, which makes their XOR much shorter; a year of CGM
+  readings at 5 minute intervals takes about 4 bytes per point.
+  
+  Points are appended with \ref add, in ascending key order. They are collected uncompressed until
+  a block is full; call \ref squeeze to compress the remainder, too, once a series is complete.
+  
+  The storage caches the last decoded block for random access, so it must not be read from
+  several threads at once.
+*/
+
+/*!
+  Creates an empty storage. \a precision defines whether values are stored exactly or rounded to
+  single precision.
+*/
+QCPCompressedSeriesStorage::QCPCompressedSeriesStorage(ValuePrecision precision) :
+  mPrecision(precision),
+  mEncodedSize(0),
+  mCachedBlock(-1)
+{
+}
+
+/*!
+  Returns the memory used by the stored points in bytes: the compressed blocks and their index,
+  plus the points not compressed yet.
+*/
+int QCPCompressedSeriesStorage::compressedSize() const
+{
+  return mBytes.size() + mBlocks.size()*int(sizeof(Block)) + mTailKeys.size()*2*int(sizeof(double));
+}
+
+/*!
+  Appends the points given by \a keys and \a values, which should have equal size. Keys must be
+  ascending and not below the last key already stored.
+*/
+void QCPCompressedSeriesStorage::add(const QVector<double> &keys, const QVector<double> &values)
+{
+  const int count = qMin(keys.size(), values.size());
+  for (int i=0; i<count; ++i)
+    add(keys.at(i), values.at(i));
+}
+
+/*! \overload
+
+  Appends the point \a key, \a value. \a key must not be below the last key already stored.
+*/
+void QCPCompressedSeriesStorage::add(double key, double value)
+{
+  mTailKeys.append(key);
+  mTailValues.append(mPrecision == vpSingle ? double(float(value)) : value);
+  if (mTailKeys.size() == pointsPerBlock)
+    squeeze();
+}
+
+/*!
+  Compresses the points that were added since the last full block. Adding points afterwards starts
+  a new block, so squeezing often leaves short blocks, which compress less well.
+*/
+void QCPCompressedSeriesStorage::squeeze()
+{
+  if (mTailKeys.isEmpty())
+    return;
+  encodeBlock(mTailKeys.constData(), mTailValues.constData(), mTailKeys.size());
+  mTailKeys.clear();
+  mTailValues.clear();
+}
+
+/*!
+  Removes all points.
+*/
+void QCPCompressedSeriesStorage::clear()
+{
+  mBytes.clear();
+  mBlocks.clear();
+  mEncodedSize = 0;
+  mTailKeys.clear();
+  mTailValues.clear();
+  mCachedBlock = -1;
+}
+
+/* inherits documentation from base class */
+double QCPCompressedSeriesStorage::key(int index) const
+{
+  const double *keys, *values;
+  int begin, count;
+  blockData(blockOf(index), keys, values, begin, count);
+  return keys[index-begin];
+}
+
+/* inherits documentation from base class */
+double QCPCompressedSeriesStorage::value(int index) const
+{
+  const double *keys, *values;
+  int begin, count;
+  blockData(blockOf(index), keys, values, begin, count);
+  return values[index-begin];
+}
+
+/* inherits documentation from base class */
+void QCPCompressedSeriesStorage::read(int begin, int end, double *keys, double *values) const
+{
+  int block = blockOf(begin);
+  while (begin < end)
+  {
+    const double *blockKeys, *blockValues;
+    int blockBegin, blockCount;
+    blockData(block, blockKeys, blockValues, blockBegin, blockCount);
+    const int first = begin-blockBegin;
+    const int count = qMin(end, blockBegin+blockCount)-begin;
+    std::copy(blockKeys+first, blockKeys+first+count, keys);
+    std::copy(blockValues+first, blockValues+first+count, values);
+    keys += count;
+    values += count;
+    begin += count;
+    ++block;
+  }
+}
+
+/* inherits documentation from base class */
+int QCPCompressedSeriesStorage::findBegin(double sortKey, bool expandedRange) const
+{
+  int index = searchKey(sortKey, false);
+  if (expandedRange && index > 0)
+    --index;
+  return index;
+}
+
+/* inherits documentation from base class */
+int QCPCompressedSeriesStorage::findEnd(double sortKey, bool expandedRange) const
+{
+  int index = searchKey(sortKey, true);
+  if (expandedRange && index < size())
+    ++index;
+  return index;
+}
+
+/*!
+  Returns the range of the values, like \ref QCPAbstractSeriesStorage::valueRange. Blocks that lie
+  entirely within \a inKeyRange and \a signDomain contribute their stored value bounds, so only the
+  blocks at the edges of the range are decompressed.
+*/
+QCPRange QCPCompressedSeriesStorage::valueRange(bool &foundRange, QCP::SignDomain signDomain, const QCPRange &inKeyRange) const
+{
+  QCPRange range;
+  bool found = false;
+  auto include = [&](double lower, double upper) {
+    if (!found)
+    {
+      range = QCPRange(lower, upper);
+      found = true;
+    } else
+    {
+      range.expand(lower);
+      range.expand(upper);
+    }
+  };
+  
+  int begin = 0;
+  int end = size();
+  if (inKeyRange != QCPRange())
+  {
+    begin = findBegin(inKeyRange.lower, false);
+    end = findEnd(inKeyRange.upper, false);
+  }
+  if (begin >= end)
+  {
+    foundRange = false;
+    return range;
+  }
+  for (int block=blockOf(begin); block<=blockOf(end-1); ++block)
+  {
+    if (block < mBlocks.size())
+    {
+      const Block &info = mBlocks.at(block);
+      if (!info.hasValues)
+        continue;
+      const bool entirelyInKeyRange = info.begin >= begin && info.begin+info.count <= end;
+      const bool entirelyInSignDomain = signDomain == QCP::sdBoth || (signDomain == QCP::sdNegative && info.maxValue < 0) || (signDomain == QCP::sdPositive && info.minValue > 0);
+      const bool outsideSignDomain = (signDomain == QCP::sdNegative && info.minValue >= 0) || (signDomain == QCP::sdPositive && info.maxValue <= 0);
+      if (outsideSignDomain)
+        continue;
+      if (entirelyInKeyRange && entirelyInSignDomain)
+      {
+        include(info.minValue, info.maxValue);
+        continue;
+      }
+    }
+    const double *keys, *values;
+    int blockBegin, blockCount;
+    blockData(block, keys, values, blockBegin, blockCount);
+    const int first = qMax(begin, blockBegin)-blockBegin;
+    const int last = qMin(end, blockBegin+blockCount)-blockBegin;
+    for (int i=first; i<last; ++i)
+    {
+      const double current = values[i];
+      if (qIsNaN(current) || !std::isfinite(current) || (signDomain == QCP::sdNegative && current >= 0) || (signDomain == QCP::sdPositive && current <= 0))
+        continue;
+      include(current, current);
+    }
+  }
+  foundRange = found;
+  return range;
+}
+
+/*! \internal
+
+  Compresses \a count points into a new block at the end of \ref mBytes.
+  
+  Layout: a flag byte (bit 0 set if the keys are delta-of-delta coded), the first key as raw
+  double, then the remaining keys, then all values. Delta-of-deltas are zigzag varints. XOR coded
+  numbers are a control byte, 0 for a repeated number and otherwise (trailing zero bytes << 4) |
+  significant bytes, followed by the significant bytes, least significant first.
+*/
+void QCPCompressedSeriesStorage::encodeBlock(const double *keys, const double *values, int count)
+{
+  Block block;
+  block.begin = mEncodedSize;
+  block.count = count;
+  block.offset = mBytes.size();
+  block.firstKey = keys[0];
+  block.lastKey = keys[count-1];
+  block.hasValues = false;
+  block.minValue = block.maxValue = 0;
+  
+  QByteArray &out = mBytes;
+  auto putVarint = [&out](quint64 number) {
+    while (number >= 0x80)
+    {
+      out.append(char(number | 0x80));
+      number >>= 7;
+    }
+    out.append(char(number));
+  };
+  auto putXor = [&out](quint64 bits, int width) {
+    if (!bits)
+    {
+      out.append(char(0));
+      return;
+    }
+    int trailing = 0;
+    while (!(bits & 0xff))
+    {
+      bits >>= 8;
+      ++trailing;
+    }
+    int significant = 0;
+    for (quint64 rest=bits; rest; rest >>= 8)
+      ++significant;
+    Q_ASSERT(trailing+significant <= width);
+    out.append(char(trailing << 4 | significant));
+    for (int i=0; i<significant; ++i, bits >>= 8)
+      out.append(char(bits & 0xff));
+  };
+  
+  // integral keys (up to 2^53, where doubles are still exact integers) are coded as delta-of-deltas:
+  bool integerKeys = true;
+  for (int i=0; i<count && integerKeys; ++i)
+    integerKeys = std::fabs(keys[i]) < 9007199254740992.0 && keys[i] == std::floor(keys[i]);
+  out.append(char(integerKeys ? 1 : 0));
+  out.append(reinterpret_cast<const char*>(&keys[0]), int(sizeof(double)));
+  if (integerKeys)
+  {
+    qint64 previousDelta = 0;
+    for (int i=1; i<count; ++i)
+    {
+      const qint64 delta = qint64(keys[i])-qint64(keys[i-1]);
+      const qint64 deltaOfDelta = delta-previousDelta;
+      putVarint((quint64(deltaOfDelta) << 1) ^ quint64(deltaOfDelta >> 63));
+      previousDelta = delta;
+    }
+  } else
+  {
+    for (int i=1; i<count; ++i)
+    {
+      quint64 bits, previousBits;
+      memcpy(&bits, &keys[i], sizeof(bits));
+      memcpy(&previousBits, &keys[i-1], sizeof(previousBits));
+      putXor(bits ^ previousBits, 8);
+    }
+  }
+  
+  quint64 previousBits = 0;
+  for (int i=0; i<count; ++i)
+  {
+    quint64 bits;
+    if (mPrecision == vpSingle)
+    {
+      const float single = float(values[i]);
+      quint32 singleBits;
+      memcpy(&singleBits, &single, sizeof(singleBits));
+      bits = singleBits;
+    } else
+      memcpy(&bits, &values[i], sizeof(bits));
+    putXor(bits ^ previousBits, mPrecision == vpSingle ? 4 : 8);
+    previousBits = bits;
+    
+    if (!qIsNaN(values[i]) && std::isfinite(values[i]))
+    {
+      if (!block.hasValues)
+      {
+        block.minValue = block.maxValue = values[i];
+        block.hasValues = true;
+      } else
+      {
+        block.minValue = qMin(block.minValue, values[i]);
+        block.maxValue = qMax(block.maxValue, values[i]);
+      }
+    }
+  }
+  
+  mBlocks.append(block);
+  mEncodedSize += count;
+}
+
+/*! \internal
+
+  Decompresses the points of \a block into \a keys and \a values. See \ref encodeBlock for the
+  layout.
+*/
+void QCPCompressedSeriesStorage::decodeBlock(int block, double *keys, double *values) const
+{
+  const Block &info = mBlocks.at(block);
+  const uchar *p = reinterpret_cast<const uchar*>(mBytes.constData())+info.offset;
+  auto getXor = [&p]() {
+    const uchar control = *p++;
+    const int trailing = control >> 4;
+    const int significant = control & 0x0f;
+    quint64 bits = 0;
+    for (int i=significant-1; i>=0; --i)
+      bits = bits << 8 | p[i];
+    p += significant;
+    return bits << (8*trailing);
+  };
+  
+  const bool integerKeys = *p++ & 1;
+  memcpy(&keys[0], p, sizeof(double));
+  p += sizeof(double);
+  if (integerKeys)
+  {
+    qint64 previous = qint64(keys[0]);
+    qint64 delta = 0;
+    for (int i=1; i<info.count; ++i)
+    {
+      quint64 number = 0;
+      for (int shift=0;; shift += 7)
+      {
+        const uchar byte = *p++;
+        number |= quint64(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+          break;
+      }
+      delta += qint64(number >> 1) ^ -qint64(number & 1);
+      previous += delta;
+      keys[i] = double(previous);
+    }
+  } else
+  {
+    quint64 bits;
+    memcpy(&bits, &keys[0], sizeof(bits));
+    for (int i=1; i<info.count; ++i)
+    {
+      bits ^= getXor();
+      memcpy(&keys[i], &bits, sizeof(bits));
+    }
+  }
+  
+  quint64 bits = 0;
+  for (int i=0; i<info.count; ++i)
+  {
+    bits ^= getXor();
+    if (mPrecision == vpSingle)
+    {
+      const quint32 singleBits = quint32(bits);
+      float single;
+      memcpy(&single, &singleBits, sizeof(single));
+      values[i] = single;
+    } else
+      memcpy(&values[i], &bits, sizeof(bits));
+  }
+}
+
+/*! \internal
+
+  Returns the block holding the point at \a index. The uncompressed tail counts as the block after
+  the last compressed one.
+*/
+int QCPCompressedSeriesStorage::blockOf(int index) const
+{
+  if (index >= mEncodedSize)
+    return mBlocks.size();
+  // blocks are full except after a squeeze, so the block at index/pointsPerBlock is a close guess:
+  int block = qMin(index/pointsPerBlock, mBlocks.size()-1);
+  while (mBlocks.at(block).begin > index)
+    --block;
+  while (mBlocks.at(block).begin+mBlocks.at(block).count <= index)
+    ++block;
+  return block;
+}
+
+/*! \internal
+
+  Makes the points of \a block available as \a keys and \a values arrays holding \a count points,
+  the first of which has the index \a begin. Compressed blocks are decoded into a cache that stays
+  valid until a different block is requested.
+*/
+void QCPCompressedSeriesStorage::blockData(int block, const double *&keys, const double *&values, int &begin, int &count) const
+{
+  if (block >= mBlocks.size())
+  {
+    keys = mTailKeys.constData();
+    values = mTailValues.constData();
+    begin = mEncodedSize;
+    count = mTailKeys.size();
+    return;
+  }
+  if (block != mCachedBlock)
+  {
+    mCachedKeys.resize(mBlocks.at(block).count);
+    mCachedValues.resize(mBlocks.at(block).count);
+    decodeBlock(block, mCachedKeys.data(), mCachedValues.data());
+    mCachedBlock = block;
+  }
+  keys = mCachedKeys.constData();
+  values = mCachedValues.constData();
+  begin = mBlocks.at(block).begin;
+  count = mBlocks.at(block).count;
+}
+
+/*! \internal
+
+  Returns the index of the first point with a key not below \a sortKey, or above it if \a
+  upperBound is true. The block is found by its key bounds, so only that block is decompressed.
+*/
+int QCPCompressedSeriesStorage::searchKey(double sortKey, bool upperBound) const
+{
+  // first block whose last key could still be at or past sortKey:
+  QVector<Block>::const_iterator it = std::partition_point(mBlocks.constBegin(), mBlocks.constEnd(), [sortKey, upperBound](const Block &block) {
+    return upperBound ? block.lastKey <= sortKey : block.lastKey < sortKey;
+  });
+  const int block = int(it-mBlocks.constBegin());
+  const double *keys, *values;
+  int begin, count;
+  blockData(block, keys, values, begin, count);
+  const double *found = upperBound ? std::upper_bound(keys, keys+count, sortKey) : std::lower_bound(keys, keys+count, sortKey);
+  return begin+int(found-keys);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////// QCPFloatSeriesStorage
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! \class QCPFloatSeriesStorage
+  \brief Series storage holding values in single precision
+
+  Keeps a copy of the data with keys as doubles and values as floats, 12 instead of 16 bytes per
+  point. Keys stay in double precision, since typical keys (timestamps in seconds) would lose whole
+  seconds as floats. The float precision of about seven significant digits is far beyond that of
+  most measured values.
+  
+  This is a \ref QCPArraySeriesStorage over vectors it owns, so keys must be ascending.
+*/
+
+/*!
+  Creates a storage of \a keys and \a values, rounding the values to single precision. \a keys is
+  shared, not copied.
+*/
+QCPFloatSeriesStorage::QCPFloatSeriesStorage(const QVector<double> &keys, const QVector<double> &values) :
+  QCPArraySeriesStorage<double, float>(keys, toSinglePrecision(values))
+{
+}
+
+/*! \internal
+
+  Returns \a values converted to float.
+*/
+QVector<float> QCPFloatSeriesStorage::toSinglePrecision(const QVector<double> &values)
+{
+  QVector<float> result(values.size());
+  std::copy(values.constBegin(), values.constEnd(), result.begin());
+  return result;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////// QCPSeriesGraph
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! \class QCPSeriesGraph
+  \brief A line graph drawing its data from a series storage instead of a data container
+
+  Where \ref QCPGraph copies its data into a \ref QCPGraphDataContainer, QCPSeriesGraph reads it
+  through a \ref QCPAbstractSeriesStorage, so large series held elsewhere (e.g. by a simulation,
+  or in a memory mapped file via \ref QCPArraySeriesStorage) are plotted without doubling their
+  memory. Only the points in the visible key range are read, in blocks, and series much denser
+  than the axis has pixels are reduced to the minimum and maximum value per pixel column before
+  they reach the painter.
+  
+  The graph draws its data points connected by straight lines (with the \ref setPen "pen") and,
+  optionally, scatter symbols (\ref setScatterStyle). It implements the 1D plottable interface, so
+  data selection, rectangle selection and selection decorators work as with \ref QCPGraph.
+  
+  The storage may be shared between several graphs. It is not copied, so changes of the
+  underlying data become visible with the next replot.
+*/
+
+/* start of documentation of inline functions */
+
+/*! \fn QSharedPointer<QCPAbstractSeriesStorage> QCPSeriesGraph::data() const
+
+  Returns the storage the graph reads its data from, or a null pointer if none was set.
+*/
+
+/* end of documentation of inline functions */
+
+/*!
+  Constructs a series graph which uses \a keyAxis as its key axis ("x") and \a valueAxis as its
+  value axis ("y"). \a keyAxis and \a valueAxis must reside in the same QCustomPlot instance and
+  not have the same orientation.
+  
+  The created QCPSeriesGraph is automatically registered with the QCustomPlot instance inferred
+  from \a keyAxis. This QCustomPlot instance takes ownership of the QCPSeriesGraph, so do not
+  delete it manually but use QCustomPlot::removePlottable() instead.
+*/
+QCPSeriesGraph::QCPSeriesGraph(QCPAxis *keyAxis, QCPAxis *valueAxis) :
+  QCPAbstractPlottable(keyAxis, valueAxis)
+{
+  setPen(QPen(Qt::blue, 0));
+  setBrush(Qt::NoBrush);
+}
+
+QCPSeriesGraph::~QCPSeriesGraph()
+{
+}
+
+/*!
+  Sets the storage the graph reads its data from. The storage is shared, not copied.
+*/
+void QCPSeriesGraph::setData(QSharedPointer<QCPAbstractSeriesStorage> storage)
+{
+  mStorage = storage;
+}
+
+/*!
+  Sets the visual appearance of single data points in the plot. If set to \ref
+  QCPScatterStyle::ssNone, no scatter points are drawn (e.g. for line-only-plots with appropriate
+  line style).
+*/
+void QCPSeriesGraph::setScatterStyle(const QCPScatterStyle &style)
+{
+  mScatterStyle = style;
+}
+
+/* inherits documentation from base class */
+int QCPSeriesGraph::dataCount() const
+{
+  return mStorage ? mStorage->size() : 0;
+}
+
+/* inherits documentation from base class */
+double QCPSeriesGraph::dataMainKey(int index) const
+{
+  if (index >= 0 && index < dataCount())
+    return mStorage->key(index);
+  qDebug() << Q_FUNC_INFO << "Index out of bounds" << index;
+  return 0;
+}
+
+/* inherits documentation from base class */
+double QCPSeriesGraph::dataSortKey(int index) const
+{
+  return dataMainKey(index);
+}
+
+/* inherits documentation from base class */
+double QCPSeriesGraph::dataMainValue(int index) const
+{
+  if (index >= 0 && index < dataCount())
+    return mStorage->value(index);
+  qDebug() << Q_FUNC_INFO << "Index out of bounds" << index;
+  return 0;
+}
+
+/* inherits documentation from base class */
+QCPRange QCPSeriesGraph::dataValueRange(int index) const
+{
+  const double value = dataMainValue(index);
+  return QCPRange(value, value);
+}
+
+/* inherits documentation from base class */
+QPointF QCPSeriesGraph::dataPixelPosition(int index) const
+{
+  if (index >= 0 && index < dataCount())
+    return coordsToPixels(mStorage->key(index), mStorage->value(index));
+  qDebug() << Q_FUNC_INFO << "Index out of bounds" << index;
+  return {};
+}
+
+/* inherits documentation from base class */
+bool QCPSeriesGraph::sortKeyIsMainKey() const
+{
+  return true;
+}
+
+/* inherits documentation from base class */
+QCPDataSelection QCPSeriesGraph::selectTestRect(const QRectF &rect, bool onlySelectable) const
+{
+  QCPDataSelection result;
+  if ((onlySelectable && mSelectable == QCP::stNone) || dataCount() == 0)
+    return result;
+  if (!mKeyAxis || !mValueAxis)
+    return result;
+  
+  // convert rect given in pixels to ranges given in plot coordinates:
+  double key1, value1, key2, value2;
+  pixelsToCoords(rect.topLeft(), key1, value1);
+  pixelsToCoords(rect.bottomRight(), key2, value2);
+  QCPRange keyRange(key1, key2); // QCPRange normalizes internally so we don't have to care about whether key1 < key2
+  QCPRange valueRange(value1, value2);
+  const int begin = mStorage->findBegin(keyRange.lower, false);
+  const int end = mStorage->findEnd(keyRange.upper, false);
+  
+  int currentSegmentBegin = -1; // -1 means we're currently not in a segment that's contained in rect
+  double keys[QCPAbstractSeriesStorage::readBlockSize], values[QCPAbstractSeriesStorage::readBlockSize];
+  for (int blockBegin=begin; blockBegin<end; blockBegin+=QCPAbstractSeriesStorage::readBlockSize)
+  {
+    const int blockSize = qMin(int(QCPAbstractSeriesStorage::readBlockSize), end-blockBegin);
+    mStorage->read(blockBegin, blockBegin+blockSize, keys, values);
+    for (int i=0; i<blockSize; ++i)
+    {
+      const bool contained = valueRange.contains(values[i]) && keyRange.contains(keys[i]);
+      if (currentSegmentBegin == -1 && contained) // start segment
+        currentSegmentBegin = blockBegin+i;
+      else if (currentSegmentBegin != -1 && !contained) // segment just ended
+      {
+        result.addDataRange(QCPDataRange(currentSegmentBegin, blockBegin+i), false);
+        currentSegmentBegin = -1;
+      }
+    }
+  }
+  // process potential last segment:
+  if (currentSegmentBegin != -1)
+    result.addDataRange(QCPDataRange(currentSegmentBegin, end), false);
+  
+  result.simplify();
+  return result;
+}
+
+/* inherits documentation from base class */
+int QCPSeriesGraph::findBegin(double sortKey, bool expandedRange) const
+{
+  return mStorage ? mStorage->findBegin(sortKey, expandedRange) : 0;
+}
+
+/* inherits documentation from base class */
+int QCPSeriesGraph::findEnd(double sortKey, bool expandedRange) const
+{
+  return mStorage ? mStorage->findEnd(sortKey, expandedRange) : 0;
+}
+
+/*!
+  Implements a selectTest specific to this plottable's point geometry.
+
+  If \a details is not 0, it will be set to a \ref QCPDataSelection, describing the closest data
+  point to \a pos.
+  
+  \seebaseclassmethod \ref QCPAbstractPlottable::selectTest
+*/
+double QCPSeriesGraph::selectTest(const QPointF &pos, bool onlySelectable, QVariant *details) const
+{
+  if ((onlySelectable && mSelectable == QCP::stNone) || dataCount() == 0)
+    return -1;
+  if (!mKeyAxis || !mValueAxis)
+    return -1;
+  
+  if (mKeyAxis.data()->axisRect()->rect().contains(pos.toPoint()) || mParentPlot->interactions().testFlag(QCP::iSelectPlottablesBeyondAxisRect))
+  {
+    int closestDataPoint = -1;
+    double result = pointDistance(pos, closestDataPoint);
+    if (details && closestDataPoint >= 0)
+      details->setValue(QCPDataSelection(QCPDataRange(closestDataPoint, closestDataPoint+1)));
+    return result;
+  } else
+    return -1;
+}
+
+/* inherits documentation from base class */
+QCPRange QCPSeriesGraph::getKeyRange(bool &foundRange, QCP::SignDomain inSignDomain) const
+{
+  if (!mStorage)
+  {
+    foundRange = false;
+    return {};
+  }
+  return mStorage->keyRange(foundRange, inSignDomain);
+}
+
+/* inherits documentation from base class */
+QCPRange QCPSeriesGraph::getValueRange(bool &foundRange, QCP::SignDomain inSignDomain, const QCPRange &inKeyRange) const
+{
+  if (!mStorage)
+  {
+    foundRange = false;
+    return {};
+  }
+  return mStorage->valueRange(foundRange, inSignDomain, inKeyRange);
+}
+
+/* inherits documentation from base class */
+void QCPSeriesGraph::draw(QCPPainter *painter)
+{
+  if (!mKeyAxis || !mValueAxis) { qDebug() << Q_FUNC_INFO << "invalid key or value axis"; return; }
+  if (mKeyAxis.data()->range().size() <= 0 || dataCount() == 0) return;
+  
+  QVector<QPointF> lines;
+  QList<QCPDataRange> selectedSegments, unselectedSegments, allSegments;
+  getDataSegments(selectedSegments, unselectedSegments);
+  allSegments << unselectedSegments << selectedSegments;
+  for (int i=0; i<allSegments.size(); ++i)
+  {
+    bool isSelectedSegment = i >= unselectedSegments.size();
+    getLines(&lines, allSegments.at(i));
+    if (lines.isEmpty())
+      continue;
+    
+    // draw line:
+    if (isSelectedSegment && mSelectionDecorator)
+      mSelectionDecorator->applyPen(painter);
+    else
+      painter->setPen(mPen);
+    painter->setBrush(Qt::NoBrush);
+    if (painter->pen().style() != Qt::NoPen && painter->pen().color().alpha() != 0)
+    {
+      applyDefaultAntialiasingHint(painter);
+      drawLines(painter, lines);
+    }
+    
+    // draw scatters:
+    QCPScatterStyle finalScatterStyle = mScatterStyle;
+    if (isSelectedSegment && mSelectionDecorator)
+      finalScatterStyle = mSelectionDecorator->getFinalScatterStyle(mScatterStyle);
+    if (!finalScatterStyle.isNone())
+    {
+      applyScattersAntialiasingHint(painter);
+      finalScatterStyle.applyTo(painter, mPen);
+      foreach (const QPointF &point, lines)
+      {
+        if (!qIsNaN(point.x()) && !qIsNaN(point.y()))
+          finalScatterStyle.drawShape(painter, point.x(), point.y());
+      }
+    }
+  }
+  
+  // draw other selection decoration that isn't just line/scatter pens and brushes:
+  if (mSelectionDecorator)
+    mSelectionDecorator->drawDecoration(painter, selection());
+}
+
+/* inherits documentation from base class */
+void QCPSeriesGraph::drawLegendIcon(QCPPainter *painter, const QRectF &rect) const
+{
+  applyDefaultAntialiasingHint(painter);
+  painter->setPen(mPen);
+  painter->drawLine(QLineF(rect.left(), rect.y()+rect.height()/2.0, rect.right()+5, rect.y()+rect.height()/2.0)); // +5 on x2 else last segment is missing from dashed/dotted pens
+  if (!mScatterStyle.isNone())
+  {
+    applyScattersAntialiasingHint(painter);
+    // scale scatter pixmap if it's too large to fit in legend icon rect:
+    if (mScatterStyle.shape() == QCPScatterStyle::ssPixmap && (mScatterStyle.pixmap().size().width() > rect.width() || mScatterStyle.pixmap().size().height() > rect.height()))
+    {
+      QCPScatterStyle scaledStyle(mScatterStyle);
+      scaledStyle.setPixmap(scaledStyle.pixmap().scaled(rect.size().toSize(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
+      scaledStyle.applyTo(painter, mPen);
+      scaledStyle.drawShape(painter, QRectF(rect).center());
+    } else
+    {
+      mScatterStyle.applyTo(painter, mPen);
+      mScatterStyle.drawShape(painter, QRectF(rect).center());
+    }
+  }
+}
+
+/*! \internal
+
+  Fills \a lines with the pixel coordinates of the data points in \a dataRange that are needed to
+  draw the visible key range, including one point beyond each side. NaN values become NaN points,
+  which \ref drawLines turns into gaps.
+  
+  The storage is read in blocks. If there are many more points than the key axis has pixels, each
+  pixel column is reduced to its minimum and maximum value in the order they occur (see \ref
+  QCPColumnReducer), so the output stays proportional to the axis length rather than to the data.
+*/
+void QCPSeriesGraph::getLines(QVector<QPointF> *lines, const QCPDataRange &dataRange) const
+{
+  lines->clear();
+  QCPAxis *keyAxis = mKeyAxis.data();
+  QCPAxis *valueAxis = mValueAxis.data();
+  const int begin = qMax(dataRange.begin(), mStorage->findBegin(keyAxis->range().lower));
+  const int end = qMin(dataRange.end(), mStorage->findEnd(keyAxis->range().upper));
+  if (begin >= end)
+    return;
+  
+  const bool keyIsHorizontal = keyAxis->orientation() == Qt::Horizontal;
+  const int pixelLength = qMax(1, keyIsHorizontal ? keyAxis->axisRect()->width() : keyAxis->axisRect()->height());
+  const bool reduce = end-begin > 4*pixelLength;
+  lines->reserve(reduce ? 2*pixelLength+4 : end-begin);
+  QCPColumnReducer reducer(lines, keyIsHorizontal);
+  
+  double keys[QCPAbstractSeriesStorage::readBlockSize], values[QCPAbstractSeriesStorage::readBlockSize];
+  for (int blockBegin=begin; blockBegin<end; blockBegin+=QCPAbstractSeriesStorage::readBlockSize)
+  {
+    const int blockSize = qMin(int(QCPAbstractSeriesStorage::readBlockSize), end-blockBegin);
+    mStorage->read(blockBegin, blockBegin+blockSize, keys, values);
+    for (int i=0; i<blockSize; ++i)
+    {
+      const double keyPixel = keyAxis->coordToPixel(keys[i]);
+      const double valuePixel = qIsNaN(values[i]) ? qQNaN() : valueAxis->coordToPixel(values[i]);
+      if (reduce)
+        reducer.addPoint(keyPixel, valuePixel);
+      else
+        lines->append(keyIsHorizontal ? QPointF(keyPixel, valuePixel) : QPointF(valuePixel, keyPixel));
+    }
+  }
+  if (reduce)
+    reducer.finish();
+}
+
+/*! \internal
+
+  Draws the polyline \a lines with the painter's current pen, leaving gaps at NaN points.
+*/
+void QCPSeriesGraph::drawLines(QCPPainter *painter, const QVector<QPointF> &lines) const
+{
+  const QPointF *points = lines.constData();
+  const int count = lines.size();
+  int segmentStart = 0;
+  for (int i=0; i<=count; ++i)
+  {
+    if (i == count || qIsNaN(points[i].x()) || qIsNaN(points[i].y()) || qIsInf(points[i].y())) // Infs would make drawPolyline block
+    {
+      if (i-segmentStart > 1)
+        painter->drawPolyline(points+segmentStart, i-segmentStart);
+      segmentStart = i+1;
+    }
+  }
+}
+
+/*! \internal
+
+  Splits all data into selected and unselected segments, like \ref
+  QCPAbstractPlottable1D::getDataSegments.
+*/
+void QCPSeriesGraph::getDataSegments(QList<QCPDataRange> &selectedSegments, QList<QCPDataRange> &unselectedSegments) const
+{
+  selectedSegments.clear();
+  unselectedSegments.clear();
+  if (mSelectable == QCP::stWhole) // stWhole selection type draws the entire plottable with selected style if mSelection isn't empty
+  {
+    if (selected())
+      selectedSegments << QCPDataRange(0, dataCount());
+    else
+      unselectedSegments << QCPDataRange(0, dataCount());
+  } else
+  {
+    QCPDataSelection sel(selection());
+    sel.simplify();
+    selectedSegments = sel.dataRanges();
+    unselectedSegments = sel.inverse(QCPDataRange(0, dataCount())).dataRanges();
+  }
+}
+
+/*! \internal
+
+  Returns the pixel distance of \a pixelPoint to the graph's line and data points near it, and
+  sets \a closestData to the index of the closest data point (or -1 if there is none).
+  
+  Only the points within the selection tolerance around \a pixelPoint (plus one beyond each side)
+  are read from the storage.
+*/
+double QCPSeriesGraph::pointDistance(const QPointF &pixelPoint, int &closestData) const
+{
+  closestData = -1;
+  if (dataCount() == 0)
+    return -1.0;
+  
+  // determine which key range comes into question, taking selection tolerance around pos into account:
+  double posKeyMin, posKeyMax, dummy;
+  pixelsToCoords(pixelPoint-QPointF(mParentPlot->selectionTolerance(), mParentPlot->selectionTolerance()), posKeyMin, dummy);
+  pixelsToCoords(pixelPoint+QPointF(mParentPlot->selectionTolerance(), mParentPlot->selectionTolerance()), posKeyMax, dummy);
+  if (posKeyMin > posKeyMax)
+    qSwap(posKeyMin, posKeyMax);
+  const int begin = mStorage->findBegin(posKeyMin, true);
+  const int end = mStorage->findEnd(posKeyMax, true);
+  
+  double minDistSqr = (std::numeric_limits<double>::max)();
+  const QCPVector2D pos(pixelPoint);
+  bool havePrevious = false;
+  QPointF previous;
+  double keys[QCPAbstractSeriesStorage::readBlockSize], values[QCPAbstractSeriesStorage::readBlockSize];
+  for (int blockBegin=begin; blockBegin<end; blockBegin+=QCPAbstractSeriesStorage::readBlockSize)
+  {
+    const int blockSize = qMin(int(QCPAbstractSeriesStorage::readBlockSize), end-blockBegin);
+    mStorage->read(blockBegin, blockBegin+blockSize, keys, values);
+    for (int i=0; i<blockSize; ++i)
+    {
+      if (qIsNaN(values[i]))
+      {
+        havePrevious = false;
+        continue;
+      }
+      const QPointF current = coordsToPixels(keys[i], values[i]);
+      const double currentDistSqr = (QCPVector2D(current)-pos).lengthSquared();
+      if (currentDistSqr < minDistSqr)
+      {
+        minDistSqr = currentDistSqr;
+        closestData = blockBegin+i;
+      }
+      if (havePrevious && mPen.style() != Qt::NoPen) // line segments may pass closer than their end points
+        minDistSqr = qMin(minDistSqr, pos.distanceSquaredToLine(previous, current));
+      previous = current;
+      havePrevious = true;
+    }
+  }
+  return closestData >= 0 ? qSqrt(minDistSqr) : -1.0;
+}
+/* end of 'src/plottables/plottable-seriesgraph.cpp' */
+
+
 /* including file 'src/items/item-straightline.cpp' */
 /* modified 2022-11-06T12:45:56, size 7596          */
 
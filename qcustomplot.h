@@ -509,6 +509,73 @@ inline QDebug operator<< (QDebug d, const QCPVector2D &vec)
 /* end of 'src/vector2d.h' */
 
 
+/* including file 'src/pixelgrid.h' */
+
+class QCP_LIB_DECL QCPPixelGrid
+{
+public:
+  QCPPixelGrid();
+  
+  // getters:
+  QRect bounds() const { return mBounds; }
+  int cellSize() const { return mCellSize; }
+  bool isEmpty() const { return mItems.isEmpty(); }
+  
+  // non-virtual methods:
+  void setPoints(const QVector<QPointF> &points, const QRect &bounds, int cellSize=8);
+  void setSegments(const QVector<QPointF> &lines, int step, const QRect &bounds, int cellSize=8);
+  void clear();
+  int nearest(const QPointF &pos, double &distance) const;
+  QVector<int> pointsIn(const QRectF &rect) const;
+  
+protected:
+  // non-property members:
+  QRect mBounds;
+  int mCellSize;
+  int mColumns, mRows;
+  int mStep; // 0 if the items are points, else the step between the first points of consecutive segments
+  QVector<QPointF> mPoints;
+  QVector<int> mCellStart; // items of cell c are mItems[mCellStart[c]] to mItems[mCellStart[c+1]-1]
+  QVector<int> mItems;
+  
+  // non-virtual methods:
+  int column(double x) const { return int(qBound(0.0, (x-mBounds.left())/mCellSize, double(mColumns-1))); }
+  int row(double y) const { return int(qBound(0.0, (y-mBounds.top())/mCellSize, double(mRows-1))); }
+  void setupCells(const QRect &bounds, int cellSize);
+  double itemDistanceSquared(int item, const QPointF &pos) const;
+};
+
+/* end of 'src/pixelgrid.h' */
+
+
+/* including file 'src/columnreducer.h' */
+
+class QCP_LIB_DECL QCPColumnReducer
+{
+public:
+  QCPColumnReducer(QVector<QPointF> *lines, bool keyIsHorizontal);
+  
+  // non-virtual methods:
+  void addPoint(double keyPixel, double valuePixel);
+  void finish();
+  
+protected:
+  // non-property members:
+  QVector<QPointF> *mLines;
+  bool mKeyIsHorizontal;
+  int mColumn; // pixel column being collected, or INT_MIN if none
+  double mColumnKey, mMinValue, mMaxValue;
+  bool mMinFirst; // whether the minimum occurred before the maximum in the current column
+  bool mGap; // whether the last point added was a NaN
+  
+  // non-virtual methods:
+  void append(double keyPixel, double valuePixel) { mLines->append(mKeyIsHorizontal ? QPointF(keyPixel, valuePixel) : QPointF(valuePixel, keyPixel)); }
+  void closeColumn();
+};
+
+/* end of 'src/columnreducer.h' */
+
+
 /* including file 'src/painter.h'          */
 /* modified 2022-11-06T12:45:56, size 4035 */
 
@@ -2622,9 +2689,12 @@ public:
   int size() const { return mData.size()-mPreallocSize; }
   bool isEmpty() const { return size() == 0; }
   bool autoSqueeze() const { return mAutoSqueeze; }
+  bool valueRangeIndex() const { return mValueRangeIndex; }
+  quint64 revision() const { return mRevision; }
   
   // setters:
   void setAutoSqueeze(bool enabled);
+  void setValueRangeIndex(bool enabled);
   
   // non-virtual methods:
   void set(const QCPDataContainer<DataType> &data);
@@ -2642,8 +2712,8 @@ public:
   
   const_iterator constBegin() const { return mData.constBegin()+mPreallocSize; }
   const_iterator constEnd() const { return mData.constEnd(); }
-  iterator begin() { return mData.begin()+mPreallocSize; }
-  iterator end() { return mData.end(); }
+  iterator begin() { ++mRevision; return mData.begin()+mPreallocSize; }
+  iterator end() { ++mRevision; return mData.end(); }
   const_iterator findBegin(double sortKey, bool expandedRange=true) const;
   const_iterator findEnd(double sortKey, bool expandedRange=true) const;
   const_iterator at(int index) const { return constBegin()+qBound(0, index, size()); }
@@ -2655,15 +2725,27 @@ public:
 protected:
   // property members:
   bool mAutoSqueeze;
+  bool mValueRangeIndex;
   
   // non-property memebers:
   QVector<DataType> mData;
   int mPreallocSize;
   int mPreallocIteration;
+  quint64 mRevision;
+  QVector<QCPRange> mValueIndexTree; // segment tree over blocks of mData, leaves at [mValueIndexCapacity, 2*mValueIndexCapacity)
+  int mValueIndexCapacity;
+  int mValueIndexLeaves; // leaves up to date with mData as of the last updateValueRangeIndex
+  int mValueIndexDirtyBegin, mValueIndexDirtyEnd; // indices into mData whose blocks need updating
   
   // non-virtual methods:
   void preallocateGrow(int minimumPreallocSize);
   void performAutoSqueeze();
+  void markValueRangeIndex(int begin, int end=(std::numeric_limits<int>::max)());
+  void updateValueRangeIndex();
+  QCPRange valueIndexBlockRange(int block) const;
+  static void expandValueIndexRange(QCPRange &range, const QCPRange &other);
+  
+  static const int valueIndexBlockSize = 32;
 };
 
 
@@ -2706,6 +2788,10 @@ protected:
   done by subclassing from \ref QCPAbstractPlottable1D "QCPAbstractPlottable1D<T>", which
   introduces an according \a mDataContainer member and some convenience methods.
 
+  For large data sets whose value axis is rescaled often (e.g. to the visible key range while
+  panning), \ref setValueRangeIndex enables an index that lets \ref valueRange answer in
+  logarithmic instead of linear time.
+
   \section qcpdatacontainer-datatype Requirements for the DataType template parameter
 
   The template parameter <tt>DataType</tt> is the type of the stored data points. It must be
@@ -2768,7 +2854,8 @@ protected:
 
   You can manipulate the data points in-place through the non-const iterators, but great care must
   be taken when manipulating the sort key of a data point, see \ref sort, or the detailed
-  description of this class.
+  description of this class. Since the data may be changed through it, this counts as a
+  modification for \ref revision.
 */
 
 /*! \fn QCPDataContainer::iterator QCPDataContainer<DataType>::end() const
@@ -2777,7 +2864,15 @@ protected:
   
   You can manipulate the data points in-place through the non-const iterators, but great care must
   be taken when manipulating the sort key of a data point, see \ref sort, or the detailed
-  description of this class.
+  description of this class. Since the data may be changed through it, this counts as a
+  modification for \ref revision.
+*/
+
+/*! \fn quint64 QCPDataContainer<DataType>::revision() const
+  
+  Returns a number that changes whenever the data in this container may have changed, i.e. on
+  every call of a modifying method or of the non-const iterator accessors \ref begin and \ref end.
+  Plottables use it to tell whether results they cached from the data are still current.
 */
 
 /*! \fn QCPDataContainer::const_iterator QCPDataContainer<DataType>::at(int index) const
@@ -2805,8 +2900,14 @@ protected:
 template <class DataType>
 QCPDataContainer<DataType>::QCPDataContainer() :
   mAutoSqueeze(true),
+  mValueRangeIndex(false),
   mPreallocSize(0),
-  mPreallocIteration(0)
+  mPreallocIteration(0),
+  mRevision(0),
+  mValueIndexCapacity(0),
+  mValueIndexLeaves(0),
+  mValueIndexDirtyBegin((std::numeric_limits<int>::max)()),
+  mValueIndexDirtyEnd(0)
 {
 }
 
@@ -2829,6 +2930,38 @@ void QCPDataContainer<DataType>::setAutoSqueeze(bool enabled)
   }
 }
 
+/*!
+  Sets whether the container maintains an index of the value ranges of its data points, which
+  makes \ref valueRange take O(log n) instead of O(n) time for a key range spanning n data points.
+  This speeds up rescaling the value axis to the visible key range (\ref
+  QCPAbstractPlottable::rescaleValueAxis with \a inKeyRange set) for large data sets.
+  
+  The index holds the value range of each block of 32 data points in a segment tree, at most about 2
+  bytes per data point for single valued data types. It is updated lazily in the next \ref valueRange
+  call, and only for the blocks that changed, so appending data points costs amortized constant
+  time. It is only used for data types whose sort key is the main key and for the sign domain \ref
+  QCP::sdBoth; other queries scan the data as before.
+  
+  If you modify the values of data points in-place through the non-const iterators (\ref begin,
+  \ref end), call \ref setValueRangeIndex(false) and re-enable it afterwards, so the index is
+  rebuilt. By default the index is disabled.
+*/
+template <class DataType>
+void QCPDataContainer<DataType>::setValueRangeIndex(bool enabled)
+{
+  if (mValueRangeIndex != enabled)
+  {
+    mValueRangeIndex = enabled;
+    mValueIndexTree.clear();
+    mValueIndexCapacity = 0;
+    mValueIndexLeaves = 0;
+    mValueIndexDirtyBegin = (std::numeric_limits<int>::max)();
+    mValueIndexDirtyEnd = 0;
+    if (mValueRangeIndex)
+      markValueRangeIndex(0);
+  }
+}
+
 /*! \overload
   
   Replaces the current data in this container with the provided \a data.
@@ -2857,6 +2990,8 @@ void QCPDataContainer<DataType>::set(const QVector<DataType> &data, bool already
   mData = data;
   mPreallocSize = 0;
   mPreallocIteration = 0;
+  ++mRevision;
+  markValueRangeIndex(0);
   if (!alreadySorted)
     sort();
 }
@@ -2882,12 +3017,17 @@ void QCPDataContainer<DataType>::add(const QCPDataContainer<DataType> &data)
       preallocateGrow(n);
     mPreallocSize -= n;
     std::copy(data.constBegin(), data.constEnd(), begin());
+    markValueRangeIndex(mPreallocSize, mPreallocSize+n);
   } else // don't need to prepend, so append and merge if necessary
   {
     mData.resize(mData.size()+n);
     std::copy(data.constBegin(), data.constEnd(), end()-n);
+    markValueRangeIndex(mData.size()-n);
     if (oldSize > 0 && !qcpLessThanSortKey<DataType>(*(constEnd()-n-1), *(constEnd()-n))) // if appended range keys aren't all greater than existing ones, merge the two partitions
+    {
       std::inplace_merge(begin(), end()-n, end(), qcpLessThanSortKey<DataType>);
+      markValueRangeIndex(mPreallocSize);
+    }
   }
 }
 
@@ -2919,14 +3059,19 @@ void QCPDataContainer<DataType>::add(const QVector<DataType> &data, bool already
       preallocateGrow(n);
     mPreallocSize -= n;
     std::copy(data.constBegin(), data.constEnd(), begin());
+    markValueRangeIndex(mPreallocSize, mPreallocSize+n);
   } else // don't need to prepend, so append and then sort and merge if necessary
   {
     mData.resize(mData.size()+n);
     std::copy(data.constBegin(), data.constEnd(), end()-n);
+    markValueRangeIndex(mData.size()-n);
     if (!alreadySorted) // sort appended subrange if it wasn't already sorted
       std::sort(end()-n, end(), qcpLessThanSortKey<DataType>);
     if (oldSize > 0 && !qcpLessThanSortKey<DataType>(*(constEnd()-n-1), *(constEnd()-n))) // if appended range keys aren't all greater than existing ones, merge the two partitions
+    {
       std::inplace_merge(begin(), end()-n, end(), qcpLessThanSortKey<DataType>);
+      markValueRangeIndex(mPreallocSize);
+    }
   }
 }
 
@@ -2942,15 +3087,19 @@ void QCPDataContainer<DataType>::add(const DataType &data)
   if (isEmpty() || !qcpLessThanSortKey<DataType>(data, *(constEnd()-1))) // quickly handle appends if new data key is greater or equal to existing ones
   {
     mData.append(data);
+    ++mRevision;
+    markValueRangeIndex(mData.size()-1);
   } else if (qcpLessThanSortKey<DataType>(data, *constBegin()))  // quickly handle prepends using preallocated space
   {
     if (mPreallocSize < 1)
       preallocateGrow(1);
     --mPreallocSize;
     *begin() = data;
+    markValueRangeIndex(mPreallocSize, mPreallocSize+1);
   } else // handle inserts, maintaining sorted keys
   {
     QCPDataContainer<DataType>::iterator insertionPoint = std::lower_bound(begin(), end(), data, qcpLessThanSortKey<DataType>);
+    markValueRangeIndex(int(insertionPoint-mData.begin()));
     mData.insert(insertionPoint, data);
   }
 }
@@ -2980,6 +3129,7 @@ void QCPDataContainer<DataType>::removeAfter(double sortKey)
 {
   QCPDataContainer<DataType>::iterator it = std::upper_bound(begin(), end(), DataType::fromSortKey(sortKey), qcpLessThanSortKey<DataType>);
   QCPDataContainer<DataType>::iterator itEnd = end();
+  markValueRangeIndex(int(it-mData.begin()));
   mData.erase(it, itEnd); // typically adds it to the postallocated block
   if (mAutoSqueeze)
     performAutoSqueeze();
@@ -3000,6 +3150,7 @@ void QCPDataContainer<DataType>::remove(double sortKeyFrom, double sortKeyTo)
   
   QCPDataContainer<DataType>::iterator it = std::lower_bound(begin(), end(), DataType::fromSortKey(sortKeyFrom), qcpLessThanSortKey<DataType>);
   QCPDataContainer<DataType>::iterator itEnd = std::upper_bound(it, end(), DataType::fromSortKey(sortKeyTo), qcpLessThanSortKey<DataType>);
+  markValueRangeIndex(int(it-mData.begin()));
   mData.erase(it, itEnd);
   if (mAutoSqueeze)
     performAutoSqueeze();
@@ -3023,7 +3174,10 @@ void QCPDataContainer<DataType>::remove(double sortKey)
     if (it == begin())
       ++mPreallocSize; // don't actually delete, just add it to the preallocated block (if it gets too large, squeeze will take care of it)
     else
+    {
+      markValueRangeIndex(int(it-mData.begin()));
       mData.erase(it);
+    }
   }
   if (mAutoSqueeze)
     performAutoSqueeze();
@@ -3040,6 +3194,8 @@ void QCPDataContainer<DataType>::clear()
   mData.clear();
   mPreallocIteration = 0;
   mPreallocSize = 0;
+  ++mRevision;
+  markValueRangeIndex(0);
 }
 
 /*!
@@ -3057,6 +3213,7 @@ template <class DataType>
 void QCPDataContainer<DataType>::sort()
 {
   std::sort(begin(), end(), qcpLessThanSortKey<DataType>);
+  markValueRangeIndex(mPreallocSize);
 }
 
 /*!
@@ -3079,6 +3236,7 @@ void QCPDataContainer<DataType>::squeeze(bool preAllocation, bool postAllocation
       std::copy(begin(), end(), mData.begin());
       mData.resize(size());
       mPreallocSize = 0;
+      markValueRangeIndex(0);
     }
     mPreallocIteration = 0;
   }
@@ -3300,6 +3458,34 @@ QCPRange QCPDataContainer<DataType>::valueRange(bool &foundRange, QCP::SignDomai
     itBegin = findBegin(inKeyRange.lower, false);
     itEnd = findEnd(inKeyRange.upper, false);
   }
+  if (mValueRangeIndex && signDomain == QCP::sdBoth && DataType::sortKeyIsMainKey())
+  {
+    // blocks entirely inside the range come from the index, the partial blocks at the edges are scanned:
+    updateValueRangeIndex();
+    const int first = int(itBegin-mData.constBegin());
+    const int last = int(itEnd-mData.constBegin());
+    int firstBlock = (first+valueIndexBlockSize-1)/valueIndexBlockSize;
+    int lastBlock = last/valueIndexBlockSize;
+    if (firstBlock >= lastBlock) // no complete block in range, scan it all
+      firstBlock = lastBlock = 0;
+    range.lower = std::numeric_limits<double>::infinity();
+    range.upper = -std::numeric_limits<double>::infinity();
+    const QCPDataContainer<DataType>::const_iterator headEnd = firstBlock < lastBlock ? mData.constBegin()+firstBlock*valueIndexBlockSize : itEnd;
+    const QCPDataContainer<DataType>::const_iterator tailBegin = firstBlock < lastBlock ? mData.constBegin()+lastBlock*valueIndexBlockSize : itEnd;
+    for (QCPDataContainer<DataType>::const_iterator it = itBegin; it != headEnd; ++it)
+      expandValueIndexRange(range, it->valueRange());
+    for (QCPDataContainer<DataType>::const_iterator it = tailBegin; it != itEnd; ++it)
+      expandValueIndexRange(range, it->valueRange());
+    for (int l=firstBlock+mValueIndexCapacity, r=lastBlock+mValueIndexCapacity; l < r; l >>= 1, r >>= 1)
+    {
+      if (l & 1)
+        expandValueIndexRange(range, mValueIndexTree.at(l++));
+      if (r & 1)
+        expandValueIndexRange(range, mValueIndexTree.at(--r));
+    }
+    foundRange = range.lower != std::numeric_limits<double>::infinity() && range.upper != -std::numeric_limits<double>::infinity();
+    return range;
+  }
   if (signDomain == QCP::sdBoth) // range may be anywhere
   {
     for (QCPDataContainer<DataType>::const_iterator it = itBegin; it != itEnd; ++it)
@@ -3400,6 +3586,7 @@ void QCPDataContainer<DataType>::preallocateGrow(int minimumPreallocSize)
   mData.resize(mData.size()+sizeDifference);
   std::copy_backward(mData.begin()+mPreallocSize, mData.end()-sizeDifference, mData.end());
   mPreallocSize = newPreallocSize;
+  markValueRangeIndex(0);
 }
 
 /*! \internal
@@ -3438,6 +3625,109 @@ void QCPDataContainer<DataType>::performAutoSqueeze()
     squeeze(shrinkPreAllocation, shrinkPostAllocation);
 }
 
+/*! \internal
+  
+  Records that the data points at the indices [\a begin, \a end) of \ref mData changed, so the
+  blocks containing them are updated by the next \ref updateValueRangeIndex. Indices shift with
+  inserts and erases in the middle, so these pass \a end unbounded.
+*/
+template <class DataType>
+void QCPDataContainer<DataType>::markValueRangeIndex(int begin, int end)
+{
+  if (!mValueRangeIndex)
+    return;
+  mValueIndexDirtyBegin = qMin(mValueIndexDirtyBegin, begin);
+  mValueIndexDirtyEnd = qMax(mValueIndexDirtyEnd, end);
+}
+
+/*! \internal
+  
+  Brings the value range index up to date with \ref mData: recomputes the leaves of the changed
+  blocks and their ancestors. The leaves address blocks of \ref mData including the preallocation
+  pool, so removing data at the front doesn't move anything in the index; the stale blocks there
+  are never fully inside a queried range and thus never read.
+*/
+template <class DataType>
+void QCPDataContainer<DataType>::updateValueRangeIndex()
+{
+  const int leaves = (mData.size()+valueIndexBlockSize-1)/valueIndexBlockSize;
+  if (mValueIndexDirtyBegin >= mValueIndexDirtyEnd && leaves == mValueIndexLeaves)
+    return;
+  QCPRange empty;
+  empty.lower = std::numeric_limits<double>::infinity();
+  empty.upper = -std::numeric_limits<double>::infinity();
+  
+  // grow the tree by doubling, so appending data rebuilds it only log(n) times:
+  if (leaves > mValueIndexCapacity)
+  {
+    int capacity = qMax(16, mValueIndexCapacity);
+    while (capacity < leaves)
+      capacity *= 2;
+    QVector<QCPRange> tree(2*capacity, empty);
+    for (int leaf=0; leaf<mValueIndexLeaves; ++leaf)
+      tree[capacity+leaf] = mValueIndexTree.at(mValueIndexCapacity+leaf);
+    for (int node=capacity-1; node>0; --node)
+    {
+      tree[node] = tree.at(2*node);
+      expandValueIndexRange(tree[node], tree.at(2*node+1));
+    }
+    mValueIndexTree = tree;
+    mValueIndexCapacity = capacity;
+  }
+  
+  // leaves to recompute: the dirty blocks, blocks that were added, and blocks that were removed:
+  int firstLeaf = qMin(mValueIndexDirtyBegin/valueIndexBlockSize, qMin(leaves, mValueIndexLeaves));
+  int lastLeaf = qMax(leaves, mValueIndexLeaves); // exclusive
+  if (mValueIndexDirtyEnd < (std::numeric_limits<int>::max)() && leaves == mValueIndexLeaves)
+    lastLeaf = qMin(lastLeaf, (mValueIndexDirtyEnd+valueIndexBlockSize-1)/valueIndexBlockSize);
+  for (int leaf=firstLeaf; leaf<lastLeaf; ++leaf)
+    mValueIndexTree[mValueIndexCapacity+leaf] = leaf < leaves ? valueIndexBlockRange(leaf) : empty;
+  for (int lower=(firstLeaf+mValueIndexCapacity)/2, upper=(lastLeaf-1+mValueIndexCapacity)/2; lower > 0 && firstLeaf < lastLeaf; lower /= 2, upper /= 2)
+  {
+    for (int node=lower; node<=upper; ++node)
+    {
+      mValueIndexTree[node] = mValueIndexTree.at(2*node);
+      expandValueIndexRange(mValueIndexTree[node], mValueIndexTree.at(2*node+1));
+    }
+  }
+  
+  mValueIndexLeaves = leaves;
+  mValueIndexDirtyBegin = (std::numeric_limits<int>::max)();
+  mValueIndexDirtyEnd = 0;
+}
+
+/*! \internal
+  
+  Returns the range spanned by the finite value bounds of the data points in \a block of \ref
+  mData. If there are none, lower is infinity and upper is minus infinity.
+*/
+template <class DataType>
+QCPRange QCPDataContainer<DataType>::valueIndexBlockRange(int block) const
+{
+  QCPRange range;
+  range.lower = std::numeric_limits<double>::infinity();
+  range.upper = -std::numeric_limits<double>::infinity();
+  const int end = qMin(mData.size(), (block+1)*valueIndexBlockSize);
+  for (int i=block*valueIndexBlockSize; i<end; ++i)
+    expandValueIndexRange(range, mData.at(i).valueRange());
+  return range;
+}
+
+/*! \internal
+  
+  Expands \a range by the bounds of \a other that are finite. Unlike \ref QCPRange::expand, this
+  treats an empty range (lower infinity, upper minus infinity) as neutral and ignores NaN and
+  infinite bounds, like the scanning paths of \ref valueRange.
+*/
+template <class DataType>
+void QCPDataContainer<DataType>::expandValueIndexRange(QCPRange &range, const QCPRange &other)
+{
+  if (other.lower < range.lower && std::isfinite(other.lower))
+    range.lower = other.lower;
+  if (other.upper > range.upper && std::isfinite(other.upper))
+    range.upper = other.upper;
+}
+
 
 /* end of 'src/datacontainer.h' */
 
@@ -4841,6 +5131,7 @@ protected:
   // non-virtual methods:
   bool stopsUseAlpha() const;
   void updateColorBuffer();
+  int colorizeVectorized(const double *data, const QCPRange &range, QRgb *scanLine, int n, int dataIndexFactor, bool logarithmic, double posToIndexFactor);
 };
 Q_DECLARE_METATYPE(QCPColorGradient::ColorInterpolation)
 Q_DECLARE_METATYPE(QCPColorGradient::NanHandling)
@@ -5500,6 +5791,7 @@ class QCP_LIB_DECL QCPGraph : public QCPAbstractPlottable1D<QCPGraphData>
   Q_PROPERTY(int scatterSkip READ scatterSkip WRITE setScatterSkip)
   Q_PROPERTY(QCPGraph* channelFillGraph READ channelFillGraph WRITE setChannelFillGraph)
   Q_PROPERTY(bool adaptiveSampling READ adaptiveSampling WRITE setAdaptiveSampling)
+  Q_PROPERTY(bool spatialIndex READ spatialIndex WRITE setSpatialIndex)
   /// \endcond
 public:
   /*!
@@ -5527,6 +5819,7 @@ public:
   int scatterSkip() const { return mScatterSkip; }
   QCPGraph *channelFillGraph() const { return mChannelFillGraph.data(); }
   bool adaptiveSampling() const { return mAdaptiveSampling; }
+  bool spatialIndex() const { return mSpatialIndex; }
   
   // setters:
   void setData(QSharedPointer<QCPGraphDataContainer> data);
@@ -5536,12 +5829,14 @@ public:
   void setScatterSkip(int skip);
   void setChannelFillGraph(QCPGraph *targetGraph);
   void setAdaptiveSampling(bool enabled);
+  void setSpatialIndex(bool enabled);
   
   // non-property methods:
   void addData(const QVector<double> &keys, const QVector<double> &values, bool alreadySorted=false);
   void addData(double key, double value);
   
   // reimplemented virtual methods:
+  virtual QCPDataSelection selectTestRect(const QRectF &rect, bool onlySelectable) const Q_DECL_OVERRIDE;
   virtual double selectTest(const QPointF &pos, bool onlySelectable, QVariant *details=nullptr) const Q_DECL_OVERRIDE;
   virtual QCPRange getKeyRange(bool &foundRange, QCP::SignDomain inSignDomain=QCP::sdBoth) const Q_DECL_OVERRIDE;
   virtual QCPRange getValueRange(bool &foundRange, QCP::SignDomain inSignDomain=QCP::sdBoth, const QCPRange &inKeyRange=QCPRange()) const Q_DECL_OVERRIDE;
@@ -5553,6 +5848,15 @@ protected:
   int mScatterSkip;
   QPointer<QCPGraph> mChannelFillGraph;
   bool mAdaptiveSampling;
+  bool mSpatialIndex;
+  
+  // non-property members:
+  mutable QCPPixelGrid mPointGrid, mLineGrid;
+  mutable int mPointGridOffset; // data index of the first point in mPointGrid
+  mutable bool mSpatialIndexValid;
+  mutable quint64 mSpatialIndexRevision;
+  mutable QCPRange mSpatialIndexKeyRange, mSpatialIndexValueRange;
+  mutable QPointF mSpatialIndexOrigin, mSpatialIndexCenter; // pixel positions of range origin and center, change with axis rect, scale type and direction
   
   // reimplemented virtual methods:
   virtual void draw(QCPPainter *painter) Q_DECL_OVERRIDE;
@@ -5587,6 +5891,7 @@ protected:
   int findIndexBelowY(const QVector<QPointF> *data, double y) const;
   int findIndexAboveY(const QVector<QPointF> *data, double y) const;
   double pointDistance(const QPointF &pixelPoint, QCPGraphDataContainer::const_iterator &closestData) const;
+  bool updateSpatialIndex() const;
   
   friend class QCustomPlot;
   friend class QCPLegend;
@@ -5879,6 +6184,11 @@ protected:
   double mStackingGap;
   QPointer<QCPBars> mBarBelow, mBarAbove;
   
+  // non-property members:
+  mutable QVector<double> mStackedBasePositive, mStackedBaseNegative; // stacked base value at each data point, see updateStackedBase
+  mutable QVector<quint64> mStackedBaseRevisions; // data revisions of this bars and the ones below it the table was built from
+  mutable bool mStackedBaseValid;
+  
   // reimplemented virtual methods:
   virtual void draw(QCPPainter *painter) Q_DECL_OVERRIDE;
   virtual void drawLegendIcon(QCPPainter *painter, const QRectF &rect) const Q_DECL_OVERRIDE;
@@ -5886,8 +6196,12 @@ protected:
   // non-virtual methods:
   void getVisibleDataBounds(QCPBarsDataContainer::const_iterator &begin, QCPBarsDataContainer::const_iterator &end) const;
   QRectF getBarRect(double key, double value) const;
+  QRectF getBarRect(double key, double value, double base) const;
   void getPixelWidth(double key, double &lower, double &upper) const;
   double getStackedBaseValue(double key, bool positive) const;
+  double stackedBaseValue(QCPBarsDataContainer::const_iterator it) const;
+  void updateStackedBase() const;
+  void invalidateStackedBase();
   static void connectBars(QCPBars* lower, QCPBars* upper);
   
   friend class QCustomPlot;
@@ -6046,9 +6360,12 @@ public:
   void setValueRange(const QCPRange &valueRange);
   void setData(double key, double value, double z);
   void setCell(int keyIndex, int valueIndex, double z);
+  void setColumn(int keyIndex, const double *values);
   void setAlpha(int keyIndex, int valueIndex, unsigned char alpha);
   
   // non-property methods:
+  void scrollKeys(int cells, bool shiftKeyRange=true);
+  void appendColumn(const double *values, bool shiftKeyRange=true);
   void recalculateDataBounds();
   void clear();
   void clearAlpha();
@@ -6069,8 +6386,12 @@ protected:
   unsigned char *mAlpha;
   QCPRange mDataBounds;
   bool mDataModified;
+  QVector<double> mColumnMinimum, mColumnMaximum; // data bounds of each key index (column)
+  QVector<bool> mColumnBoundsDirty; // true if a column's bounds may be wider than its data, after a bounding cell was overwritten
   
   bool createAlpha(bool initializeOpaque=true);
+  void updateColumnBounds(int keyIndex, double oldZ, double z);
+  void recalculateColumnBounds(int keyIndex);
   
   friend class QCPColorMap;
 };
@@ -6416,6 +6737,333 @@ protected:
 /* end of 'src/plottables/plottable-errorbar.h' */
 
 
+/* including file 'src/plottables/plottable-multigraph.h' */
+
+class QCP_LIB_DECL QCPMultiGraph : public QCPAbstractPlottable
+{
+  Q_OBJECT
+public:
+  explicit QCPMultiGraph(QCPAxis *keyAxis, QCPAxis *valueAxis);
+  virtual ~QCPMultiGraph() Q_DECL_OVERRIDE;
+  
+  // getters:
+  int seriesCount() const { return mOffsets.size()-1; }
+  int seriesSize(int series) const { return mOffsets.at(series+1)-mOffsets.at(series); }
+  const double *seriesKeys(int series) const { return mKeys.constData()+mOffsets.at(series); }
+  const double *seriesValues(int series) const { return mValues.constData()+mOffsets.at(series); }
+  int seriesGroup(int series) const { return mGroups.at(series); }
+  QPen groupPen(int group) const;
+  
+  // setters:
+  void setGroupPen(int group, const QPen &pen);
+  void setSeriesGroup(int series, int group);
+  
+  // non-property methods:
+  void reserve(int series, int points);
+  int addSeries(const double *keys, const double *values, int count, int group=0);
+  int addSeries(const QVector<double> &keys, const QVector<double> &values, int group=0);
+  void clearData();
+  int seriesAt(const QPointF &pixelPos, double *distance=nullptr) const;
+  
+  // reimplemented virtual methods:
+  virtual double selectTest(const QPointF &pos, bool onlySelectable, QVariant *details=nullptr) const Q_DECL_OVERRIDE;
+  virtual QCPRange getKeyRange(bool &foundRange, QCP::SignDomain inSignDomain=QCP::sdBoth) const Q_DECL_OVERRIDE;
+  virtual QCPRange getValueRange(bool &foundRange, QCP::SignDomain inSignDomain=QCP::sdBoth, const QCPRange &inKeyRange=QCPRange()) const Q_DECL_OVERRIDE;
+  
+protected:
+  // property members:
+  QVector<double> mKeys, mValues; // all series back to back
+  QVector<int> mOffsets; // series i occupies [mOffsets[i], mOffsets[i+1]) of mKeys/mValues
+  QVector<int> mGroups;
+  QVector<QCPRange> mKeyBounds, mValueBounds; // per series, NaN-free
+  QVector<QPen> mGroupPens;
+  
+  // reimplemented virtual methods:
+  virtual void draw(QCPPainter *painter) Q_DECL_OVERRIDE;
+  virtual void drawLegendIcon(QCPPainter *painter, const QRectF &rect) const Q_DECL_OVERRIDE;
+  
+  // non-virtual methods:
+  void getVisibleRange(int series, const QCPRange &keyRange, int &begin, int &end) const;
+  void getSeriesLines(int series, QVector<QPointF> *lines) const;
+  void drawSeries(QCPPainter *painter, int series, QVector<QPointF> &lineBuffer) const;
+  double seriesDistance(int series, const QPointF &pixelPos, const QCPRange &keyRange) const;
+  
+  friend class QCustomPlot;
+  friend class QCPLegend;
+};
+
+/* end of 'src/plottables/plottable-multigraph.h' */
+
+
+/* including file 'src/plottables/plottable-seriesgraph.h' */
+
+class QCP_LIB_DECL QCPAbstractSeriesStorage
+{
+public:
+  virtual ~QCPAbstractSeriesStorage() {}
+  
+  // introduced virtual methods:
+  virtual int size() const = 0;
+  virtual double key(int index) const = 0;
+  virtual double value(int index) const = 0;
+  virtual void read(int begin, int end, double *keys, double *values) const;
+  virtual int findBegin(double sortKey, bool expandedRange=true) const;
+  virtual int findEnd(double sortKey, bool expandedRange=true) const;
+  virtual QCPRange keyRange(bool &foundRange, QCP::SignDomain signDomain=QCP::sdBoth) const;
+  virtual QCPRange valueRange(bool &foundRange, QCP::SignDomain signDomain=QCP::sdBoth, const QCPRange &inKeyRange=QCPRange()) const;
+  
+  // non-virtual methods:
+  bool isEmpty() const { return size() == 0; }
+  
+  static const int readBlockSize = 1024;
+};
+
+
+template <typename KeyType, typename ValueType>
+class QCPArraySeriesStorage : public QCPAbstractSeriesStorage
+{
+public:
+  QCPArraySeriesStorage(const KeyType *keys, const ValueType *values, int size);
+  QCPArraySeriesStorage(const QVector<KeyType> &keys, const QVector<ValueType> &values);
+  
+  // getters:
+  const KeyType *keys() const { return mKeys; }
+  const ValueType *values() const { return mValues; }
+  
+  // reimplemented virtual methods:
+  virtual int size() const Q_DECL_OVERRIDE { return mSize; }
+  virtual double key(int index) const Q_DECL_OVERRIDE { return double(mKeys[index]); }
+  virtual double value(int index) const Q_DECL_OVERRIDE { return double(mValues[index]); }
+  virtual void read(int begin, int end, double *keys, double *values) const Q_DECL_OVERRIDE;
+  virtual int findBegin(double sortKey, bool expandedRange=true) const Q_DECL_OVERRIDE;
+  virtual int findEnd(double sortKey, bool expandedRange=true) const Q_DECL_OVERRIDE;
+  
+protected:
+  const KeyType *mKeys;
+  const ValueType *mValues;
+  int mSize;
+  QVector<KeyType> mKeyVector;
+  QVector<ValueType> mValueVector;
+};
+
+/*! \typedef QCPExternalSeriesStorage
+
+  Storage adapting two external arrays of doubles, see \ref QCPArraySeriesStorage.
+*/
+typedef QCPArraySeriesStorage<double, double> QCPExternalSeriesStorage;
+
+
+class QCP_LIB_DECL QCPCompressedSeriesStorage : public QCPAbstractSeriesStorage
+{
+public:
+  /*!
+    Defines how precisely values are stored.
+    
+    \see QCPCompressedSeriesStorage::QCPCompressedSeriesStorage
+  */
+  enum ValuePrecision { vpDouble ///< values are stored exactly
+                        ,vpSingle ///< values are rounded to single precision (float), which compresses much better for measured data
+                      };
+  
+  explicit QCPCompressedSeriesStorage(ValuePrecision precision=vpSingle);
+  
+  // getters:
+  ValuePrecision valuePrecision() const { return mPrecision; }
+  int compressedSize() const;
+  
+  // non-property methods:
+  void add(const QVector<double> &keys, const QVector<double> &values);
+  void add(double key, double value);
+  void squeeze();
+  void clear();
+  
+  // reimplemented virtual methods:
+  virtual int size() const Q_DECL_OVERRIDE { return mEncodedSize+mTailKeys.size(); }
+  virtual double key(int index) const Q_DECL_OVERRIDE;
+  virtual double value(int index) const Q_DECL_OVERRIDE;
+  virtual void read(int begin, int end, double *keys, double *values) const Q_DECL_OVERRIDE;
+  virtual int findBegin(double sortKey, bool expandedRange=true) const Q_DECL_OVERRIDE;
+  virtual int findEnd(double sortKey, bool expandedRange=true) const Q_DECL_OVERRIDE;
+  virtual QCPRange valueRange(bool &foundRange, QCP::SignDomain signDomain=QCP::sdBoth, const QCPRange &inKeyRange=QCPRange()) const Q_DECL_OVERRIDE;
+  
+  static const int pointsPerBlock = 1024;
+  
+protected:
+  struct Block
+  {
+    int begin;      // index of the first point
+    int count;
+    int offset;     // into mBytes
+    double firstKey, lastKey;
+    double minValue, maxValue; // of the finite values, if hasValues
+    bool hasValues;
+  };
+  
+  ValuePrecision mPrecision;
+  QByteArray mBytes;
+  QVector<Block> mBlocks;
+  int mEncodedSize;
+  QVector<double> mTailKeys, mTailValues; // points not yet encoded into a block
+  mutable int mCachedBlock; // the last decoded block, so random access doesn't decode a block per point
+  mutable QVector<double> mCachedKeys, mCachedValues;
+  
+  // non-virtual methods:
+  void encodeBlock(const double *keys, const double *values, int count);
+  void decodeBlock(int block, double *keys, double *values) const;
+  int blockOf(int index) const;
+  void blockData(int block, const double *&keys, const double *&values, int &begin, int &count) const;
+  int searchKey(double sortKey, bool upperBound) const;
+};
+
+
+class QCP_LIB_DECL QCPFloatSeriesStorage : public QCPArraySeriesStorage<double, float>
+{
+public:
+  QCPFloatSeriesStorage(const QVector<double> &keys, const QVector<double> &values);
+  
+protected:
+  static QVector<float> toSinglePrecision(const QVector<double> &values);
+};
+
+
+
+// include implementation in header since it is a class template:
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////// QCPArraySeriesStorage
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! \class QCPArraySeriesStorage
+  \brief Series storage adapting key and value arrays owned by someone else
+
+  Presents \a size keys and values held in two separate (structure of arrays) buffers to \ref
+  QCPSeriesGraph, without copying them. The buffers may be anything contiguous: arrays of a
+  simulation, a memory mapped file (see QFile::map), or the storage of a QVector. \a KeyType and \a
+  ValueType may be any arithmetic type convertible to double, so e.g. float values take half the
+  memory of doubles.
+  
+  Keys must be sorted ascending, since \ref findBegin and \ref findEnd search them by bisection.
+  Unlike \ref QCPDataContainer, the storage can't sort them, because it doesn't own them.
+*/
+
+/*!
+  Adapts the arrays \a keys and \a values, each holding \a size elements. The arrays are not
+  copied and must stay valid (and unchanged in size) for the lifetime of the storage.
+*/
+template <typename KeyType, typename ValueType>
+QCPArraySeriesStorage<KeyType, ValueType>::QCPArraySeriesStorage(const KeyType *keys, const ValueType *values, int size) :
+  mKeys(keys),
+  mValues(values),
+  mSize(qMax(0, size))
+{
+}
+
+/*! \overload
+
+  Adapts the vectors \a keys and \a values. The storage keeps a shallow copy of both, so thanks to
+  implicit sharing nothing is copied, and the data stays valid even if the caller's vectors go out
+  of scope. If the sizes differ, the extra elements of the longer vector are ignored.
+*/
+template <typename KeyType, typename ValueType>
+QCPArraySeriesStorage<KeyType, ValueType>::QCPArraySeriesStorage(const QVector<KeyType> &keys, const QVector<ValueType> &values) :
+  mKeyVector(keys),
+  mValueVector(values)
+{
+  mKeys = mKeyVector.constData();
+  mValues = mValueVector.constData();
+  mSize = qMin(mKeyVector.size(), mValueVector.size());
+}
+
+/* inherits documentation from base class */
+template <typename KeyType, typename ValueType>
+void QCPArraySeriesStorage<KeyType, ValueType>::read(int begin, int end, double *keys, double *values) const
+{
+  std::copy(mKeys+begin, mKeys+end, keys);
+  std::copy(mValues+begin, mValues+end, values);
+}
+
+/* inherits documentation from base class */
+template <typename KeyType, typename ValueType>
+int QCPArraySeriesStorage<KeyType, ValueType>::findBegin(double sortKey, bool expandedRange) const
+{
+  if (mSize == 0)
+    return 0;
+  const KeyType *it = std::lower_bound(mKeys, mKeys+mSize, sortKey, [](KeyType key, double bound) { return double(key) < bound; });
+  if (expandedRange && it != mKeys)
+    --it;
+  return int(it-mKeys);
+}
+
+/* inherits documentation from base class */
+template <typename KeyType, typename ValueType>
+int QCPArraySeriesStorage<KeyType, ValueType>::findEnd(double sortKey, bool expandedRange) const
+{
+  if (mSize == 0)
+    return 0;
+  const KeyType *it = std::upper_bound(mKeys, mKeys+mSize, sortKey, [](double bound, KeyType key) { return bound < double(key); });
+  if (expandedRange && it != mKeys+mSize)
+    ++it;
+  return int(it-mKeys);
+}
+
+
+class QCP_LIB_DECL QCPSeriesGraph : public QCPAbstractPlottable, public QCPPlottableInterface1D
+{
+  Q_OBJECT
+  /// \cond INCLUDE_QPROPERTIES
+  Q_PROPERTY(QCPScatterStyle scatterStyle READ scatterStyle WRITE setScatterStyle)
+  /// \endcond
+public:
+  explicit QCPSeriesGraph(QCPAxis *keyAxis, QCPAxis *valueAxis);
+  virtual ~QCPSeriesGraph() Q_DECL_OVERRIDE;
+  
+  // getters:
+  QSharedPointer<QCPAbstractSeriesStorage> data() const { return mStorage; }
+  QCPScatterStyle scatterStyle() const { return mScatterStyle; }
+  
+  // setters:
+  void setData(QSharedPointer<QCPAbstractSeriesStorage> storage);
+  void setScatterStyle(const QCPScatterStyle &style);
+  
+  // virtual methods of 1d plottable interface:
+  virtual int dataCount() const Q_DECL_OVERRIDE;
+  virtual double dataMainKey(int index) const Q_DECL_OVERRIDE;
+  virtual double dataSortKey(int index) const Q_DECL_OVERRIDE;
+  virtual double dataMainValue(int index) const Q_DECL_OVERRIDE;
+  virtual QCPRange dataValueRange(int index) const Q_DECL_OVERRIDE;
+  virtual QPointF dataPixelPosition(int index) const Q_DECL_OVERRIDE;
+  virtual bool sortKeyIsMainKey() const Q_DECL_OVERRIDE;
+  virtual QCPDataSelection selectTestRect(const QRectF &rect, bool onlySelectable) const Q_DECL_OVERRIDE;
+  virtual int findBegin(double sortKey, bool expandedRange=true) const Q_DECL_OVERRIDE;
+  virtual int findEnd(double sortKey, bool expandedRange=true) const Q_DECL_OVERRIDE;
+  
+  // reimplemented virtual methods:
+  virtual double selectTest(const QPointF &pos, bool onlySelectable, QVariant *details=nullptr) const Q_DECL_OVERRIDE;
+  virtual QCPPlottableInterface1D *interface1D() Q_DECL_OVERRIDE { return this; }
+  virtual QCPRange getKeyRange(bool &foundRange, QCP::SignDomain inSignDomain=QCP::sdBoth) const Q_DECL_OVERRIDE;
+  virtual QCPRange getValueRange(bool &foundRange, QCP::SignDomain inSignDomain=QCP::sdBoth, const QCPRange &inKeyRange=QCPRange()) const Q_DECL_OVERRIDE;
+  
+protected:
+  // property members:
+  QSharedPointer<QCPAbstractSeriesStorage> mStorage;
+  QCPScatterStyle mScatterStyle;
+  
+  // reimplemented virtual methods:
+  virtual void draw(QCPPainter *painter) Q_DECL_OVERRIDE;
+  virtual void drawLegendIcon(QCPPainter *painter, const QRectF &rect) const Q_DECL_OVERRIDE;
+  
+  // non-virtual methods:
+  void getLines(QVector<QPointF> *lines, const QCPDataRange &dataRange) const;
+  void drawLines(QCPPainter *painter, const QVector<QPointF> &lines) const;
+  void getDataSegments(QList<QCPDataRange> &selectedSegments, QList<QCPDataRange> &unselectedSegments) const;
+  double pointDistance(const QPointF &pixelPoint, int &closestData) const;
+  
+  friend class QCustomPlot;
+  friend class QCPLegend;
+};
+
+/* end of 'src/plottables/plottable-seriesgraph.h' */
+
+
 /* including file 'src/items/item-straightline.h' */
 /* modified 2022-11-06T12:45:56, size 3137        */
 
@@ -0,0 +1,155 @@
+#ifndef SHAREDSERIES_H
+#define SHAREDSERIES_H
+
+#include <QVector>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+// Append-only series with structural sharing.
+// Values live in fixed-size chunks linked back to their predecessor. Copying a series only
+// bumps the reference count of its newest chunk, so forking months of history is O(1).
+// A chunk is only written to while a single series owns it; as soon as it is shared, the
+// next append starts a fresh chunk on top of it instead (copy-on-write at chunk granularity).
+// Chunks come from a per-type pool: reserveChunks() preallocates them up front and released
+// chunks are recycled, so appends do not touch the heap while the reserve lasts. Once it is used
+// up, append() falls back to new; owners of unbounded series call topUpChunks() from outside
+// their allocation-free paths to keep the reserve from running dry.
+template <typename T, int ChunkSize = 256>
+class SharedSeries {
+    private:
+        struct Chunk {
+            std::atomic<int> ref;
+            Chunk *prev;
+            int used;
+            T items[ChunkSize];
+        };
+
+        Chunk *head;
+        int count;
+
+        static void retain(Chunk *chunk) {
+            if (chunk) chunk->ref.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Free chunks are linked through prev.
+        static Chunk *&freeChunks() {
+            static Chunk *head = nullptr;
+            return head;
+        }
+
+        static std::mutex &poolMutex() {
+            static std::mutex mutex;
+            return mutex;
+        }
+
+        // Length of the free list, readable without the lock.
+        static std::atomic<int> &freeCount() {
+            static std::atomic<int> count(0);
+            return count;
+        }
+
+        static Chunk *allocateChunk() {
+            {
+                std::lock_guard<std::mutex> lock(poolMutex());
+                Chunk *chunk = freeChunks();
+                if (chunk) {
+                    freeChunks() = chunk->prev;
+                    freeCount().fetch_sub(1, std::memory_order_relaxed);
+                    return chunk;
+                }
+            }
+            return new Chunk;
+        }
+
+        static void recycleChunk(Chunk *chunk) {
+            std::lock_guard<std::mutex> lock(poolMutex());
+            chunk->prev = freeChunks();
+            freeChunks() = chunk;
+            freeCount().fetch_add(1, std::memory_order_relaxed);
+        }
+
+        static void release(Chunk *chunk) {
+            // Walk down the chain iteratively so dropping a long series cannot overflow the stack.
+            while (chunk && chunk->ref.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                Chunk *prev = chunk->prev;
+                recycleChunk(chunk);
+                chunk = prev;
+            }
+        }
+
+    public:
+        // Adds chunks (chunks * ChunkSize values) to the pool shared by all series of this type.
+        static void reserveChunks(int chunks) {
+            for (int i = 0; i < chunks; ++i)
+                recycleChunk(new Chunk);
+        }
+
+        // Reserves another chunks chunks if fewer than minimumFree are left in the pool. Costs one
+        // atomic load while the reserve is sufficient.
+        static void topUpChunks(int minimumFree, int chunks) {
+            if (freeCount().load(std::memory_order_relaxed) < minimumFree)
+                reserveChunks(chunks);
+        }
+
+        SharedSeries() : head(nullptr), count(0) {}
+
+        SharedSeries(const SharedSeries &other) : head(other.head), count(other.count) {
+            retain(head);
+        }
+
+        SharedSeries &operator=(const SharedSeries &other) {
+            if (this != &other) {
+                retain(other.head);
+                release(head);
+                head = other.head;
+                count = other.count;
+            }
+            return *this;
+        }
+
+        ~SharedSeries() {
+            release(head);
+        }
+
+        void append(const T &value) {
+            if (!head || head->used == ChunkSize || head->ref.load(std::memory_order_acquire) != 1) {
+                // Our reference to the old head is handed over to the new chunk.
+                Chunk *chunk = allocateChunk();
+                chunk->ref.store(1, std::memory_order_relaxed);
+                chunk->prev = head;
+                chunk->used = 0;
+                head = chunk;
+            }
+            head->items[head->used++] = value;
+            ++count;
+        }
+
+        int size() const { return count; }
+        bool isEmpty() const { return count == 0; }
+
+        T last() const {
+            return head ? head->items[head->used - 1] : T();
+        }
+
+        // Calls f(value) for every value, oldest first.
+        template <typename F>
+        void forEach(F f) const {
+            std::vector<const Chunk*> chain;
+            for (const Chunk *chunk = head; chunk; chunk = chunk->prev)
+                chain.push_back(chunk);
+            for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+                for (int i = 0; i < (*it)->used; ++i)
+                    f((*it)->items[i]);
+            }
+        }
+
+        QVector<T> toVector() const {
+            QVector<T> result;
+            result.reserve(count);
+            forEach([&result](const T &value) { result.append(value); });
+            return result;
+        }
+};
+
+#endif // SHAREDSERIES_H
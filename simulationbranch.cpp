@@ -0,0 +1,118 @@
+#include "simulationbranch.h"
+#include "parallelworkers.h"
+#include <algorithm>
+#include <vector>
+
+SimulationBranch::SimulationBranch(const CGM &monitor, const InsulinPump &insulinPump)
+    : cgm(monitor), pump(insulinPump), insulinDelivered(0), readingsInRange(0), readings(0)
+{
+    pump.setGlucoseMonitor(&cgm);
+    // Branches run on worker threads; only the live pump publishes telemetry.
+    pump.setTelemetry(nullptr);
+    cgm.setTelemetry(nullptr);
+    minGlucose = maxGlucose = cgm.getGlucoseLevel();
+}
+
+SimulationBranch::SimulationBranch(const SimulationBranch &other)
+    : cgm(other.cgm),
+      pump(other.pump),
+      glucoseSeries(other.glucoseSeries),
+      insulinDelivered(other.insulinDelivered),
+      readingsInRange(other.readingsInRange),
+      readings(other.readings),
+      minGlucose(other.minGlucose),
+      maxGlucose(other.maxGlucose)
+{
+    // The copied pump still points at the other branch's CGM.
+    pump.setGlucoseMonitor(&cgm);
+}
+
+SimulationBranch &SimulationBranch::operator=(const SimulationBranch &other) {
+    if (this != &other) {
+        cgm = other.cgm;
+        pump = other.pump;
+        pump.setGlucoseMonitor(&cgm);
+        glucoseSeries = other.glucoseSeries;
+        insulinDelivered = other.insulinDelivered;
+        readingsInRange = other.readingsInRange;
+        readings = other.readings;
+        minGlucose = other.minGlucose;
+        maxGlucose = other.maxGlucose;
+    }
+    return *this;
+}
+
+SimulationBranch SimulationBranch::fork() const {
+    return SimulationBranch(*this);
+}
+
+QVector<SimulationBranch> SimulationBranch::fork(int count) const {
+    QVector<SimulationBranch> branches;
+    branches.reserve(count);
+    for (int i = 0; i < count; ++i)
+        branches.append(fork());
+    return branches;
+}
+
+void SimulationBranch::apply(const BranchAction &action) {
+    if (action.basalRate >= 0)
+        pump.setBasalRate(action.basalRate);
+    if (action.bolus > 0 && pump.administerInsulin(action.bolus, DeliveryType::Bolus))
+        insulinDelivered += action.bolus;
+}
+
+void SimulationBranch::step() {
+    cgm.readGlucose();
+    double level = cgm.getGlucoseLevel();
+    glucoseSeries.append(level);
+
+    ++readings;
+    if (level >= 3.9 && level <= 10.0)
+        ++readingsInRange;
+    minGlucose = std::min(minGlucose, level);
+    maxGlucose = std::max(maxGlucose, level);
+
+    insulinDelivered += toUnits(pump.deliverBasalTick());
+}
+
+BranchOutcome SimulationBranch::outcome() const {
+    BranchOutcome result;
+    result.finalGlucose = glucoseSeries.isEmpty() ? minGlucose : glucoseSeries.last();
+    result.minGlucose = minGlucose;
+    result.maxGlucose = maxGlucose;
+    result.timeInRange = readings > 0 ? double(readingsInRange) / readings : 0;
+    result.insulinDelivered = insulinDelivered;
+    return result;
+}
+
+CGM &SimulationBranch::glucoseMonitor() {
+    return cgm;
+}
+
+InsulinPump &SimulationBranch::insulinPump() {
+    return pump;
+}
+
+const SharedSeries<double> &SimulationBranch::glucose() const {
+    return glucoseSeries;
+}
+
+QVector<BranchOutcome> SimulationBranch::evaluate(const SimulationBranch &base, const QVector<BranchAction> &actions, int steps) {
+    // Fork up front on this thread; afterwards every branch only touches its own state.
+    QVector<SimulationBranch> branches = base.fork(actions.size());
+    QVector<BranchOutcome> outcomes(actions.size());
+    SimulationBranch *branchData = branches.data();
+    BranchOutcome *outcomeData = outcomes.data();
+
+    runWorkers(actions.size(), [&](int worker, int workers) {
+        for (int i = worker; i < branches.size(); i += workers) {
+            SimulationBranch &branch = branchData[i];
+            branch.apply(actions[i]);
+            for (int s = 0; s < steps; ++s)
+                branch.step();
+            outcomeData[i] = branch.outcome();
+        }
+    });
+
+    return outcomes;
+}
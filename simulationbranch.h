@@ -0,0 +1,57 @@
+#ifndef SIMULATIONBRANCH_H
+#define SIMULATIONBRANCH_H
+
+#include <QVector>
+#include "cgm.h"
+#include "insulinpump.h"
+#include "sharedseries.h"
+
+// A candidate action applied to a branch right after it is forked.
+struct BranchAction {
+    double bolus = 0;        // e.g. a candidate from InsulinPump::calculateBolus
+    double basalRate = -1;   // a ControlIQ style basal change, negative keeps the current rate
+};
+
+struct BranchOutcome {
+    double finalGlucose = 0;
+    double minGlucose = 0;
+    double maxGlucose = 0;
+    double timeInRange = 0;       // fraction of readings between 3.9 and 10.0 mmol/L
+    double insulinDelivered = 0;
+};
+
+// Simulated patient state (CGM, pump and history) that can be forked for what-if dosing.
+// Pump history and the glucose series are SharedSeries, so a fork shares everything recorded
+// so far and only pays for what it appends afterwards.
+class SimulationBranch {
+    private:
+        CGM cgm;
+        InsulinPump pump;
+        SharedSeries<double> glucoseSeries;
+        double insulinDelivered;
+        int readingsInRange;
+        int readings;
+        double minGlucose;
+        double maxGlucose;
+
+    public:
+        SimulationBranch(const CGM &monitor, const InsulinPump &insulinPump);
+        SimulationBranch(const SimulationBranch &other);
+        SimulationBranch &operator=(const SimulationBranch &other);
+
+        SimulationBranch fork() const;
+        QVector<SimulationBranch> fork(int count) const;
+
+        void apply(const BranchAction &action);
+        void step(); // one CGM reading (5 minutes) plus the matching basal delivery
+        BranchOutcome outcome() const;
+
+        CGM &glucoseMonitor();
+        InsulinPump &insulinPump();
+        const SharedSeries<double> &glucose() const;
+
+        // Forks one branch per action, runs them forward in parallel and returns their outcomes in order.
+        static QVector<BranchOutcome> evaluate(const SimulationBranch &base, const QVector<BranchAction> &actions, int steps);
+};
+
+#endif // SIMULATIONBRANCH_H
@@ -0,0 +1,419 @@
+#include "simulationstore.h"
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+static const char fileMagic[8] = { 'I', 'N', 'S', 'P', 'C', 'O', 'L', '1' };
+
+// ---- Encoding ----
+
+static void putVarint(std::vector<uchar> &out, quint64 value) {
+    while (value >= 0x80) {
+        out.push_back(uchar(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(uchar(value));
+}
+
+static bool getVarint(const uchar *&p, const uchar *end, quint64 &value) {
+    value = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uchar byte = *p++;
+        value |= quint64(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+static quint64 zigzag(qint64 value) {
+    return (quint64(value) << 1) ^ quint64(value >> 63);
+}
+
+static qint64 unzigzag(quint64 value) {
+    return qint64(value >> 1) ^ -qint64(value & 1);
+}
+
+static void encodeTimestamps(std::vector<uchar> &out, const QVector<qint64> &timestamps) {
+    qint64 previous = 0, previousDelta = 0;
+    for (qint64 timestamp : timestamps) {
+        qint64 delta = timestamp - previous;
+        putVarint(out, zigzag(delta - previousDelta));
+        previousDelta = delta;
+        previous = timestamp;
+    }
+}
+
+static bool decodeTimestamps(const uchar *p, const uchar *end, int rows, QVector<qint64> &timestamps) {
+    timestamps.resize(rows);
+    qint64 previous = 0, previousDelta = 0;
+    for (int i = 0; i < rows; ++i) {
+        quint64 encoded;
+        if (!getVarint(p, end, encoded))
+            return false;
+        previousDelta += unzigzag(encoded);
+        previous += previousDelta;
+        timestamps[i] = previous;
+    }
+    return true;
+}
+
+// Whole zero bytes above and below the highest and lowest set bit of a non-zero x.
+static int leadingZeroBytes(quint64 x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_clzll(x) / 8;
+#else
+    int bytes = 0;
+    for (; !(x >> 56); x <<= 8)
+        ++bytes;
+    return bytes;
+#endif
+}
+
+static int trailingZeroBytes(quint64 x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(x) / 8;
+#else
+    int bytes = 0;
+    for (; !(x & 0xff); x >>= 8)
+        ++bytes;
+    return bytes;
+#endif
+}
+
+// Control byte: 0 for a repeated value, otherwise (trailing zero bytes << 4) | significant bytes,
+// followed by the significant bytes of the XOR with the previous value.
+static void encodeValues(std::vector<uchar> &out, const QVector<double> &values) {
+    quint64 previous = 0;
+    for (double value : values) {
+        quint64 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        quint64 x = bits ^ previous;
+        previous = bits;
+        if (!x) {
+            out.push_back(0);
+            continue;
+        }
+        int leading = leadingZeroBytes(x);
+        int trailing = trailingZeroBytes(x);
+        int significant = 8 - leading - trailing;
+        out.push_back(uchar(trailing << 4 | significant));
+        x >>= 8 * trailing;
+        for (int i = 0; i < significant; ++i, x >>= 8)
+            out.push_back(uchar(x));
+    }
+}
+
+static bool decodeValues(const uchar *p, const uchar *end, int rows, QVector<double> &values) {
+    values.resize(rows);
+    quint64 previous = 0;
+    for (int i = 0; i < rows; ++i) {
+        if (p >= end)
+            return false;
+        uchar control = *p++;
+        int trailing = control >> 4, significant = control & 0x0f;
+        if (trailing + significant > 8 || end - p < significant)
+            return false;
+        quint64 x = 0;
+        for (int b = significant - 1; b >= 0; --b)
+            x = x << 8 | p[b];
+        p += significant;
+        previous ^= x << (8 * trailing);
+        std::memcpy(&values[i], &previous, sizeof(double));
+    }
+    return true;
+}
+
+// ---- SimulationRows ----
+
+void SimulationRows::append(qint64 timestamp, double glucose, double basal, double bolus, double insulinOnBoard) {
+    timestamps.append(timestamp);
+    values[GlucoseColumn].append(glucose);
+    values[BasalColumn].append(basal);
+    values[BolusColumn].append(bolus);
+    values[InsulinOnBoardColumn].append(insulinOnBoard);
+}
+
+void SimulationRows::clear() {
+    // resize(0) keeps the capacity, so a recorder reuses its buffers chunk after chunk.
+    timestamps.resize(0);
+    for (int column = 0; column < SimulationColumnCount; ++column)
+        values[column].resize(0);
+}
+
+// ---- SimulationStoreWriter ----
+
+SimulationStoreWriter::SimulationStoreWriter() : offset(0) {
+}
+
+SimulationStoreWriter::~SimulationStoreWriter() {
+    close();
+}
+
+bool SimulationStoreWriter::open(const QString &path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (file.isOpen())
+        return false;
+    file.setFileName(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    SimulationFileHeader header;
+    std::memcpy(header.magic, fileMagic, sizeof(header.magic));
+    header.version = simulationStoreVersion;
+    header.columnCount = SimulationColumnCount;
+    if (file.write(reinterpret_cast<const char*>(&header), sizeof(header)) != sizeof(header)) {
+        file.close();
+        return false;
+    }
+    offset = sizeof(header);
+    index.clear();
+    return true;
+}
+
+bool SimulationStoreWriter::appendChunk(quint32 patient, const SimulationRows &rows) {
+    int count = rows.size();
+    if (count == 0)
+        return true;
+
+    // Everything but the write itself happens on the calling thread, outside the lock.
+    SimulationChunkInfo info;
+    info.patient = patient;
+    info.rows = quint32(count);
+    info.firstTimestamp = rows.timestamps.first();
+    info.lastTimestamp = rows.timestamps.last();
+
+    SimulationChunkHeader header;
+    header.patient = patient;
+    header.rows = quint32(count);
+
+    std::vector<uchar> encoded(sizeof(header));
+    encodeTimestamps(encoded, rows.timestamps);
+    header.timestampBytes = quint32(encoded.size() - sizeof(header));
+    for (int column = 0; column < SimulationColumnCount; ++column) {
+        const QVector<double> &values = rows.values[column];
+        size_t before = encoded.size();
+        encodeValues(encoded, values);
+        header.columnBytes[column] = quint32(encoded.size() - before);
+        // NaN (no reading) is never inside a query range, so it does not widen the statistics;
+        // an all-NaN column gets the empty range [inf, -inf] and is always pruned.
+        double minimum = std::numeric_limits<double>::infinity(), maximum = -minimum;
+        for (double value : values) {
+            if (value < minimum)
+                minimum = value;
+            if (value > maximum)
+                maximum = value;
+        }
+        info.minimum[column] = minimum;
+        info.maximum[column] = maximum;
+    }
+    std::memcpy(encoded.data(), &header, sizeof(header));
+    encoded.resize((encoded.size() + 7) & ~size_t(7));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!file.isOpen())
+        return false;
+    qint64 size = qint64(encoded.size());
+    if (file.write(reinterpret_cast<const char*>(encoded.data()), size) != size)
+        return false;
+    info.offset = offset;
+    offset += quint64(size);
+    index.append(info);
+    return true;
+}
+
+bool SimulationStoreWriter::close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!file.isOpen())
+        return false;
+
+    SimulationFileFooter footer;
+    footer.indexOffset = offset;
+    footer.chunkCount = quint32(index.size());
+    footer.magic = simulationStoreFooterMagic;
+
+    qint64 indexSize = qint64(index.size() * sizeof(SimulationChunkInfo));
+    bool written = file.write(reinterpret_cast<const char*>(index.constData()), indexSize) == indexSize
+                   && file.write(reinterpret_cast<const char*>(&footer), sizeof(footer)) == sizeof(footer);
+    file.close();
+    index.clear();
+    return written;
+}
+
+// ---- SimulationRecorder ----
+
+SimulationRecorder::SimulationRecorder(SimulationStoreWriter &storeWriter, quint32 patientId, int rowsPerChunk)
+    : writer(storeWriter), patient(patientId), chunkRows(rowsPerChunk)
+{
+    rows.timestamps.reserve(chunkRows);
+    for (int column = 0; column < SimulationColumnCount; ++column)
+        rows.values[column].reserve(chunkRows);
+}
+
+SimulationRecorder::~SimulationRecorder() {
+    flush();
+}
+
+void SimulationRecorder::append(qint64 timestamp, double glucose, double basal, double bolus, double insulinOnBoard) {
+    rows.append(timestamp, glucose, basal, bolus, insulinOnBoard);
+    if (rows.size() >= chunkRows)
+        flush();
+}
+
+void SimulationRecorder::flush() {
+    writer.appendChunk(patient, rows);
+    rows.clear();
+}
+
+// ---- SimulationStoreReader ----
+
+SimulationStoreReader::SimulationStoreReader() : data(nullptr), length(0), index(nullptr), chunks(0) {
+}
+
+SimulationStoreReader::~SimulationStoreReader() {
+    close();
+}
+
+bool SimulationStoreReader::open(const QString &path) {
+    close();
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    length = file.size();
+    qint64 minimumSize = qint64(sizeof(SimulationFileHeader) + sizeof(SimulationFileFooter));
+    data = length >= minimumSize ? file.map(0, length) : nullptr;
+    if (!data) {
+        close();
+        return false;
+    }
+
+    SimulationFileHeader header;
+    SimulationFileFooter footer;
+    std::memcpy(&header, data, sizeof(header));
+    std::memcpy(&footer, data + length - sizeof(footer), sizeof(footer));
+    // The index must fill exactly the space before the footer. Compared as a size rather than an
+    // end offset, so a corrupt indexOffset cannot wrap around.
+    quint64 indexLimit = quint64(length) - sizeof(footer);
+    bool indexValid = footer.indexOffset >= sizeof(header) && footer.indexOffset <= indexLimit
+                      && footer.indexOffset % alignof(SimulationChunkInfo) == 0
+                      && indexLimit - footer.indexOffset == quint64(footer.chunkCount) * sizeof(SimulationChunkInfo);
+    if (std::memcmp(header.magic, fileMagic, sizeof(fileMagic)) != 0 || header.version != simulationStoreVersion
+        || header.columnCount != SimulationColumnCount || footer.magic != simulationStoreFooterMagic
+        || !indexValid) {
+        close();
+        return false;
+    }
+
+    // Chunks are padded to 8 bytes and the mapping is page-aligned, so the index is used in place.
+    index = reinterpret_cast<const SimulationChunkInfo*>(data + footer.indexOffset);
+    chunks = int(footer.chunkCount);
+    return true;
+}
+
+void SimulationStoreReader::close() {
+    if (data)
+        file.unmap(const_cast<uchar*>(data));
+    if (file.isOpen())
+        file.close();
+    data = nullptr;
+    length = 0;
+    index = nullptr;
+    chunks = 0;
+}
+
+int SimulationStoreReader::chunkCount() const {
+    return chunks;
+}
+
+const SimulationChunkInfo &SimulationStoreReader::chunkInfo(int chunk) const {
+    return index[chunk];
+}
+
+// Finds the encoded block of one column (or of the timestamps, column -1) of a chunk.
+static bool locateBlock(const uchar *data, qint64 length, const SimulationChunkInfo &info, int column,
+                        const uchar *&begin, const uchar *&end) {
+    SimulationChunkHeader header;
+    if (info.offset > quint64(length) || quint64(length) - info.offset < sizeof(header))
+        return false;
+    std::memcpy(&header, data + info.offset, sizeof(header));
+    if (header.rows != info.rows)
+        return false;
+
+    quint64 blockOffset = info.offset + sizeof(header);
+    quint64 blockSize = header.timestampBytes;
+    for (int c = 0; c <= column; ++c) {
+        blockOffset += blockSize;
+        blockSize = header.columnBytes[c];
+    }
+    if (blockOffset + blockSize > quint64(length))
+        return false;
+    begin = data + blockOffset;
+    end = begin + blockSize;
+    return true;
+}
+
+bool SimulationStoreReader::readTimestamps(int chunk, QVector<qint64> &timestamps) const {
+    const uchar *begin, *end;
+    const SimulationChunkInfo &info = index[chunk];
+    return locateBlock(data, length, info, -1, begin, end) && decodeTimestamps(begin, end, int(info.rows), timestamps);
+}
+
+bool SimulationStoreReader::readColumn(int chunk, SimulationColumn column, QVector<double> &values) const {
+    const uchar *begin, *end;
+    const SimulationChunkInfo &info = index[chunk];
+    return locateBlock(data, length, info, column, begin, end) && decodeValues(begin, end, int(info.rows), values);
+}
+
+QVector<SimulationInterval> SimulationStoreReader::intervals(SimulationColumn column, double minimum, double maximum) const {
+    QVector<SimulationInterval> result;
+    // Per patient, the result entry still open at the end of that patient's previous chunk.
+    std::unordered_map<quint32, int> open;
+    QVector<qint64> timestamps;
+    QVector<double> values;
+
+    for (int chunk = 0; chunk < chunks; ++chunk) {
+        const SimulationChunkInfo &info = index[chunk];
+        auto previous = open.find(info.patient);
+        int running = previous != open.end() ? previous->second : -1;
+
+        // Pushdown: the statistics decide most chunks without decoding anything.
+        if (info.maximum[column] < minimum || info.minimum[column] > maximum) {
+            if (previous != open.end())
+                open.erase(previous);
+            continue;
+        }
+        // An unreadable chunk ends the patient's interval like a chunk with no row inside would.
+        if (!readColumn(chunk, column, values) || !readTimestamps(chunk, timestamps)) {
+            if (previous != open.end())
+                open.erase(previous);
+            continue;
+        }
+
+        // No all-inside shortcut from the statistics: they skip NaN rows, which are never inside.
+        for (int row = 0; row < values.size(); ++row) {
+            bool inside = values[row] >= minimum && values[row] <= maximum;
+            if (!inside) {
+                running = -1;
+                continue;
+            }
+            if (running < 0) {
+                SimulationInterval interval;
+                interval.patient = info.patient;
+                interval.start = timestamps[row];
+                interval.rows = 0;
+                result.append(interval);
+                running = result.size() - 1;
+            }
+            result[running].end = timestamps[row];
+            ++result[running].rows;
+        }
+
+        if (running >= 0)
+            open[info.patient] = running;
+        else if (previous != open.end())
+            open.erase(previous);
+    }
+    return result;
+}
@@ -0,0 +1,154 @@
+#ifndef SIMULATIONSTORE_H
+#define SIMULATIONSTORE_H
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+#include <mutex>
+
+// Columnar result files for population simulations.
+//
+// Rows are (timestamp, glucose, basal, bolus, insulin on board). A file is a sequence of chunks,
+// each holding up to a few thousand consecutive rows of one patient, followed by an index:
+//
+//   SimulationFileHeader
+//   chunk*        SimulationChunkHeader, then one encoded block per column
+//   index         SimulationChunkInfo[chunkCount]
+//   SimulationFileFooter
+//
+// Timestamps are stored as zigzag varint delta-of-deltas (a fixed sampling interval costs one byte
+// per row), values as the XOR with the previous value with leading and trailing zero bytes dropped
+// (repeated values cost one byte). The index keeps every chunk's patient, time span and per-column
+// min/max (ignoring NaN), so queries skip whole chunks without touching them, and each column can
+// be decoded without the others. The varint and XOR blocks are byte streams; the fixed-size
+// headers, index and footer are in the writer's byte order, so the index can be used in place.
+// A file from a host of the other byte order fails the version check and is rejected.
+//
+// Writers on several threads may share one SimulationStoreWriter; chunks are encoded outside the
+// lock and appended whole. Readers map the file read-only.
+
+enum SimulationColumn {
+    GlucoseColumn,          // mmol/L
+    BasalColumn,            // u/hr
+    BolusColumn,            // units delivered at this row
+    InsulinOnBoardColumn,   // units
+    SimulationColumnCount
+};
+
+struct SimulationFileHeader {
+    char magic[8];          // "INSPCOL1"
+    quint32 version;
+    quint32 columnCount;
+};
+
+struct SimulationChunkHeader {
+    quint32 patient;
+    quint32 rows;
+    quint32 timestampBytes;
+    quint32 columnBytes[SimulationColumnCount];
+};
+
+struct SimulationChunkInfo {
+    quint64 offset;         // of the SimulationChunkHeader
+    quint32 patient;
+    quint32 rows;
+    qint64 firstTimestamp;
+    qint64 lastTimestamp;
+    double minimum[SimulationColumnCount];
+    double maximum[SimulationColumnCount];
+};
+
+struct SimulationFileFooter {
+    quint64 indexOffset;
+    quint32 chunkCount;
+    quint32 magic;          // simulationStoreFooterMagic
+};
+
+const quint32 simulationStoreVersion = 1;
+const quint32 simulationStoreFooterMagic = 0x58444e49; // "INDX"
+
+// Rows of one patient, column by column.
+struct SimulationRows {
+    QVector<qint64> timestamps;
+    QVector<double> values[SimulationColumnCount];
+
+    void append(qint64 timestamp, double glucose, double basal, double bolus, double insulinOnBoard);
+    int size() const { return timestamps.size(); }
+    void clear();
+};
+
+// A run of consecutive rows of one patient, all satisfying a query.
+struct SimulationInterval {
+    quint32 patient;
+    qint64 start;           // timestamp of the first row
+    qint64 end;             // timestamp of the last row
+    int rows;
+};
+
+class SimulationStoreWriter {
+    private:
+        QFile file;
+        std::mutex mutex;
+        QVector<SimulationChunkInfo> index;
+        quint64 offset;
+
+    public:
+        SimulationStoreWriter();
+        ~SimulationStoreWriter();
+
+        bool open(const QString &path);
+
+        // Encodes rows (all of one patient, in time order) as one chunk. Safe to call from several threads.
+        bool appendChunk(quint32 patient, const SimulationRows &rows);
+
+        // Writes the index and footer. Called by the destructor if still open.
+        bool close();
+};
+
+// Buffers the rows of one patient and hands them to the writer a chunk at a time. One per worker
+// thread and patient; the remainder is written when the recorder is destroyed.
+class SimulationRecorder {
+    private:
+        SimulationStoreWriter &writer;
+        quint32 patient;
+        int chunkRows;
+        SimulationRows rows;
+
+    public:
+        SimulationRecorder(SimulationStoreWriter &storeWriter, quint32 patientId, int rowsPerChunk = 4096);
+        ~SimulationRecorder();
+
+        void append(qint64 timestamp, double glucose, double basal, double bolus, double insulinOnBoard);
+        void flush();
+};
+
+class SimulationStoreReader {
+    private:
+        QFile file;
+        const uchar *data;
+        qint64 length;
+        const SimulationChunkInfo *index;
+        int chunks;
+
+    public:
+        SimulationStoreReader();
+        ~SimulationStoreReader();
+
+        bool open(const QString &path);
+        void close();
+
+        int chunkCount() const;
+        const SimulationChunkInfo &chunkInfo(int chunk) const;
+
+        // Decode one column of one chunk.
+        bool readTimestamps(int chunk, QVector<qint64> &timestamps) const;
+        bool readColumn(int chunk, SimulationColumn column, QVector<double> &values) const;
+
+        // Maximal runs of rows whose column value lies in [minimum, maximum], merged across the chunk
+        // boundaries of a patient. Chunks whose statistics exclude the range are never decoded, so
+        // intervals(GlucoseColumn, -inf, 3.9) finds every hypo while reading only the chunks that contain one.
+        QVector<SimulationInterval> intervals(SimulationColumn column, double minimum, double maximum) const;
+};
+
+#endif // SIMULATIONSTORE_H
@@ -0,0 +1,195 @@
+#include "telemetrybus.h"
+#include <chrono>
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// system_clock is CLOCK_REALTIME on POSIX systems and portable everywhere else.
+static quint64 realtimeNanoseconds() {
+    return quint64(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+TelemetryBus::TelemetryBus() : header(nullptr), ring(nullptr), mappedSize(0), nextIndex(0) {
+    segmentName[0] = '\0';
+}
+
+TelemetryBus::~TelemetryBus() {
+#ifdef Q_OS_UNIX
+    if (header) {
+        munmap(header, mappedSize);
+        shm_unlink(segmentName);
+    }
+#endif
+}
+
+bool TelemetryBus::create(const char *name, quint32 capacity) {
+#ifdef Q_OS_UNIX
+    if (header || std::strlen(name) >= sizeof(segmentName))
+        return false;
+
+    quint32 slotCount = 1;
+    while (slotCount < capacity)
+        slotCount <<= 1;
+
+    int fd = shm_open(name, O_CREAT | O_RDWR | O_TRUNC, 0600);
+    if (fd < 0)
+        return false;
+
+    quint64 size = sizeof(TelemetryHeader) + quint64(slotCount) * sizeof(TelemetrySlot);
+    void *memory = MAP_FAILED;
+    if (ftruncate(fd, off_t(size)) == 0)
+        memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        shm_unlink(name);
+        return false;
+    }
+
+    // ftruncate zero-fills, so every slot starts with sequence 0 (never written).
+    header = static_cast<TelemetryHeader*>(memory);
+    ring = reinterpret_cast<TelemetrySlot*>(header + 1);
+    mappedSize = size;
+    std::strcpy(segmentName, name);
+
+    header->version = telemetryVersion;
+    header->capacity = slotCount;
+    header->slotSize = sizeof(TelemetrySlot);
+    header->published.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = telemetryMagic;
+    return true;
+#else
+    (void)name;
+    (void)capacity;
+    return false;
+#endif
+}
+
+bool TelemetryBus::isOpen() const {
+    return header != nullptr;
+}
+
+void TelemetryBus::publish(TelemetryKind kind, double value, quint32 detail) {
+    if (!header)
+        return;
+
+    // Threads publishing at once (the UI and a started ControlIQ worker) each claim their own index.
+    quint64 index = nextIndex.fetch_add(1, std::memory_order_relaxed);
+    TelemetrySlot &slot = ring[index & (header->capacity - 1)];
+
+    slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.record.timestamp = realtimeNanoseconds();
+    slot.record.kind = kind;
+    slot.record.detail = detail;
+    slot.record.value = value;
+    slot.sequence.store(2 * index + 2, std::memory_order_release);
+
+    // Writers may finish out of order; published only moves forward. Readers that get ahead of a
+    // slow writer see its slot still being written and retry later.
+    quint64 published = header->published.load(std::memory_order_relaxed);
+    while (published < index + 1
+           && !header->published.compare_exchange_weak(published, index + 1, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+}
+
+TelemetryReader::TelemetryReader() : header(nullptr), ring(nullptr), mappedSize(0), cursor(0) {
+}
+
+TelemetryReader::~TelemetryReader() {
+#ifdef Q_OS_UNIX
+    if (header)
+        munmap(const_cast<TelemetryHeader*>(header), mappedSize);
+#endif
+}
+
+bool TelemetryReader::open(const char *name) {
+#ifdef Q_OS_UNIX
+    if (header)
+        return false;
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    void *memory = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && quint64(info.st_size) >= sizeof(TelemetryHeader))
+        memory = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED)
+        return false;
+
+    const TelemetryHeader *mapped = static_cast<const TelemetryHeader*>(memory);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // Slots are addressed with index & (capacity - 1), so anything but a power of two would read
+    // outside the mapping (0) or alias slots.
+    quint32 capacity = mapped->capacity;
+    if (mapped->magic != telemetryMagic || mapped->version != telemetryVersion || mapped->slotSize != sizeof(TelemetrySlot)
+        || capacity == 0 || (capacity & (capacity - 1)) != 0
+        || quint64(info.st_size) < sizeof(TelemetryHeader) + quint64(capacity) * sizeof(TelemetrySlot)) {
+        munmap(memory, size_t(info.st_size));
+        return false;
+    }
+
+    header = mapped;
+    ring = reinterpret_cast<const TelemetrySlot*>(header + 1);
+    mappedSize = quint64(info.st_size);
+
+    // Start at the oldest record still in the ring, so a reader attached late sees the recent history.
+    quint64 published = header->published.load(std::memory_order_acquire);
+    cursor = published > header->capacity ? published - header->capacity : 0;
+    return true;
+#else
+    (void)name;
+    return false;
+#endif
+}
+
+bool TelemetryReader::isOpen() const {
+    return header != nullptr;
+}
+
+bool TelemetryReader::next(TelemetryRecord &record, quint64 *lost) {
+    if (!header)
+        return false;
+
+    while (true) {
+        quint64 published = header->published.load(std::memory_order_acquire);
+        if (cursor >= published)
+            return false;
+
+        // Fell more than a whole ring behind: jump to the oldest record that can still be valid.
+        if (published - cursor > header->capacity) {
+            if (lost)
+                *lost += published - header->capacity - cursor;
+            cursor = published - header->capacity;
+        }
+
+        const TelemetrySlot &slot = ring[cursor & (header->capacity - 1)];
+        quint64 expected = 2 * cursor + 2;
+        quint64 before = slot.sequence.load(std::memory_order_acquire);
+        std::memcpy(&record, &slot.record, sizeof(record));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        quint64 after = slot.sequence.load(std::memory_order_relaxed);
+
+        if (before == expected && after == expected) {
+            ++cursor;
+            return true;
+        }
+        if (before > expected) {
+            // Overwritten while we looked; skip it.
+            if (lost)
+                ++*lost;
+            ++cursor;
+        } else {
+            return false; // still being written
+        }
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef TELEMETRYBUS_H
+#define TELEMETRYBUS_H
+
+#include <QtGlobal>
+#include <atomic>
+
+// Live telemetry for external tools through a POSIX shared memory ring (shm_open + mmap).
+//
+// One writer process (the simulator, publishing from any of its threads) and any number of
+// readers in other processes. Publishing and reading are plain memory operations: no syscalls,
+// no locks, and the GUI thread is never involved on the reader side. Each slot is protected by
+// its own sequence number (a seqlock):
+//
+//   header   TelemetryHeader
+//   slots    TelemetrySlot[capacity], record n lives in slot n % capacity
+//
+// The writer sets a slot's sequence to 2n+1 while writing record n and to 2n+2 once it is
+// complete. A reader copies the record and accepts it only if the sequence read before and
+// after the copy is 2n+2; otherwise the record is still being written or has been overwritten
+// because the reader fell more than capacity records behind.
+
+enum class TelemetryKind : quint32 {
+    GlucoseReading = 1, // value: mmol/L
+    BasalChange = 2,    // value: new basal rate, u/hr
+    Delivery = 3        // value: units delivered, detail: DeliveryType
+};
+
+struct TelemetryRecord {
+    quint64 timestamp;  // system_clock (CLOCK_REALTIME), nanoseconds since the epoch
+    TelemetryKind kind;
+    quint32 detail;
+    double value;
+};
+
+struct TelemetrySlot {
+    std::atomic<quint64> sequence;
+    TelemetryRecord record;
+};
+
+struct TelemetryHeader {
+    quint32 magic;       // telemetryMagic once the writer has initialised the segment
+    quint32 version;
+    quint32 capacity;    // number of slots, a power of two
+    quint32 slotSize;    // sizeof(TelemetrySlot)
+    std::atomic<quint64> published; // records published so far
+};
+
+const quint32 telemetryMagic = 0x494e5350; // "INSP"
+const quint32 telemetryVersion = 1;
+
+// Writer side, owned by the simulator. Creates (and on destruction unlinks) the segment.
+class TelemetryBus {
+    private:
+        TelemetryHeader *header;
+        TelemetrySlot *ring;
+        quint64 mappedSize;
+        std::atomic<quint64> nextIndex;
+        char segmentName[64];
+
+    public:
+        TelemetryBus();
+        ~TelemetryBus();
+
+        // name is a POSIX shm name such as "/insulinpump-telemetry"; capacity is rounded up to a power of two.
+        bool create(const char *name, quint32 capacity = 65536);
+        bool isOpen() const;
+
+        void publish(TelemetryKind kind, double value, quint32 detail = 0);
+};
+
+// Reader side for C++ tools.
+class TelemetryReader {
+    private:
+        const TelemetryHeader *header;
+        const TelemetrySlot *ring;
+        quint64 mappedSize;
+        quint64 cursor;
+
+    public:
+        TelemetryReader();
+        ~TelemetryReader();
+
+        // Starts at the oldest record still in the ring (up to capacity records back from the newest),
+        // not at the newest one, so the history published before open() is read first. Fails for
+        // segments that are not initialised or whose capacity is not a power of two.
+        bool open(const char *name);
+        bool isOpen() const;
+
+        // Copies the next record. Returns false when the reader has caught up with the writer.
+        // Records overwritten before they could be read are skipped and counted in *lost.
+        bool next(TelemetryRecord &record, quint64 *lost = nullptr);
+};
+
+#endif // TELEMETRYBUS_H
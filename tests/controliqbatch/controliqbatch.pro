@@ -0,0 +1,15 @@
+# Checks that every controlIQAdjustBatch kernel agrees bit for bit with controlIQDecide:
+#
+#   qmake tests/controliqbatch && make check
+
+QT       += core testlib
+QT       -= gui
+
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+    tst_controliqbatch.cpp \
+    ../../controliqbatch.cpp
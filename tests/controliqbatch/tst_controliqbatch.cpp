@@ -0,0 +1,113 @@
+#include <QtTest>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+#include "controliqbatch.h"
+
+// Runs each batch kernel over randomized patients and compares every output with controlIQDecide
+// bit for bit. Inputs mix ordinary values with the thresholds themselves, their neighbouring
+// doubles, NaN and infinities, and the batch size leaves a remainder for the scalar tail.
+class ControlIQBatchTest : public QObject {
+    Q_OBJECT
+
+    private:
+        static bool supported(ControlIQKernel kernel) {
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+            if (kernel == ControlIQKernel::AVX2)
+                return __builtin_cpu_supports("avx2");
+            if (kernel == ControlIQKernel::AVX512)
+                return __builtin_cpu_supports("avx512f");
+#endif
+            return kernel == ControlIQKernel::Scalar || kernel == ControlIQKernel::Auto;
+        }
+
+        // Picks uniformly from [low, high] most of the time, otherwise one of the special values.
+        static double pick(std::mt19937 &random, double low, double high, const std::vector<double> &special) {
+            std::uniform_int_distribution<int> choice(0, 3);
+            if (choice(random) != 0)
+                return std::uniform_real_distribution<double>(low, high)(random);
+            std::uniform_int_distribution<size_t> index(0, special.size() - 1);
+            return special[index(random)];
+        }
+
+        static void addEdges(std::vector<double> &values, double threshold) {
+            values.push_back(threshold);
+            values.push_back(std::nextafter(threshold, -std::numeric_limits<double>::infinity()));
+            values.push_back(std::nextafter(threshold, std::numeric_limits<double>::infinity()));
+        }
+
+        static bool sameBits(double a, double b) {
+            return std::memcmp(&a, &b, sizeof(double)) == 0;
+        }
+
+    private slots:
+        void matchesScalarDecision_data() {
+            QTest::addColumn<int>("kernel");
+            QTest::newRow("auto") << int(ControlIQKernel::Auto);
+            QTest::newRow("scalar") << int(ControlIQKernel::Scalar);
+            QTest::newRow("avx2") << int(ControlIQKernel::AVX2);
+            QTest::newRow("avx512") << int(ControlIQKernel::AVX512);
+        }
+
+        void matchesScalarDecision() {
+            QFETCH(int, kernel);
+            if (!supported(ControlIQKernel(kernel)))
+                QSKIP("Kernel not supported by this CPU");
+
+            typedef ControlIQThresholds T;
+            const double nan = std::numeric_limits<double>::quiet_NaN();
+            const double infinity = std::numeric_limits<double>::infinity();
+
+            std::vector<double> glucoseEdges = { nan, infinity, -infinity, 0.0, -0.0 };
+            addEdges(glucoseEdges, T::correction);
+            addEdges(glucoseEdges, T::increase);
+            addEdges(glucoseEdges, T::maintain);
+            addEdges(glucoseEdges, T::decrease);
+            std::vector<double> basalEdges = { nan, 0.0, infinity };
+            addEdges(basalEdges, T::basalDecrease);
+            std::vector<double> factorEdges = { nan, 0.0, -0.0, infinity, -1.0 };
+
+            const int count = 100003;
+            std::mt19937 random(20260);
+            std::vector<double> predicted(count), current(count), basal(count), profileBasal(count),
+                                target(count), factor(count);
+            for (int i = 0; i < count; ++i) {
+                predicted[i] = pick(random, 2.0, 20.0, glucoseEdges);
+                current[i] = pick(random, 2.0, 20.0, glucoseEdges);
+                basal[i] = pick(random, 0.0, 3.0, basalEdges);
+                profileBasal[i] = pick(random, 0.0, 3.0, basalEdges);
+                target[i] = pick(random, 5.0, 7.0, glucoseEdges);
+                factor[i] = pick(random, 1.0, 4.0, factorEdges);
+            }
+
+            std::vector<double> newBasal(count), correctionBolus(count);
+            ControlIQBatch batch;
+            batch.predictedGlucose = predicted.data();
+            batch.currentGlucose = current.data();
+            batch.currentBasal = basal.data();
+            batch.profileBasal = profileBasal.data();
+            batch.targetGlucose = target.data();
+            batch.correctionFactor = factor.data();
+            batch.newBasal = newBasal.data();
+            batch.correctionBolus = correctionBolus.data();
+            batch.count = count;
+            controlIQAdjustBatch(batch, ControlIQKernel(kernel));
+
+            for (int i = 0; i < count; ++i) {
+                double expectedBasal, expectedBolus;
+                controlIQDecide(predicted[i], current[i], basal[i], profileBasal[i], target[i], factor[i],
+                                expectedBasal, expectedBolus);
+                if (!sameBits(newBasal[i], expectedBasal) || !sameBits(correctionBolus[i], expectedBolus)) {
+                    QFAIL(qPrintable(QString("Patient %1 (predicted %2): basal %3 / %4, bolus %5 / %6")
+                                         .arg(i).arg(predicted[i]).arg(newBasal[i]).arg(expectedBasal)
+                                         .arg(correctionBolus[i]).arg(expectedBolus)));
+                }
+            }
+        }
+};
+
+QTEST_APPLESS_MAIN(ControlIQBatchTest)
+
+#include "tst_controliqbatch.moc"
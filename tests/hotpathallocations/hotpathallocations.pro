@@ -0,0 +1,29 @@
+# Runs the dosing tick path with allocation counting enabled and fails if it touches the heap
+# (see allocationcounter.h):
+#
+#   qmake tests/hotpathallocations && make check
+
+QT       += core testlib
+QT       -= gui
+
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+DEFINES += INSULINPUMP_COUNT_ALLOCATIONS
+
+# shm_open lives in librt on older glibc.
+linux: LIBS += -lrt
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+    tst_hotpathallocations.cpp \
+    ../../allocationcounter.cpp \
+    ../../cgm.cpp \
+    ../../controliq.cpp \
+    ../../controliqbatch.cpp \
+    ../../insulinpump.cpp \
+    ../../latencyhistogram.cpp \
+    ../../profile.cpp \
+    ../../telemetrybus.cpp \
+    ../../tracing.cpp
@@ -0,0 +1,65 @@
+#include <QtTest>
+#include "allocationcounter.h"
+#include "controliq.h"
+
+// Drives the same steps as a pump tick (CGM reading, Control-IQ decision, basal delivery and the
+// history entries they log) and checks that none of them allocated. HOT_PATH scopes already abort
+// on an allocation inside them; this also catches allocations between the scopes.
+class HotPathAllocations : public QObject {
+    Q_OBJECT
+
+    private:
+        static quint64 totalAllocations() {
+            quint64 total = 0;
+            for (int i = 0; i < int(AllocationSubsystem::Count); ++i)
+                total += AllocationCounter::allocations(AllocationSubsystem(i));
+            return total;
+        }
+
+    private slots:
+        void tickPathDoesNotAllocate() {
+            QVERIFY(AllocationCounter::enabled());
+
+            Profile profile("Test", 1.0, 10.0, 2.0, 6.0);
+            CGM cgm(profile.correctionFactor);
+            InsulinPump pump(&cgm);
+            BasicControlIQ<ThresholdLadderPolicy<>, RandomDriftPredictor, NoWaitClock> controller(&pump, &profile, &cgm);
+
+            // One tick outside the measurement, so one-time setup such as the history's first chunk is not counted.
+            cgm.readGlucose();
+            controller.tick();
+            pump.deliverBasalTick();
+
+            quint64 before = totalAllocations();
+            for (int tick = 0; tick < 2000; ++tick) {
+                cgm.readGlucose();
+                controller.tick();
+                pump.deliverBasalTick();
+                if (pump.getInsulinRemainingMilliunits() < 50 * milliunitsPerUnit)
+                    pump.refillCartridge();
+            }
+            QCOMPARE(totalAllocations() - before, quint64(0));
+        }
+
+        // Far more history than the initial reserve holds: the reserve is topped up outside the
+        // hot path, so no HOT_PATH scope may see an allocation (it would abort the test).
+        void longRunStaysOffTheHeapInHotPath() {
+            const int records = (InsulinPump::reservedHistoryChunks + 64) * 256;
+            Profile profile("Test", 1.0, 10.0, 2.0, 6.0);
+            CGM cgm(profile.correctionFactor);
+            InsulinPump pump(&cgm);
+            BasicControlIQ<ThresholdLadderPolicy<>, RandomDriftPredictor, NoWaitClock> controller(&pump, &profile, &cgm);
+            for (int tick = 0; tick < records; ++tick) {
+                cgm.readGlucose();
+                controller.tick();
+                pump.deliverBasalTick();
+                if (pump.getInsulinRemainingMilliunits() < 50 * milliunitsPerUnit)
+                    pump.refillCartridge();
+            }
+            QVERIFY(AllocationCounter::allocations(AllocationSubsystem::Pump) == 0);
+        }
+};
+
+QTEST_APPLESS_MAIN(HotPathAllocations)
+
+#include "tst_hotpathallocations.moc"
@@ -0,0 +1,89 @@
+#include "tickdispatcher.h"
+#include "latencyhistogram.h"
+#include "tracing.h"
+#include <algorithm>
+
+TickDispatcher::TickDispatcher(int tickIntervalMs, QObject *parent)
+    : QObject(parent), nextId(0), interval(tickIntervalMs), maxCatchUp(8),
+      tickCount(0), skipped(0), lastDrift(0), maxDrift(0)
+{
+    timer.setSingleShot(true);
+    timer.setTimerType(Qt::PreciseTimer);
+    connect(&timer, &QTimer::timeout, this, &TickDispatcher::onTimeout);
+}
+
+int TickDispatcher::subscribe(Phase phase, int periodTicks, std::function<void()> callback) {
+    Subscriber subscriber;
+    subscriber.id = nextId++;
+    subscriber.phase = phase;
+    subscriber.periodTicks = std::max(1, periodTicks);
+    subscriber.enabled = true;
+    subscriber.callback = callback;
+
+    // Insert after existing subscribers of the same phase so registration order is kept within a phase.
+    auto position = std::upper_bound(subscribers.begin(), subscribers.end(), phase,
+                                     [](Phase p, const Subscriber &s) { return p < s.phase; });
+    subscribers.insert(position, subscriber);
+    return subscriber.id;
+}
+
+void TickDispatcher::setSubscriberEnabled(int id, bool enabled) {
+    for (Subscriber &subscriber : subscribers) {
+        if (subscriber.id == id)
+            subscriber.enabled = enabled;
+    }
+}
+
+void TickDispatcher::start() {
+    tickCount = 0;
+    clock.start();
+    scheduleNext();
+}
+
+void TickDispatcher::stop() {
+    timer.stop();
+}
+
+void TickDispatcher::setMaxCatchUpTicks(int ticks) {
+    maxCatchUp = std::max(0, ticks);
+}
+
+quint64 TickDispatcher::ticks() const { return tickCount; }
+quint64 TickDispatcher::skippedTicks() const { return skipped; }
+qint64 TickDispatcher::lastDriftMs() const { return lastDrift; }
+qint64 TickDispatcher::maxDriftMs() const { return maxDrift; }
+
+void TickDispatcher::onTimeout() {
+    qint64 now = clock.elapsed();
+    quint64 due = quint64(now / interval); // ticks whose deadline has passed
+
+    lastDrift = now - qint64(tickCount + 1) * interval;
+    maxDrift = std::max(maxDrift, lastDrift);
+    Latency::tickDrift.record(lastDrift * 1000000);
+
+    // After a stall, replay at most maxCatchUp missed ticks and drop the rest.
+    if (due > tickCount + 1 + quint64(maxCatchUp)) {
+        quint64 drop = due - tickCount - 1 - quint64(maxCatchUp);
+        skipped += drop;
+        tickCount += drop;
+    }
+    while (tickCount < due)
+        runTick(++tickCount);
+
+    scheduleNext();
+}
+
+void TickDispatcher::runTick(quint64 tick) {
+    TraceSpan span("tick", "timer");
+    // Subscribers may disable each other (e.g. a dead battery), so check enabled as we go.
+    for (int i = 0; i < subscribers.size(); ++i) {
+        const Subscriber &subscriber = subscribers.at(i);
+        if (subscriber.enabled && tick % quint64(subscriber.periodTicks) == 0)
+            subscriber.callback();
+    }
+}
+
+void TickDispatcher::scheduleNext() {
+    qint64 nextDeadline = qint64(tickCount + 1) * interval;
+    timer.start(int(std::max<qint64>(0, nextDeadline - clock.elapsed())));
+}
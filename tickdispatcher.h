@@ -0,0 +1,69 @@
+#ifndef TICKDISPATCHER_H
+#define TICKDISPATCHER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QVector>
+#include <functional>
+
+// Single simulation clock. One timer wakeup per tick runs every due subscriber in phase order
+// (sense -> control -> deliver -> display), so sensor, controller and display never drift apart.
+//
+// Ticks are scheduled against absolute deadlines rather than a repeating interval: every wakeup
+// measures how late it is (drift, recorded in Latency::tickDrift), re-arms the timer for the next
+// deadline and, after a stall such as a blocked GUI thread, catches up on missed ticks.
+class TickDispatcher : public QObject {
+    Q_OBJECT
+
+public:
+    enum Phase {
+        Sense,
+        Control,
+        Deliver,
+        Display
+    };
+
+    explicit TickDispatcher(int tickIntervalMs, QObject *parent = nullptr);
+
+    // Calls callback every periodTicks ticks in the given phase. Returns an id for setSubscriberEnabled.
+    int subscribe(Phase phase, int periodTicks, std::function<void()> callback);
+    void setSubscriberEnabled(int id, bool enabled);
+
+    void start();
+    void stop();
+
+    // Ticks run late by more than this many are skipped instead of replayed.
+    void setMaxCatchUpTicks(int ticks);
+
+    quint64 ticks() const;
+    quint64 skippedTicks() const;
+    qint64 lastDriftMs() const;
+    qint64 maxDriftMs() const;
+
+private:
+    struct Subscriber {
+        int id;
+        Phase phase;
+        int periodTicks;
+        bool enabled;
+        std::function<void()> callback;
+    };
+
+    QTimer timer;
+    QElapsedTimer clock;
+    QVector<Subscriber> subscribers; // kept sorted by phase
+    int nextId;
+    int interval;
+    int maxCatchUp;
+    quint64 tickCount;
+    quint64 skipped;
+    qint64 lastDrift;
+    qint64 maxDrift;
+
+    void onTimeout();
+    void runTick(quint64 tick);
+    void scheduleNext();
+};
+
+#endif // TICKDISPATCHER_H
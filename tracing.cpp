@@ -0,0 +1,192 @@
+#include "tracing.h"
+#include <QFile>
+#include <QTextStream>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+// Guarded like the telemetry ring (a seqlock): sequence is 2n+1 while event n is being written
+// into the slot and 2n+2 once it is complete, so a concurrent export can skip unfinished slots.
+struct TraceEvent {
+    std::atomic<quint64> sequence;
+    const char *name;
+    const char *category;
+    char detail[24];
+    qint64 start;
+    qint64 duration;
+};
+
+const int maxThreads = 16;         // further threads share rings
+const int eventsPerThread = 8192;  // power of two
+
+struct ThreadRing {
+    std::atomic<quint64> written;
+    std::atomic<const char*> threadName;
+    TraceEvent events[eventsPerThread];
+};
+
+ThreadRing rings[maxThreads];
+std::atomic<int> nextRing(0);
+std::atomic<bool> enabled(false);
+qint64 traceStart = Tracing::now();
+
+ThreadRing &threadRing() {
+    static thread_local int ring = nextRing.fetch_add(1) % maxThreads;
+    return rings[ring];
+}
+
+void copyDetail(char *target, const char *source) {
+    std::strncpy(target, source ? source : "", sizeof(TraceEvent::detail) - 1);
+    target[sizeof(TraceEvent::detail) - 1] = '\0';
+}
+
+QString jsonString(const char *text) {
+    QString escaped;
+    for (const char *c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\')
+            escaped += '\\';
+        if (uchar(*c) >= 0x20)
+            escaped += QChar::fromLatin1(*c);
+    }
+    return "\"" + escaped + "\"";
+}
+
+// Writes the trace to INSULINPUMP_TRACE at exit if the variable is set.
+struct EnvironmentTrace {
+    QString path;
+    EnvironmentTrace() {
+        const char *file = std::getenv("INSULINPUMP_TRACE");
+        if (file && *file) {
+            path = QString::fromLocal8Bit(file);
+            enabled = true;
+        }
+    }
+    ~EnvironmentTrace() {
+        if (!path.isEmpty())
+            Tracing::exportChromeTrace(path);
+    }
+} environmentTrace;
+
+}
+
+void Tracing::setEnabled(bool on) {
+    enabled.store(on, std::memory_order_relaxed);
+}
+
+bool Tracing::isEnabled() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+void Tracing::setThreadName(const char *name) {
+    threadRing().threadName.store(name, std::memory_order_relaxed);
+}
+
+qint64 Tracing::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Tracing::record(const char *name, const char *category, const char *detail, qint64 start, qint64 end) {
+    if (!isEnabled())
+        return;
+
+    ThreadRing &ring = threadRing();
+    quint64 slot = ring.written.fetch_add(1, std::memory_order_relaxed);
+    TraceEvent &event = ring.events[slot & (eventsPerThread - 1)];
+    event.sequence.store(2 * slot + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    event.name = name;
+    event.category = category;
+    copyDetail(event.detail, detail);
+    event.start = start;
+    event.duration = end - start;
+    event.sequence.store(2 * slot + 2, std::memory_order_release);
+}
+
+bool Tracing::exportChromeTrace(const QString &path) {
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+        return false;
+
+    QTextStream out(&file);
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+    for (int tid = 0; tid < maxThreads; ++tid) {
+        const ThreadRing &ring = rings[tid];
+        quint64 written = ring.written.load(std::memory_order_acquire);
+        if (written == 0)
+            continue;
+
+        const char *threadName = ring.threadName.load(std::memory_order_relaxed);
+        if (threadName) {
+            out << (first ? "" : ",\n")
+                << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+                << ",\"args\":{\"name\":" << jsonString(threadName) << "}}";
+            first = false;
+        }
+
+        quint64 begin = written > quint64(eventsPerThread) ? written - eventsPerThread : 0;
+        for (quint64 i = begin; i < written; ++i) {
+            // Copy the slot, then keep the copy only if no thread was writing it meanwhile.
+            const TraceEvent &slot = ring.events[i & (eventsPerThread - 1)];
+            quint64 expected = 2 * i + 2;
+            if (slot.sequence.load(std::memory_order_acquire) != expected)
+                continue; // still being written, or already overwritten
+            TraceEvent event;
+            event.name = slot.name;
+            event.category = slot.category;
+            std::memcpy(event.detail, slot.detail, sizeof(event.detail));
+            event.start = slot.start;
+            event.duration = slot.duration;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) != expected || !event.name || !event.category)
+                continue;
+            event.detail[sizeof(event.detail) - 1] = '\0';
+            out << (first ? "" : ",\n")
+                << "{\"name\":" << jsonString(event.name)
+                << ",\"cat\":" << jsonString(event.category)
+                << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+                << ",\"ts\":" << QString::number((event.start - traceStart) / 1000.0, 'f', 3)
+                << ",\"dur\":" << QString::number(event.duration / 1000.0, 'f', 3);
+            if (event.detail[0])
+                out << ",\"args\":{\"detail\":" << jsonString(event.detail) << "}";
+            out << "}";
+            first = false;
+        }
+    }
+    out << "\n]}\n";
+    return true;
+}
+
+// While tracing is disabled, spans skip the clock and the detail copy; start == 0 marks them.
+TraceSpan::TraceSpan(const char *name, const char *category)
+    : name(name), category(category), start(Tracing::isEnabled() ? Tracing::now() : 0)
+{
+    detail[0] = '\0';
+}
+
+TraceSpan::TraceSpan(const char *name, const char *category, const char *text)
+    : name(name), category(category), start(Tracing::isEnabled() ? Tracing::now() : 0)
+{
+    if (start)
+        copyDetail(detail, text);
+}
+
+TraceSpan::TraceSpan(const char *name, const char *category, const QString &text)
+    : name(name), category(category), start(Tracing::isEnabled() ? Tracing::now() : 0)
+{
+    if (!start)
+        return;
+    // Latin-1 copy without going through a temporary QByteArray.
+    int length = qMin(text.size(), int(sizeof(detail)) - 1);
+    for (int i = 0; i < length; ++i)
+        detail[i] = text.at(i).toLatin1();
+    detail[length] = '\0';
+}
+
+TraceSpan::~TraceSpan() {
+    if (start)
+        Tracing::record(name, category, detail, start, Tracing::now());
+}
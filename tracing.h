@@ -0,0 +1,44 @@
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <QString>
+#include <QtGlobal>
+
+// Span tracing exported as Chrome trace-event JSON (loads in Perfetto and chrome://tracing).
+//
+// Spans go into fixed per-thread ring buffers that are allocated statically, so recording costs
+// two clock reads and a few stores and never touches the heap. When a ring is full the oldest
+// spans are overwritten. While recording is disabled a span reads no clock at all. Recording
+// starts enabled when INSULINPUMP_TRACE names an output file, which is written on exit;
+// Tracing::exportChromeTrace can also be called at any time, even while other threads record
+// (events still being written are left out).
+namespace Tracing {
+    void setEnabled(bool enabled);
+    bool isEnabled();
+
+    // Label for the calling thread in the exported trace.
+    void setThreadName(const char *name);
+
+    qint64 now(); // steady clock in nanoseconds
+    void record(const char *name, const char *category, const char *detail, qint64 start, qint64 end);
+
+    bool exportChromeTrace(const QString &path);
+}
+
+// Records the lifetime of the scope as a complete ("X") event. name and category must be string
+// literals; detail is copied (truncated) into the event.
+class TraceSpan {
+    private:
+        const char *name;
+        const char *category;
+        char detail[24];
+        qint64 start;
+
+    public:
+        TraceSpan(const char *name, const char *category);
+        TraceSpan(const char *name, const char *category, const char *detail);
+        TraceSpan(const char *name, const char *category, const QString &detail);
+        ~TraceSpan();
+};
+
+#endif // TRACING_H
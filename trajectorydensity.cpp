@@ -0,0 +1,204 @@
+#include "trajectorydensity.h"
+#include "simulationstore.h"
+#include "parallelworkers.h"
+#include <QHash>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// Trajectories are handed out in blocks so workers rarely touch the shared counter.
+static const int trajectoriesPerBlock = 16;
+
+TrajectoryDensity::TrajectoryDensity(int timeBins, int glucoseBins, const QCPRange &times, const QCPRange &glucose)
+    : columns(std::max(1, timeBins)), rows(std::max(1, glucoseBins)), timeRange(times), glucoseRange(glucose),
+      counts(columns * rows, 0)
+{
+}
+
+void TrajectoryDensity::draw(quint32 *grid, const double *times, double startTime, double interval,
+                             const double *glucose, int count) const {
+    const double columnWidth = timeRange.size() / columns;
+    const double rowHeight = glucoseRange.size() / rows;
+
+    // The run of rows the trajectory covers in the current column, added to the grid once the
+    // line leaves the column.
+    int column = -1, low = 0, high = 0;
+    auto flush = [&]() {
+        if (column < 0)
+            return;
+        quint32 *cells = grid + column * rows;
+        for (int row = low; row <= high; ++row)
+            ++cells[row];
+    };
+    // Glucose outside the range is drawn in the edge rows.
+    auto extend = [&](int c, double g) {
+        int row = qBound(0, int(std::floor((g - glucoseRange.lower) / rowHeight)), rows - 1);
+        if (c != column) {
+            flush();
+            column = c;
+            low = high = row;
+        } else {
+            low = std::min(low, row);
+            high = std::max(high, row);
+        }
+    };
+
+    bool connected = false;
+    double t0 = 0, g0 = 0;
+    for (int i = 0; i < count; ++i) {
+        double t1 = times ? times[i] : startTime + i * interval;
+        double g1 = glucose[i];
+        if (std::isnan(g1)) {
+            connected = false;
+            continue;
+        }
+        if (!connected || t1 <= t0) {
+            // Start of a line: a lone point.
+            // The division can round up to columns for t1 just below the upper bound.
+            if (t1 >= timeRange.lower && t1 < timeRange.upper)
+                extend(std::min(columns - 1, int((t1 - timeRange.lower) / columnWidth)), g1);
+        } else {
+            // Every column the segment crosses, with glucose interpolated where it enters and leaves.
+            double a = std::max(t0, timeRange.lower);
+            double b = std::min(t1, timeRange.upper);
+            if (a < b) {
+                double slope = (g1 - g0) / (t1 - t0);
+                int first = std::min(columns - 1, int((a - timeRange.lower) / columnWidth));
+                int last = std::min(columns - 1, int((b - timeRange.lower) / columnWidth));
+                for (int c = first; c <= last; ++c) {
+                    double enter = std::max(a, timeRange.lower + c * columnWidth);
+                    double leave = std::min(b, timeRange.lower + (c + 1) * columnWidth);
+                    extend(c, g0 + (enter - t0) * slope);
+                    extend(c, g0 + (leave - t0) * slope);
+                }
+            }
+        }
+        connected = true;
+        t0 = t1;
+        g0 = g1;
+    }
+    flush();
+}
+
+void TrajectoryDensity::merge(const QVector<QVector<quint32>> &grids) {
+    // Each worker sums its own slice of cells across all grids.
+    int cells = counts.size();
+    quint32 *total = counts.data();
+    runWorkers(grids.size(), [&](int worker, int workers) {
+        int begin = int(qint64(cells) * worker / workers);
+        int end = int(qint64(cells) * (worker + 1) / workers);
+        for (const QVector<quint32> &grid : grids) {
+            const quint32 *partial = grid.constData();
+            for (int i = begin; i < end; ++i)
+                total[i] += partial[i];
+        }
+    });
+}
+
+void TrajectoryDensity::rasterize(const QVector<Trajectory> &trajectories) {
+    int blocks = (trajectories.size() + trajectoriesPerBlock - 1) / trajectoriesPerBlock;
+    if (blocks == 0)
+        return;
+    std::atomic<int> next(0);
+    QVector<QVector<quint32>> grids(workerCount(blocks));
+    QVector<quint32> *workerGrids = grids.data();
+    runWorkers(grids.size(), [&](int worker, int) {
+        QVector<quint32> grid(counts.size(), 0);
+        quint32 *cells = grid.data();
+        for (int block = next++; block < blocks; block = next++) {
+            int end = std::min(trajectories.size(), (block + 1) * trajectoriesPerBlock);
+            for (int i = block * trajectoriesPerBlock; i < end; ++i) {
+                const Trajectory &trajectory = trajectories.at(i);
+                draw(cells, nullptr, trajectory.startTime, trajectory.interval, trajectory.glucose, trajectory.count);
+            }
+        }
+        workerGrids[worker] = grid;
+    });
+    merge(grids);
+}
+
+void TrajectoryDensity::rasterize(const SimulationStoreReader &store, double foldHours) {
+    int chunks = store.chunkCount();
+    if (chunks == 0)
+        return;
+
+    // Each patient's first timestamp, from the index alone.
+    QHash<quint32, qint64> patientStart;
+    for (int chunk = 0; chunk < chunks; ++chunk) {
+        const SimulationChunkInfo &info = store.chunkInfo(chunk);
+        QHash<quint32, qint64>::iterator start = patientStart.find(info.patient);
+        if (start == patientStart.end())
+            patientStart.insert(info.patient, info.firstTimestamp);
+        else if (info.firstTimestamp < start.value())
+            start.value() = info.firstTimestamp;
+    }
+
+    std::atomic<int> next(0);
+    QVector<QVector<quint32>> grids(workerCount(chunks));
+    QVector<quint32> *workerGrids = grids.data();
+    runWorkers(grids.size(), [&](int worker, int) {
+        QVector<quint32> grid(counts.size(), 0);
+        QVector<qint64> timestamps;
+        QVector<double> glucose;
+        QVector<double> hours;
+        for (int chunk = next++; chunk < chunks; chunk = next++) {
+            if (!store.readTimestamps(chunk, timestamps) || !store.readColumn(chunk, GlucoseColumn, glucose))
+                continue;
+            qint64 start = patientStart.value(store.chunkInfo(chunk).patient);
+            hours.resize(timestamps.size());
+            for (int i = 0; i < timestamps.size(); ++i) {
+                double t = (timestamps[i] - start) / 3600000.0;
+                hours[i] = foldHours > 0 ? std::fmod(t, foldHours) : t;
+            }
+            draw(grid.data(), hours.constData(), 0, 0, glucose.constData(), std::min(hours.size(), glucose.size()));
+        }
+        workerGrids[worker] = grid;
+    });
+    merge(grids);
+}
+
+void TrajectoryDensity::clear() {
+    std::fill(counts.begin(), counts.end(), 0u);
+}
+
+quint32 TrajectoryDensity::count(int timeBin, int glucoseBin) const {
+    if (timeBin < 0 || timeBin >= columns || glucoseBin < 0 || glucoseBin >= rows)
+        return 0;
+    return counts.at(timeBin * rows + glucoseBin);
+}
+
+quint32 TrajectoryDensity::maximum() const {
+    return counts.isEmpty() ? 0 : *std::max_element(counts.constBegin(), counts.constEnd());
+}
+
+void TrajectoryDensity::fill(QCPColorMapData *data, bool logarithmic) const {
+    // QCPColorMapData ranges are the centres of the outer cells.
+    const double columnWidth = timeRange.size() / columns;
+    const double rowHeight = glucoseRange.size() / rows;
+    data->setSize(columns, rows);
+    data->setRange(QCPRange(timeRange.lower + columnWidth / 2, timeRange.upper - columnWidth / 2),
+                   QCPRange(glucoseRange.lower + rowHeight / 2, glucoseRange.upper - rowHeight / 2));
+
+    // The grid is column-major like setColumn expects, so each column is one contiguous copy.
+    QVector<double> column(rows);
+    for (int c = 0; c < columns; ++c) {
+        const quint32 *cells = counts.constData() + c * rows;
+        for (int row = 0; row < rows; ++row)
+            column[row] = logarithmic && cells[row] == 0 ? std::numeric_limits<double>::quiet_NaN() : double(cells[row]);
+        data->setColumn(c, column.constData());
+    }
+    data->recalculateDataBounds();
+}
+
+void TrajectoryDensity::apply(QCPColorMap *map, bool logarithmic, const QCPColorGradient &gradient) const {
+    fill(map->data(), logarithmic);
+    QCPColorGradient mapGradient(gradient);
+    if (logarithmic)
+        mapGradient.setNanHandling(QCPColorGradient::nhTransparent);
+    map->setGradient(mapGradient);
+    map->setDataScaleType(logarithmic ? QCPAxis::stLogarithmic : QCPAxis::stLinear);
+    double top = std::max(2.0, double(maximum()));
+    map->setDataRange(logarithmic ? QCPRange(1, top) : QCPRange(0, top));
+}
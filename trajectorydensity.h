@@ -0,0 +1,63 @@
+#ifndef TRAJECTORYDENSITY_H
+#define TRAJECTORYDENSITY_H
+
+#include <QVector>
+#include <QtGlobal>
+#include "qcustomplot.h"
+
+class SimulationStoreReader;
+
+// Glucose samples at a fixed interval, e.g. one simulated patient-day. The samples are not copied.
+struct Trajectory {
+    const double *glucose = nullptr;   // mmol/L; NaN breaks the line
+    int count = 0;
+    double startTime = 0;
+    double interval = 1;
+};
+
+// Density plot of many glucose trajectories: how many trajectories pass through each
+// (time, glucose) cell. Thousands of curves are one QCPColorMap instead of thousands of QCPGraphs.
+//
+// Every trajectory is drawn as a line. In each time column it touches it adds one to the run of
+// glucose cells between the lowest and highest glucose it reaches there, so a cell counts
+// trajectories, not samples, whatever the sampling rate. Trajectories are shared out between
+// threads, each drawing into its own grid; the grids are summed in parallel at the end.
+class TrajectoryDensity {
+    private:
+        int columns;
+        int rows;
+        QCPRange timeRange;
+        QCPRange glucoseRange;
+        QVector<quint32> counts;   // column-major, counts[column * rows + row]
+
+        // Draws one trajectory into a worker's grid. Sample i is at times[i], or at
+        // startTime + i * interval when times is null; time going backwards breaks the line.
+        void draw(quint32 *grid, const double *times, double startTime, double interval,
+                  const double *glucose, int count) const;
+        void merge(const QVector<QVector<quint32>> &grids);
+
+    public:
+        TrajectoryDensity(int timeBins, int glucoseBins, const QCPRange &times, const QCPRange &glucose);
+
+        void rasterize(const QVector<Trajectory> &trajectories);
+
+        // Every patient in a store, with time in hours since the patient's first row. With
+        // foldHours > 0 time wraps around, so foldHours = 24 overlays all days of all patients.
+        // Chunks are drawn independently, so the segment across each chunk boundary is left out.
+        void rasterize(const SimulationStoreReader &store, double foldHours = 24);
+
+        void clear();
+        quint32 count(int timeBin, int glucoseBin) const;
+        quint32 maximum() const;
+
+        // Copies the counts into data, resizing it to the grid. With logarithmic, empty cells become
+        // NaN so they can be drawn transparent on a logarithmic data scale.
+        void fill(QCPColorMapData *data, bool logarithmic = false) const;
+
+        // Fills map's data and sets its gradient and data range; with logarithmic the data scale is
+        // logarithmic, so sparse outliers stay visible next to the dense core.
+        void apply(QCPColorMap *map, bool logarithmic = false,
+                   const QCPColorGradient &gradient = QCPColorGradient(QCPColorGradient::gpThermal)) const;
+};
+
+#endif // TRAJECTORYDENSITY_H